@@ -21,6 +21,7 @@
 #include <codeslayer/codeslayer-utils.h>
 #include <codeslayer/codeslayer-plugins.h>
 #include <codeslayer/codeslayer-profiles.h>
+#include <codeslayer/codeslayer-projects-search.h>
 
 /**
  * SECTION:codeslayer-application
@@ -39,6 +40,7 @@ static gint codeslayer_application_options     (GApplication               *appl
                                                 GVariantDict               *options);
 
 static void show_profiles                      (void);
+static gint grep_projects                      (void);
 static void codeslayer_application_open        (GApplication               *application,
                                                 GFile                      **files,
                                                 gint                        n_files,
@@ -52,18 +54,27 @@ static void verify_profiles_dir_exists         (void);
 #define CODESLAYER_APPLICATION_VERSION "version"
 #define CODESLAYER_APPLICATION_SHOW_PROFILES "show-profiles"
 #define CODESLAYER_APPLICATION_OPEN_PROFILE "open-profile"
+#define CODESLAYER_APPLICATION_GREP "grep"
+#define CODESLAYER_APPLICATION_REGEX "regex"
+#define CODESLAYER_APPLICATION_IGNORE_CASE "ignore-case"
 
 G_DEFINE_TYPE (CodeSlayerApplication, codeslayer_application, GTK_TYPE_APPLICATION)
 
 static gboolean version_arg = FALSE;
 static gboolean show_profiles_arg = FALSE;
 static gchar *open_profile_arg = NULL;
+static gchar *grep_arg = NULL;
+static gboolean regex_arg = FALSE;
+static gboolean ignore_case_arg = FALSE;
 
 static GOptionEntry entries[] =
 {
 { CODESLAYER_APPLICATION_VERSION, 'v', 0, G_OPTION_ARG_NONE, &version_arg, "The current version", NULL },
 { CODESLAYER_APPLICATION_SHOW_PROFILES, 's', 0, G_OPTION_ARG_NONE, &show_profiles_arg, "Show all the profiles", NULL },
 { CODESLAYER_APPLICATION_OPEN_PROFILE, 'p', 0, G_OPTION_ARG_STRING, &open_profile_arg, "Open the named profile (ex: -p test).", NULL },
+{ CODESLAYER_APPLICATION_GREP, 'g', 0, G_OPTION_ARG_STRING, &grep_arg, "Search the projects of the profile and print the hits without opening a window (ex: -p test -g text).", NULL },
+{ CODESLAYER_APPLICATION_REGEX, 'r', 0, G_OPTION_ARG_NONE, &regex_arg, "The text to grep is a regular expression", NULL },
+{ CODESLAYER_APPLICATION_IGNORE_CASE, 'i', 0, G_OPTION_ARG_NONE, &ignore_case_arg, "Ignore the case of the text to grep", NULL },
 { NULL }
 };
 
@@ -92,6 +103,9 @@ codeslayer_application_finalize (CodeSlayerApplication *application)
   if (open_profile_arg != NULL)
     g_free (open_profile_arg);
 
+  if (grep_arg != NULL)
+    g_free (grep_arg);
+
   G_OBJECT_CLASS (codeslayer_application_parent_class)->finalize (G_OBJECT (application));
 }
 
@@ -134,6 +148,9 @@ codeslayer_application_options (GApplication *application,
       return 0;      
     }
 
+  if (grep_arg != NULL)
+    return grep_projects ();
+
   if (open_profile_arg != NULL)
     {
       if (!codeslayer_utils_profile_exists (open_profile_arg))
@@ -175,6 +192,37 @@ show_profiles ()
   g_list_free_full (profile_names, g_free);
 }
 
+/*
+ * Runs before the application is registered, so no window is created 
+ * and the exit status is the one of the search.
+ */
+static gint
+grep_projects (void)
+{
+  CodeSlayerProfiles *profiles;
+  CodeSlayerProfile *profile;
+  const gchar *profile_name;
+  gint status;
+
+  profile_name = open_profile_arg != NULL ? open_profile_arg : CODESLAYER_PROFILES_DEFAULT;
+
+  profiles = codeslayer_profiles_new ();
+  profile = codeslayer_profiles_retrieve_profile (profiles, profile_name);
+  if (profile == NULL)
+    {
+      g_printerr ("The profile name '%s' is invalid\n", profile_name);
+      g_object_unref (profiles);
+      return 2;
+    }
+
+  status = codeslayer_projects_search_grep (profile, grep_arg, regex_arg, !ignore_case_arg);
+
+  g_object_unref (profile);
+  g_object_unref (profiles);
+
+  return status;
+}
+
 static void
 codeslayer_application_startup (GApplication *application)
 {
@@ -21,6 +21,7 @@
 #include <string.h>
 #include <codeslayer/codeslayer-document-search-dialog.h>
 #include <codeslayer/codeslayer-utils.h>
+#include <codeslayer/codeslayer-search-matcher.h>
 
 /**
  * SECTION:codeslayer-document-search-dialog
@@ -46,6 +47,9 @@ static void row_activated_action                          (CodeSlayerDocumentSea
 static gboolean filter_callback                           (GtkTreeModel                        *model,
                                                            GtkTreeIter                         *iter,
                                                            CodeSlayerDocumentSearchDialog      *dialog);
+static gboolean match_file_name                           (CodeSlayerDocumentSearchDialog      *dialog,
+                                                           const gchar                         *file_name,
+                                                           gsize                                length);
 static gchar* get_globbing                                (const gchar                         *entry, 
                                                            gboolean                             match_case);
 static gint sort_compare                                  (GtkTreeModel                        *model, 
@@ -73,6 +77,7 @@ struct _CodeSlayerDocumentSearchDialogPrivate
   gchar              *find_text; 
   gchar              *find_globbing;
   GPatternSpec       *find_pattern; 
+  gsize               find_prefix_length;
 };
 
 enum
@@ -101,6 +106,7 @@ codeslayer_document_search_dialog_init (CodeSlayerDocumentSearchDialog *dialog)
   priv->find_text = NULL;
   priv->find_globbing = NULL;
   priv->find_pattern = NULL;
+  priv->find_prefix_length = 0;
 }
 
 static void
@@ -323,6 +329,12 @@ key_release_action (CodeSlayerDocumentSearchDialog *dialog,
         g_pattern_spec_free (priv->find_pattern);
       
       priv->find_pattern = g_pattern_spec_new (priv->find_globbing);
+      
+      /* without wildcards the globbing is just a prefix of the file name */
+      if (codeslayer_search_matcher_is_literal (text))
+        priv->find_prefix_length = strlen (text);
+      else
+        priv->find_prefix_length = 0;
 
       if (refilter)
         {
@@ -361,8 +373,7 @@ render_indexes (CodeSlayerDocumentSearchDialog *dialog)
 {
   CodeSlayerDocumentSearchDialogPrivate *priv;
   GIOChannel *channel = NULL;
-  gchar *line;
-  gsize len;
+  GString *line;
   gint count = 0;
 
   gchar *profile_folder_path;
@@ -393,42 +404,45 @@ render_indexes (CodeSlayerDocumentSearchDialog *dialog)
   
   priv->find_text = g_strdup (gtk_entry_get_text (GTK_ENTRY (priv->entry)));
   
-  while (g_io_channel_read_line (channel, &line, &len, NULL, NULL) != G_IO_STATUS_EOF)
+  /* one line buffer for the whole file, only matching lines are split */
+  line = g_string_sized_new (256);
+  
+  while (g_io_channel_read_line_string (channel, line, NULL, NULL) == G_IO_STATUS_NORMAL)
     {
-      gchar **split;
-      gchar **tmp;
       gchar *file_name;  
       gchar *file_path;  
+      gchar *tab;
 
-      if (!codeslayer_utils_has_text (line))
+      if (!codeslayer_utils_has_text (line->str))
         continue;
     
-      split = g_strsplit (line, "\t", -1);
-      if (split == NULL)
+      file_name = line->str;
+      tab = strchr (file_name, '\t');
+      if (tab == NULL)
         continue;
-      
-      tmp = split;
-      file_name = *tmp;
-      file_path = *++tmp;
-      
-      if (file_path != NULL)
-        g_strstrip(file_path);
-      
-      if (g_pattern_match_string (priv->find_pattern, file_name))
+
+      *tab = '\0';
+      if (match_file_name (dialog, file_name, tab - file_name))
         {
           GtkTreeIter iter;
+          file_path = tab + 1;
+
+          /* leave out the tags that follow the path */
+          tab = strchr (file_path, '\t');
+          if (tab != NULL)
+            *tab = '\0';
+
+          file_path = g_strstrip (file_path);
           gtk_list_store_append (priv->store, &iter);
           gtk_list_store_set (priv->store, &iter, FILE_NAME, file_name, FILE_PATH, file_path, -1);
           count++;
         }
-        
-      g_strfreev (split);
-      g_free (line);
       
       if (count >= MAX_RESULTS)
         break;
     }
     
+  g_string_free (line, TRUE);
   g_free (profile_folder_path);
   g_free (profile_indexes_file);
   g_io_channel_shutdown (channel, FALSE, NULL);
@@ -453,7 +467,7 @@ filter_callback (GtkTreeModel                   *model,
   if (value == NULL)
     return FALSE;
 
-  if (g_pattern_match_string (priv->find_pattern, value))
+  if (match_file_name (dialog, value, strlen (value)))
     {
       g_free (value);    
       return TRUE;
@@ -464,6 +478,22 @@ filter_callback (GtkTreeModel                   *model,
   return FALSE;
 }
 
+static gboolean
+match_file_name (CodeSlayerDocumentSearchDialog *dialog,
+                 const gchar                    *file_name,
+                 gsize                           length)
+{
+  CodeSlayerDocumentSearchDialogPrivate *priv;
+  
+  priv = CODESLAYER_DOCUMENT_SEARCH_DIALOG_GET_PRIVATE (dialog);
+  
+  if (priv->find_prefix_length > 0)
+    return length >= priv->find_prefix_length 
+           && memcmp (file_name, priv->find_globbing, priv->find_prefix_length) == 0;
+  
+  return g_pattern_match (priv->find_pattern, length, file_name, NULL);
+}
+
 static gchar*
 get_globbing (const gchar *entry, 
               gboolean     match_case)
@@ -19,6 +19,11 @@
 #include <codeslayer/codeslayer-document-search.h>
 #include <codeslayer/codeslayer-document-search-dialog.h>
 #include <codeslayer/codeslayer-utils.h>
+#include <codeslayer/codeslayer-search-policy.h>
+#include <codeslayer/codeslayer-search-reader.h>
+#include <codeslayer/codeslayer-search-exclude.h>
+#include <codeslayer/codeslayer-search-ignore.h>
+#include <codeslayer/codeslayer-search-visited.h>
 
 /**
  * SECTION:codeslayer-document-search
@@ -37,8 +42,21 @@ static void write_indexes                          (CodeSlayerDocumentSearch
 static void write_project_indexes                  (CodeSlayerProject             *project, 
                                                     GFile                         *file, 
                                                     GIOChannel                    *channel,
-                                                    GList                         *exclude_types,
-                                                    GList                         *exclude_dirs);
+                                                    CodeSlayerSearchExclude       *exclude,
+                                                    CodeSlayerSearchVisited       *visited,
+                                                    gboolean                       use_ignore_files,
+                                                    CodeSlayerSearchIgnore        *parent_ignore,
+                                                    CodeSlayerSearchReader        *reader,
+                                                    GCancellable                  *cancellable);
+static void write_index_line                       (GIOChannel                    *channel,
+                                                    const gchar                   *file_name,
+                                                    const gchar                   *file_path,
+                                                    gboolean                       binary);
+static void read_binary_file                       (guint                          index,
+                                                    const gchar                   *contents,
+                                                    gssize                         length,
+                                                    gboolean                      *binaries);
+static void cancel_index_files                     (CodeSlayerDocumentSearch      *search);
                             
 #define CODESLAYER_DOCUMENT_SEARCH_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), CODESLAYER_DOCUMENT_SEARCH_TYPE, CodeSlayerDocumentSearchPrivate))
@@ -52,6 +70,8 @@ struct _CodeSlayerDocumentSearchPrivate
   CodeSlayerProjects             *projects;
   CodeSlayerRegistry             *registry;
   CodeSlayerDocumentSearchDialog *dialog;
+  GCancellable                   *cancellable;
+  GThread                        *thread;
 };
 
 G_DEFINE_TYPE (CodeSlayerDocumentSearch, codeslayer_document_search, G_TYPE_OBJECT)
@@ -70,6 +90,8 @@ codeslayer_document_search_init (CodeSlayerDocumentSearch *search)
   CodeSlayerDocumentSearchPrivate *priv;
   priv = CODESLAYER_DOCUMENT_SEARCH_GET_PRIVATE (search);
   priv->dialog = NULL;
+  priv->cancellable = NULL;
+  priv->thread = NULL;
 }
 
 static void
@@ -77,6 +99,7 @@ codeslayer_document_search_finalize (CodeSlayerDocumentSearch *search)
 {
   CodeSlayerDocumentSearchPrivate *priv;
   priv = CODESLAYER_DOCUMENT_SEARCH_GET_PRIVATE (search);
+  cancel_index_files (search);
   if (priv->dialog != NULL)
     g_object_unref (priv->dialog);
   G_OBJECT_CLASS (codeslayer_document_search_parent_class)->finalize (G_OBJECT(search));
@@ -119,11 +142,20 @@ codeslayer_document_search_new (GtkWindow          *window,
 /**
  * codeslayer_document_search_index_files:
  * @search: a #CodeSlayerDocumentSearch.
+ *
+ * Writes the index in the background. An index that is still being
+ * written is cancelled first.
  */
 void
 codeslayer_document_search_index_files (CodeSlayerDocumentSearch *search)
 {
-  g_thread_new ("index files", (GThreadFunc) execute, search); 
+  CodeSlayerDocumentSearchPrivate *priv;
+  priv = CODESLAYER_DOCUMENT_SEARCH_GET_PRIVATE (search);
+  
+  cancel_index_files (search);
+  
+  priv->cancellable = g_cancellable_new ();
+  priv->thread = g_thread_new ("index files", (GThreadFunc) execute, search); 
 }
 
 /**
@@ -142,6 +174,35 @@ codeslayer_document_search_run_dialog (CodeSlayerDocumentSearch *search)
   codeslayer_document_search_dialog_run  (priv->dialog);
 }
 
+/*
+ * Uses the same check as the project search, a nul byte in the first 
+ * block of the file. A file that can not be read is not a binary.
+ */
+static void
+read_binary_file (guint        index,
+                  const gchar *contents,
+                  gssize       length,
+                  gboolean    *binaries)
+{
+  binaries[index] = contents != NULL && codeslayer_search_policy_is_binary (contents, length);
+}
+
+static void
+cancel_index_files (CodeSlayerDocumentSearch *search)
+{
+  CodeSlayerDocumentSearchPrivate *priv;
+  priv = CODESLAYER_DOCUMENT_SEARCH_GET_PRIVATE (search);
+
+  if (priv->cancellable == NULL)
+    return;
+
+  g_cancellable_cancel (priv->cancellable);
+  g_thread_join (priv->thread);
+  g_object_unref (priv->cancellable);
+  priv->cancellable = NULL;
+  priv->thread = NULL;
+}
+
 static void
 execute (CodeSlayerDocumentSearch *search)
 {
@@ -177,110 +238,216 @@ write_indexes (CodeSlayerDocumentSearch *search,
 {
   CodeSlayerDocumentSearchPrivate *priv;
   GList *projects;
+  GList *folder_paths = NULL;
   GList *list;
   
-  gchar *exclude_types_str;
-  gchar *exclude_dirs_str;
-  GList *exclude_types = NULL;
-  GList *exclude_dirs = NULL;
+  CodeSlayerSearchExclude *exclude;
+  CodeSlayerSearchVisited *visited;
+
+  CodeSlayerSearchReader *reader;
+  gboolean use_uring;
+  gboolean show_ignored;
   
   priv = CODESLAYER_DOCUMENT_SEARCH_GET_PRIVATE (search);
   
-  exclude_types_str = codeslayer_registry_get_string (priv->registry,
-                                                      CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_TYPES);
-  exclude_dirs_str = codeslayer_registry_get_string (priv->registry,
-                                                     CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_DIRS);
-  exclude_types = codeslayer_utils_string_to_list (exclude_types_str);
-  exclude_dirs = codeslayer_utils_string_to_list (exclude_dirs_str);
+  exclude = codeslayer_registry_get_exclude (priv->registry);
+
+  use_uring = codeslayer_registry_get_boolean (priv->registry,
+                                               CODESLAYER_REGISTRY_PROJECTS_SEARCH_IO_URING);
+  reader = codeslayer_search_reader_new (use_uring);
+
+  show_ignored = codeslayer_registry_get_boolean (priv->registry,
+                                                  CODESLAYER_REGISTRY_PROJECTS_SHOW_IGNORED);
   
   projects = codeslayer_profile_get_projects (priv->profile);
+
+  /* a folder shared by projects is written once, by the innermost one */
+  for (list = projects; list != NULL; list = g_list_next (list))
+    folder_paths = g_list_prepend (folder_paths, 
+                                   (gpointer) codeslayer_project_get_folder_path (list->data));
+  visited = codeslayer_search_visited_new (folder_paths);
+  g_list_free (folder_paths);
+
   list = projects;
   while (list != NULL)
     {
       CodeSlayerProject *project = list->data;
-      GFile *file;
       const gchar *folder_path;
       
       folder_path = codeslayer_project_get_folder_path (project);
-      file = g_file_new_for_path (folder_path);
-      
-      write_project_indexes (project, file, channel, exclude_types, exclude_dirs);
-        
-      g_object_unref (file);
+
+      if (codeslayer_search_visited_add_folder (visited, folder_path))
+        {
+          GFile *file;
+          file = g_file_new_for_path (folder_path);
+          write_project_indexes (project, file, channel, exclude, visited,
+                                 !show_ignored, NULL, reader, priv->cancellable);
+          g_object_unref (file);
+        }
+
+      if (g_cancellable_is_cancelled (priv->cancellable))
+        break;
 
       list = g_list_next (list);
     }
   g_list_free (projects);    
+  codeslayer_search_visited_free (visited);
+  codeslayer_search_reader_free (reader);
     
-  g_free (exclude_types_str);
-  g_free (exclude_dirs_str);
-  if (exclude_types)
-    {
-      g_list_foreach (exclude_types, (GFunc) g_free, NULL);
-      g_list_free (exclude_types);
-    }
-  if (exclude_dirs)
-    {
-      g_list_foreach (exclude_dirs, (GFunc) g_free, NULL);
-      g_list_free (exclude_dirs);
-    }    
+  codeslayer_search_exclude_unref (exclude);
 }
 
+/*
+ * The directory is listed first so the start of all of its files can 
+ * be read in batches, then written out in the order it was listed. 
+ * The excluded and ignored files are dropped while it is listed.
+ */
 static void
-write_project_indexes (CodeSlayerProject *project, 
-                       GFile             *file,
-                       GIOChannel        *channel,
-                       GList             *exclude_types,
-                       GList             *exclude_dirs)
+write_project_indexes (CodeSlayerProject       *project, 
+                       GFile                   *file,
+                       GIOChannel              *channel,
+                       CodeSlayerSearchExclude *exclude,
+                       CodeSlayerSearchVisited *visited,
+                       gboolean                 use_ignore_files,
+                       CodeSlayerSearchIgnore  *parent_ignore,
+                       CodeSlayerSearchReader  *reader,
+                       GCancellable            *cancellable)
 {
   GFileEnumerator *enumerator;
   
-  enumerator = g_file_enumerate_children (file, "standard::*",
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+  
+  enumerator = g_file_enumerate_children (file, "standard::*,unix::device,unix::inode,unix::nlink",
                                           G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, 
-                                          NULL, NULL);
+                                          cancellable, NULL);
                                                                   
   if (enumerator != NULL)
     {
+      CodeSlayerSearchIgnore *ignore = NULL;
       GFileInfo *file_info;
-      while ((file_info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
+      GPtrArray *file_infos;
+      GPtrArray *file_paths;
+      GArray *limits;
+      gboolean *binaries;
+      gchar *folder_path;
+      gsize limit = CODESLAYER_SEARCH_POLICY_BLOCK_SIZE;
+      guint n_files = 0;
+      guint i;
+
+      folder_path = g_file_get_path (file);
+      if (use_ignore_files)
+        ignore = codeslayer_search_ignore_new (parent_ignore, folder_path);
+
+      file_infos = g_ptr_array_new_with_free_func (g_object_unref);
+      file_paths = g_ptr_array_new_with_free_func (g_free);
+      limits = g_array_new (FALSE, FALSE, sizeof (gsize));
+
+      while ((file_info = g_file_enumerator_next_file (enumerator, cancellable, NULL)) != NULL)
         {
-          GFile *child;
-        
           const char *file_name = g_file_info_get_name (file_info);
 
-          child = g_file_get_child (file, file_name);
-
           if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY)
             {
-              if (!codeslayer_utils_contains_element (exclude_dirs, file_name))
-                write_project_indexes (project, child, channel, exclude_types, exclude_dirs);            
+              if (codeslayer_search_visited_is_project_folder (visited, folder_path, file_name)
+                  || codeslayer_search_exclude_is_excluded_dir (exclude, file_name)
+                  || codeslayer_search_ignore_is_ignored (ignore, folder_path, file_name, TRUE)
+                  || !codeslayer_search_visited_add (visited, file_info))
+                {
+                  g_object_unref (file_info);
+                  continue;
+                }
             }
           else
             {
-              if (!codeslayer_utils_contains_element_with_suffix (exclude_types, file_name))
+              if (codeslayer_search_exclude_is_excluded_file (exclude, file_name)
+                  || codeslayer_search_ignore_is_ignored (ignore, folder_path, file_name, FALSE)
+                  || !codeslayer_search_visited_add (visited, file_info))
+                {
+                  g_object_unref (file_info);
+                  continue;
+                }
+
+              /* a fifo or a device would block the open, only files are read */
+              if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_REGULAR)
                 {
-                  gchar *file_path;
-                  GIOStatus status;
-                  gchar *line;
-                  
-                  file_path = g_file_get_path (child);
-                  
-                  line = g_strdup_printf ("%s\t%s\n", file_name, file_path);
-                  
-                  status = g_io_channel_write_chars (channel, line, -1, NULL, NULL);
-
-                  if (status != G_IO_STATUS_NORMAL)
-                    g_warning ("Error writing to file documentsearch file.");
-                  
-                  g_free (line);
-                  g_free (file_path);
+                  g_ptr_array_add (file_paths, g_build_filename (folder_path, file_name, NULL));
+                  g_array_append_val (limits, limit);
                 }
             }
 
-          g_object_unref(child);
-          g_object_unref (file_info);
+          g_ptr_array_add (file_infos, file_info);
+        }
+
+      binaries = g_new0 (gboolean, MAX (file_paths->len, 1));
+      if (file_paths->len > 0 && !g_cancellable_is_cancelled (cancellable))
+        codeslayer_search_reader_read (reader, (const gchar * const *) file_paths->pdata, 
+                                       (const gsize *) limits->data, file_paths->len, 
+                                       (CodeSlayerSearchReaderFunc) read_binary_file, 
+                                       binaries);
+
+      for (i = 0; i < file_infos->len; i++)
+        {
+          const char *file_name;
+
+          file_info = g_ptr_array_index (file_infos, i);
+          file_name = g_file_info_get_name (file_info);
+
+          if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY)
+            {
+              GFile *child;
+              child = g_file_get_child (file, file_name);
+              write_project_indexes (project, child, channel, exclude, visited,
+                                     use_ignore_files, ignore, reader, cancellable);
+              g_object_unref (child);
+            }
+          else if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_REGULAR)
+            {
+              write_index_line (channel, file_name, g_ptr_array_index (file_paths, n_files), 
+                                binaries[n_files]);
+              n_files++;
+            }
+          else
+            {
+              gchar *file_path;
+              file_path = g_build_filename (folder_path, file_name, NULL);
+              write_index_line (channel, file_name, file_path, FALSE);
+              g_free (file_path);
+            }
         }
+
+      g_free (binaries);
+      g_array_free (limits, TRUE);
+      g_ptr_array_free (file_paths, TRUE);
+      g_ptr_array_free (file_infos, TRUE);
+      codeslayer_search_ignore_unref (ignore);
+      g_free (folder_path);
       g_io_channel_flush (channel, NULL);
       g_object_unref (enumerator);
     }
 }
+
+/*
+ * Binaries are tagged with a third field.
+ */
+static void
+write_index_line (GIOChannel  *channel,
+                  const gchar *file_name,
+                  const gchar *file_path,
+                  gboolean     binary)
+{
+  GIOStatus status;
+  gchar *line;
+
+  if (binary)
+    line = g_strdup_printf ("%s\t%s\tbinary\n", file_name, file_path);
+  else
+    line = g_strdup_printf ("%s\t%s\n", file_name, file_path);
+
+  status = g_io_channel_write_chars (channel, line, -1, NULL, NULL);
+
+  if (status != G_IO_STATUS_NORMAL)
+    g_warning ("Error writing to file documentsearch file.");
+
+  g_free (line);
+}
@@ -61,6 +61,8 @@ struct _CodeSlayerDocumentPrivate
   gchar               *name;
   gchar               *file_path;
   gint                 line_number;
+  gint                 match_offset;
+  gint                 match_length;
   CodeSlayerProject   *project;
   GtkSourceView       *source_view;
   GtkTreeRowReference *tree_row_reference;
@@ -74,6 +76,8 @@ enum
   PROP_NAME,
   PROP_FILE_PATH,
   PROP_LINE_NUMBER,
+  PROP_MATCH_OFFSET,
+  PROP_MATCH_LENGTH,
   PROP_PROJECT,
   PROP_SOURCE_VIEW,
   PROP_TREE_ROW_REFERENCE
@@ -128,6 +132,32 @@ codeslayer_document_class_init (CodeSlayerDocumentClass *klass)
                                                      0, 100000, 0,
                                                      G_PARAM_READWRITE));
 
+  /**
+   * CodeSlayerDocument:match_offset:
+   *
+   * The byte offset into the line of the text to select.
+   */
+  g_object_class_install_property (gobject_class, 
+                                   PROP_MATCH_OFFSET,
+                                   g_param_spec_int ("match_offset",
+                                                     "Match Offset",
+                                                     "Match Offset", 
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READWRITE));
+
+  /**
+   * CodeSlayerDocument:match_length:
+   *
+   * The number of bytes to select, nothing is selected when it is 0.
+   */
+  g_object_class_install_property (gobject_class, 
+                                   PROP_MATCH_LENGTH,
+                                   g_param_spec_int ("match_length",
+                                                     "Match Length",
+                                                     "Match Length", 
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READWRITE));
+
   /**
    * CodeSlayerDocument:project:
    *
@@ -220,6 +250,12 @@ codeslayer_document_get_property (GObject    *object,
     case PROP_LINE_NUMBER:
       g_value_set_int (value, priv->line_number);
       break;
+    case PROP_MATCH_OFFSET:
+      g_value_set_int (value, priv->match_offset);
+      break;
+    case PROP_MATCH_LENGTH:
+      g_value_set_int (value, priv->match_length);
+      break;
     case PROP_PROJECT:
       g_value_set_pointer (value, priv->project);
       break;
@@ -255,6 +291,15 @@ codeslayer_document_set_property (GObject      *object,
     case PROP_LINE_NUMBER:
       codeslayer_document_set_line_number (document, g_value_get_int (value));
       break;
+    case PROP_MATCH_OFFSET:
+      codeslayer_document_set_match_range (document, g_value_get_int (value),
+                                           codeslayer_document_get_match_length (document));
+      break;
+    case PROP_MATCH_LENGTH:
+      codeslayer_document_set_match_range (document, 
+                                           codeslayer_document_get_match_offset (document),
+                                           g_value_get_int (value));
+      break;
     case PROP_PROJECT:
       codeslayer_document_set_project (document, CODESLAYER_PROJECT (value));
       break;
@@ -381,6 +426,50 @@ codeslayer_document_set_line_number (CodeSlayerDocument *document,
   priv->line_number = line_number;
 }
 
+/**
+ * codeslayer_document_get_match_offset:
+ * @document: a #CodeSlayerDocument.
+ *
+ * Returns: the byte offset into the line of the text to select.
+ */
+const gint
+codeslayer_document_get_match_offset (CodeSlayerDocument *document)
+{
+  return CODESLAYER_DOCUMENT_GET_PRIVATE (document)->match_offset;
+}
+
+/**
+ * codeslayer_document_get_match_length:
+ * @document: a #CodeSlayerDocument.
+ *
+ * Returns: the number of bytes to select, or 0 to only scroll to the line.
+ */
+const gint
+codeslayer_document_get_match_length (CodeSlayerDocument *document)
+{
+  return CODESLAYER_DOCUMENT_GET_PRIVATE (document)->match_length;
+}
+
+/**
+ * codeslayer_document_set_match_range:
+ * @document: a #CodeSlayerDocument.
+ * @match_offset: the byte offset into the line of the text to select.
+ * @match_length: the number of bytes to select.
+ *
+ * Selects the text on the line number when the document is loaded into 
+ * the source view, such as a hit of the project search.
+ */
+void
+codeslayer_document_set_match_range (CodeSlayerDocument *document,
+                                     const gint          match_offset,
+                                     const gint          match_length)
+{
+  CodeSlayerDocumentPrivate *priv;
+  priv = CODESLAYER_DOCUMENT_GET_PRIVATE (document);
+  priv->match_offset = match_offset;
+  priv->match_length = match_length;
+}
+
 /**
  * codeslayer_document_get_project:
  * @document: a #CodeSlayerDocument.
@@ -55,6 +55,11 @@ void                 codeslayer_document_set_file_path           (CodeSlayerDocu
 const gint           codeslayer_document_get_line_number         (CodeSlayerDocument  *document);
 void                 codeslayer_document_set_line_number         (CodeSlayerDocument  *document, 
                                                                   const gint          line_number);
+const gint           codeslayer_document_get_match_offset        (CodeSlayerDocument  *document);
+const gint           codeslayer_document_get_match_length        (CodeSlayerDocument  *document);
+void                 codeslayer_document_set_match_range         (CodeSlayerDocument  *document, 
+                                                                  const gint          match_offset,
+                                                                  const gint          match_length);
 CodeSlayerProject*   codeslayer_document_get_project             (CodeSlayerDocument  *document);
 void                 codeslayer_document_set_project             (CodeSlayerDocument  *document, 
                                                                   CodeSlayerProject   *project);
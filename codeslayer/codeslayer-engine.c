@@ -17,11 +17,14 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <codeslayer/codeslayer-engine.h>
 #include <codeslayer/codeslayer-utils.h>
 #include <codeslayer/codeslayer-document.h>
 #include <codeslayer/codeslayer-projects.h>
 #include <codeslayer/codeslayer-projects-search.h>
+#include <codeslayer/codeslayer-search-replace.h>
+#include <codeslayer/codeslayer-search-stats.h>
 #include <codeslayer/codeslayer-menubar.h>
 #include <codeslayer/codeslayer-profiles-manager.h>
 #include <codeslayer/codeslayer-profile.h>
@@ -108,6 +111,10 @@ static void select_search_document_action   (CodeSlayerEngine      *engine,
 static void rename_file_path_action         (CodeSlayerEngine      *engine,
                                              gchar                 *file_path,
                                              gchar                 *renamed_file_path);
+static void replace_files_action            (CodeSlayerEngine        *engine,
+                                             CodeSlayerSearchReplace *replace);
+static void search_finished_action          (CodeSlayerEngine        *engine,
+                                             CodeSlayerSearchStats   *stats);
                                              
 static void load_regular_expression         (CodeSlayerEngine      *engine);
 static void load_window_settings            (CodeSlayerEngine      *engine);
@@ -1326,13 +1333,37 @@ search_find_projects_action (CodeSlayerEngine *engine,
   if (priv->search == NULL)
     {
       priv->search = codeslayer_projects_search_new (priv->window, 
-                                                     priv->profile);
+                                                     priv->profile,
+                                                     priv->notebook);
 
       g_signal_connect_swapped (G_OBJECT (priv->search), "close",
                                 G_CALLBACK (close_search_action), engine);
                         
       g_signal_connect_swapped (G_OBJECT (priv->search), "select-document",
                                 G_CALLBACK (select_search_document_action), engine);
+
+      g_signal_connect_swapped (G_OBJECT (priv->search), "files-replaced",
+                                G_CALLBACK (replace_files_action), engine);
+
+      g_signal_connect_swapped (G_OBJECT (priv->search), "search-finished",
+                                G_CALLBACK (search_finished_action), engine);
+
+      /* the hits of the last search are no good once files change */
+      g_signal_connect_object (G_OBJECT (priv->notebook), "document-saved",
+                               G_CALLBACK (codeslayer_projects_search_clear_cache), 
+                               priv->search, G_CONNECT_SWAPPED);
+
+      g_signal_connect_object (G_OBJECT (priv->notebook), "documents-all-saved",
+                               G_CALLBACK (codeslayer_projects_search_clear_cache), 
+                               priv->search, G_CONNECT_SWAPPED);
+
+      g_signal_connect_object (G_OBJECT (priv->projects), "projects-changed",
+                               G_CALLBACK (codeslayer_projects_search_clear_cache), 
+                               priv->search, G_CONNECT_SWAPPED);
+
+      g_signal_connect_object (G_OBJECT (priv->projects), "file-path-renamed",
+                               G_CALLBACK (codeslayer_projects_search_clear_cache), 
+                               priv->search, G_CONNECT_SWAPPED);
     }
     
   if (!gtk_widget_get_visible (priv->search))
@@ -1433,6 +1464,9 @@ scan_external_changes_action (CodeSlayerEngine *engine)
   priv = CODESLAYER_ENGINE_GET_PRIVATE (engine);
 
   codeslayer_projects_refresh (CODESLAYER_PROJECTS (priv->projects));
+
+  if (priv->search != NULL)
+    codeslayer_projects_search_clear_cache (CODESLAYER_PROJECTS_SEARCH (priv->search));
   
   pages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (priv->notebook));
 
@@ -1466,6 +1500,114 @@ scan_external_changes_action (CodeSlayerEngine *engine)
   g_signal_emit_by_name ((gpointer) priv->projects, "projects-changed");
 }
 
+/*
+ * The plugins hear about the search through the projects.
+ */
+static void
+search_finished_action (CodeSlayerEngine      *engine,
+                        CodeSlayerSearchStats *stats)
+{
+  CodeSlayerEnginePrivate *priv;
+  priv = CODESLAYER_ENGINE_GET_PRIVATE (engine);
+  g_signal_emit_by_name ((gpointer) priv->projects, "search-finished", stats);
+}
+
+/*
+ * The replace wrote the files behind the back of the open documents. A 
+ * document gets the same replacements in its buffer, which keeps any 
+ * changes that were not saved, and takes the new time of the file so 
+ * it is not taken for an external change. Only the hits are changed, 
+ * so the marks, the bookmarks and the scroll position stay where they 
+ * were, and the whole replace is one step to undo.
+ */
+static void
+replace_files_action (CodeSlayerEngine        *engine,
+                      CodeSlayerSearchReplace *replace)
+{
+  CodeSlayerEnginePrivate *priv;
+  gint pages;
+  gint page;
+  
+  priv = CODESLAYER_ENGINE_GET_PRIVATE (engine);
+
+  pages = gtk_notebook_get_n_pages (GTK_NOTEBOOK (priv->notebook));
+
+  for (page = 0; page < pages; page++)
+    {
+      GtkWidget *notebook_page;
+      GtkWidget *source_view;
+      CodeSlayerDocument *document;
+      CodeSlayerSearchReplaceFile *file;
+      GtkTextBuffer *buffer;
+      GtkTextIter start, end;
+      const gchar *file_path;
+      gboolean modified;
+      GArray *edits;
+      gchar *text;
+      
+      notebook_page = gtk_notebook_get_nth_page (GTK_NOTEBOOK (priv->notebook), page);
+      source_view = codeslayer_notebook_page_get_source_view (CODESLAYER_NOTEBOOK_PAGE (notebook_page));
+      document = codeslayer_source_view_get_document (CODESLAYER_SOURCE_VIEW (source_view));
+      file_path = codeslayer_document_get_file_path (document);
+      
+      if (file_path == NULL)
+        continue;
+
+      file = codeslayer_search_replace_find_file (replace, file_path);
+      if (file == NULL || !codeslayer_search_replace_file_get_written (file))
+        continue;
+
+      buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+      modified = gtk_text_buffer_get_modified (buffer);
+
+      /* the slice has a character for every position of the buffer */
+      gtk_text_buffer_get_bounds (buffer, &start, &end);
+      text = gtk_text_buffer_get_slice (buffer, &start, &end, TRUE);
+      edits = codeslayer_search_replace_get_edits (replace, text, strlen (text));
+
+      if (edits->len > 0)
+        {
+          gint *offsets;
+          const gchar *pos = text;
+          glong offset = 0;
+          guint i;
+
+          offsets = g_new (gint, edits->len * 2);
+
+          for (i = 0; i < edits->len; i++)
+            {
+              CodeSlayerSearchReplaceEdit *edit;
+              edit = &g_array_index (edits, CodeSlayerSearchReplaceEdit, i);
+              offset += g_utf8_pointer_to_offset (pos, text + edit->offset);
+              pos = text + edit->offset;
+              offsets[i * 2] = offset;
+              offsets[i * 2 + 1] = offset + g_utf8_strlen (pos, edit->length);
+            }
+
+          /* from the back, so the offsets of the hits before stay good */
+          gtk_text_buffer_begin_user_action (buffer);
+          for (i = edits->len; i-- > 0;)
+            {
+              CodeSlayerSearchReplaceEdit *edit;
+              edit = &g_array_index (edits, CodeSlayerSearchReplaceEdit, i);
+              gtk_text_buffer_get_iter_at_offset (buffer, &start, offsets[i * 2]);
+              gtk_text_buffer_get_iter_at_offset (buffer, &end, offsets[i * 2 + 1]);
+              gtk_text_buffer_delete (buffer, &start, &end);
+              gtk_text_buffer_insert (buffer, &start, edit->text, -1);
+            }
+          gtk_text_buffer_end_user_action (buffer);
+
+          gtk_text_buffer_set_modified (buffer, modified);
+          g_free (offsets);
+        }
+
+      codeslayer_source_view_set_modification_time (CODESLAYER_SOURCE_VIEW (source_view), 
+                                                    codeslayer_utils_get_modification_time (file_path));
+      g_array_unref (edits);
+      g_free (text);
+    }
+}
+
 static void
 rename_file_path_action (CodeSlayerEngine *engine, 
                          gchar            *file_path,
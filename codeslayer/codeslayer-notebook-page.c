@@ -266,7 +266,12 @@ codeslayer_notebook_page_load_source_view (CodeSlayerNotebookPage *notebook_page
   codeslayer_source_view_set_modification_time (CODESLAYER_SOURCE_VIEW (priv->source_view), modification_time);
   
   if (line_number > 0)
-    codeslayer_source_view_scroll_to_line (CODESLAYER_SOURCE_VIEW (priv->source_view), line_number);
+    codeslayer_source_view_select_match (CODESLAYER_SOURCE_VIEW (priv->source_view), line_number,
+                                         codeslayer_document_get_match_offset (document),
+                                         codeslayer_document_get_match_length (document));
+
+  /* a reload of the file should not select the old match again */
+  codeslayer_document_set_match_range (document, 0, 0);
 }
 
 /**
@@ -315,7 +315,9 @@ codeslayer_notebook_select_document (CodeSlayerNotebook *notebook,
             {
               GtkWidget *source_view;
               source_view = codeslayer_notebook_page_get_source_view (CODESLAYER_NOTEBOOK_PAGE (notebook_page));
-              codeslayer_source_view_scroll_to_line (CODESLAYER_SOURCE_VIEW (source_view), line_number);
+              codeslayer_source_view_select_match (CODESLAYER_SOURCE_VIEW (source_view), line_number,
+                                                   codeslayer_document_get_match_offset (document),
+                                                   codeslayer_document_get_match_length (document));
             }
 
           return TRUE;
@@ -230,17 +230,22 @@ load_profile (CodeSlayerProfile *profile,
               CodeSlayerProject *project;
               xmlChar *name;
               xmlChar *folder_path;
+              xmlChar *skip_types;
               
               name = xmlGetProp (cur_node, (const xmlChar*)"name");
               folder_path = xmlGetProp (cur_node, (const xmlChar*)"folder_path");
+              skip_types = xmlGetProp (cur_node, (const xmlChar*)"skip_types");
               
               project = codeslayer_project_new ();
               codeslayer_project_set_name (project, (gchar*) name);
               codeslayer_project_set_folder_path (project, (gchar*) folder_path);
+              codeslayer_project_set_skip_types (project, (gchar*) skip_types);
               codeslayer_profile_add_project (profile, project);
               
               xmlFree (name);
               xmlFree (folder_path);
+              if (skip_types != NULL)
+                xmlFree (skip_types);
             }
           else if (g_strcmp0 ((gchar*)cur_node->name, "document") == 0)
             {
@@ -306,9 +311,11 @@ build_projects_xml (CodeSlayerProject *project,
 {
   const gchar *name;
   const gchar *folder_path;
+  const gchar *skip_types;
   
   name = codeslayer_project_get_name (project);
   folder_path = codeslayer_project_get_folder_path (project);
+  skip_types = codeslayer_project_get_skip_types (project);
 
   *xml = g_string_append (*xml, "\n\t\t<project ");
   *xml = g_string_append (*xml, "name=\"");
@@ -316,7 +323,14 @@ build_projects_xml (CodeSlayerProject *project,
   *xml = g_string_append (*xml, "\" ");
   *xml = g_string_append (*xml, "folder_path=\"");
   *xml = g_string_append (*xml, folder_path);
-  *xml = g_string_append (*xml, "\"/>");
+  *xml = g_string_append (*xml, "\"");
+  if (skip_types != NULL && *skip_types != '\0')
+    {
+      *xml = g_string_append (*xml, " skip_types=\"");
+      *xml = g_string_append (*xml, skip_types);
+      *xml = g_string_append (*xml, "\"");
+    }
+  *xml = g_string_append (*xml, "/>");
 }
 
 static void 
@@ -402,6 +416,13 @@ set_profile_registry_defaults (CodeSlayerProfile *profile)
   codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_SIDE_PANE_TAB_POSITION, "top");
   codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_BOTTOM_PANE_TAB_POSITION, "left");
   codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_DIRS, ".csv,.git,.svn");
+  codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_SHOW_IGNORED, "false");
+  codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_SEARCH_THREADS, "0");
+  codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_SEARCH_MAX_FILE_SIZE, "10240");
+  codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_SEARCH_INDEX, "true");
+  codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_SEARCH_IO_URING, "false");
+  codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_SEARCH_STATS_LOG, "false");
+  codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_PROJECTS_SEARCH_PREVIEW_LINES, "3");
   codeslayer_registry_set_setting (registry, CODESLAYER_REGISTRY_WORD_WRAP_TYPES, ".txt");
 }
 
@@ -46,13 +46,15 @@ struct _CodeSlayerProjectPrivate
 {
   gchar *name;
   gchar *folder_path;
+  gchar *skip_types;
 };
 
 enum
 {
   PROP_0,
   PROP_NAME,
-  PROP_FOLDER_PATH
+  PROP_FOLDER_PATH,
+  PROP_SKIP_TYPES
 };
 
 G_DEFINE_TYPE (CodeSlayerProject, codeslayer_project, G_TYPE_OBJECT)
@@ -93,6 +95,19 @@ codeslayer_project_class_init (CodeSlayerProjectClass *klass)
                                                         "Folder Path",
                                                         "",
                                                         G_PARAM_READWRITE));
+
+  /**
+   * CodeSlayerProject:skip_types:
+   *
+   * The file extensions that the search skips in this project.
+   */
+  g_object_class_install_property (gobject_class, 
+                                   PROP_SKIP_TYPES,
+                                   g_param_spec_string ("skip_types",
+                                                        "Skip Types",
+                                                        "Skip Types",
+                                                        "",
+                                                        G_PARAM_READWRITE));
 }
 
 static void
@@ -102,6 +117,7 @@ codeslayer_project_init (CodeSlayerProject *project)
   priv = CODESLAYER_PROJECT_GET_PRIVATE (project);
   priv->name = NULL;
   priv->folder_path = NULL;
+  priv->skip_types = NULL;
 }
 
 static void
@@ -119,6 +135,11 @@ codeslayer_project_finalize (CodeSlayerProject *project)
       g_free (priv->folder_path);
       priv->folder_path = NULL;
     }
+  if (priv->skip_types)
+    {
+      g_free (priv->skip_types);
+      priv->skip_types = NULL;
+    }
   G_OBJECT_CLASS (codeslayer_project_parent_class)->finalize (G_OBJECT (project));
 }
 
@@ -142,6 +163,9 @@ codeslayer_project_get_property (GObject    *object,
     case PROP_FOLDER_PATH:
       g_value_set_string (value, priv->folder_path);
       break;
+    case PROP_SKIP_TYPES:
+      g_value_set_string (value, priv->skip_types);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -165,6 +189,9 @@ codeslayer_project_set_property (GObject      *object,
     case PROP_FOLDER_PATH:
       codeslayer_project_set_folder_path (project, g_value_get_string (value));
       break;
+    case PROP_SKIP_TYPES:
+      codeslayer_project_set_skip_types (project, g_value_get_string (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -247,3 +274,36 @@ codeslayer_project_set_folder_path (CodeSlayerProject *project,
     }
   priv->folder_path = g_strdup (folder_path);
 }
+
+/**
+ * codeslayer_project_get_skip_types:
+ * @project: a #CodeSlayerProject.
+ *
+ * Returns: the file extensions that the search skips as a comma 
+ *          separated list, or %NULL.
+ */
+const gchar *
+codeslayer_project_get_skip_types (CodeSlayerProject *project)
+{
+  return CODESLAYER_PROJECT_GET_PRIVATE (project)->skip_types;
+}
+
+/**
+ * codeslayer_project_set_skip_types:
+ * @project: a #CodeSlayerProject.
+ * @skip_types: the file extensions that the search skips as a comma 
+ *              separated list.
+ */
+void
+codeslayer_project_set_skip_types (CodeSlayerProject *project,
+                                   const gchar       *skip_types)
+{
+  CodeSlayerProjectPrivate *priv;
+  priv = CODESLAYER_PROJECT_GET_PRIVATE (project);
+  if (priv->skip_types)
+    {
+      g_free (priv->skip_types);
+      priv->skip_types = NULL;
+    }
+  priv->skip_types = g_strdup (skip_types);
+}
@@ -51,6 +51,9 @@ void               codeslayer_project_set_name         (CodeSlayerProject *proje
 const gchar*       codeslayer_project_get_folder_path  (CodeSlayerProject *project);
 void               codeslayer_project_set_folder_path  (CodeSlayerProject *project,
                                                         const gchar       *folder_path);
+const gchar*       codeslayer_project_get_skip_types   (CodeSlayerProject *project);
+void               codeslayer_project_set_skip_types   (CodeSlayerProject *project,
+                                                        const gchar       *skip_types);
 
 G_END_DECLS
 
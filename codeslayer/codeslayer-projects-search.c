@@ -17,12 +17,30 @@
  */
 
 #include <glib/gprintf.h>
+#include <stdio.h>
 #include <string.h>
 #include <codeslayer/codeslayer-projects-search.h>
 #include <codeslayer/codeslayer-preferences.h>
 #include <codeslayer/codeslayer-project.h>
 #include <codeslayer/codeslayer-document.h>
+#include <codeslayer/codeslayer-notebook.h>
 #include <codeslayer/codeslayer-utils.h>
+#include <codeslayer/codeslayer-search-pool.h>
+#include <codeslayer/codeslayer-search-scanner.h>
+#include <codeslayer/codeslayer-search-matcher.h>
+#include <codeslayer/codeslayer-search-queue.h>
+#include <codeslayer/codeslayer-search-policy.h>
+#include <codeslayer/codeslayer-search-index.h>
+#include <codeslayer/codeslayer-search-terms.h>
+#include <codeslayer/codeslayer-search-replace.h>
+#include <codeslayer/codeslayer-search-prefetch.h>
+#include <codeslayer/codeslayer-search-reader.h>
+#include <codeslayer/codeslayer-search-model.h>
+#include <codeslayer/codeslayer-search-stats.h>
+#include <codeslayer/codeslayer-search-preview.h>
+#include <codeslayer/codeslayer-search-ignore.h>
+#include <codeslayer/codeslayer-search-exclude.h>
+#include <codeslayer/codeslayer-search-visited.h>
 
 /**
  * SECTION:codeslayer-projects-search
@@ -33,13 +51,164 @@
  * The global search will find text in the files under the active profile.
  */
 
+/*
+ * Every folder and file a search looked at, with the size and the time 
+ * it had then. A refined search only checks the old hits again, so it 
+ * first makes sure that none of these changed and no file came or went.
+ */
+typedef struct
+{
+  const gchar *file_path;
+  gint64       mtime;
+  goffset      size;
+} SearchSeenFile;
+
+typedef struct
+{
+  GMutex        mutex;
+  GArray       *seen_files;
+  GStringChunk *text_chunk;
+} SearchSeen;
+
+typedef struct
+{
+  CodeSlayerProfile          *profile;
+  CodeSlayerSearchPool       *pool;
+  GPatternSpec               *find_pattern;
+  GPatternSpec               *file_pattern;
+  CodeSlayerSearchMatcher    *find_matcher;
+  GRegex                     *find_regex;
+  CodeSlayerSearchTerms      *find_terms;
+  CodeSlayerSearchQueue      *queue;
+  CodeSlayerSearchPolicy     *policy;
+  CodeSlayerSearchStats      *stats;
+  CodeSlayerSearchIndex      *index;
+  CodeSlayerSearchIndexQuery *index_query;
+  GHashTable                 *snapshots;
+  GHashTable                 *search_indexes;
+  const gchar                *file_paths;
+  gint                        threads;
+  gboolean                    use_index;
+  gboolean                    use_uring;
+  gboolean                    use_ignore_files;
+  GCancellable               *cancellable;
+  CodeSlayerProject          *project;
+  CodeSlayerSearchExclude    *exclude;
+  CodeSlayerSearchVisited    *visited;
+  SearchSeen                 *seen;
+  gboolean                    match_case;
+  gboolean                    find_contents;
+  gboolean                    full_lines;
+} SearchScan;
+
+typedef struct
+{
+  SearchScan             *scan;
+  GFile                  *file;
+  CodeSlayerSearchIgnore *ignore;
+} SearchTask;
+
+/*
+ * A file of a directory that passed the filters and has to be read.
+ */
+typedef struct
+{
+  gchar                       *file_path;
+  const gchar                 *file_name;
+  goffset                      size;
+  gint64                       mtime;
+  CodeSlayerSearchIndexResult  index_result;
+  gboolean                     read;
+} SearchCandidate;
+
+/*
+ * The small files of a directory that are read in batches.
+ */
+typedef struct
+{
+  SearchScan                 *scan;
+  GArray                     *candidates;
+  GArray                     *indexes;
+  GString                    *buffer;
+  CodeSlayerSearchStatsTimer *timer;
+} SearchRead;
+
+typedef struct _SearchFile SearchFile;
+typedef struct _SearchResult SearchResult;
+typedef struct _SearchCache SearchCache;
+typedef struct _SearchCacheFile SearchCacheFile;
+
+/*
+ * The hits of one file travel to the main loop in batches, so that a
+ * file with a lot of hits does not have to be held in memory at once.
+ * The results sit in one array and their text in one string chunk, so 
+ * a batch is built without an allocation per hit and freed in one go.
+ * The last batch of the search has no file and brings the policy and 
+ * the stats along, so the main loop can tell how many files were skipped 
+ * and where the time went.
+ */
+typedef struct
+{
+  SearchFile             *search_file;
+  GArray                 *search_results;
+  GStringChunk           *text_chunk;
+  CodeSlayerSearchPolicy *policy;
+  CodeSlayerSearchStats  *stats;
+  SearchSeen             *seen;
+  gboolean                first;
+  gboolean                last;
+} SearchBatch;
+
+typedef struct
+{
+  CodeSlayerProjectsSearch    *search;
+  CodeSlayerSearchQueue       *queue;
+  GCancellable                *cancellable;
+  CodeSlayerProject           *project;
+  GtkTreeIter                  project_iter;
+  CodeSlayerSearchStatsCounts  counts;
+} SearchStream;
+
+/*
+ * The consumer of a search from the command line. It has no main loop 
+ * so it waits for the queue to wake it up.
+ */
+typedef struct
+{
+  GMutex   mutex;
+  GCond    cond;
+  gboolean woken;
+} SearchGrep;
+
+/*
+ * The preview and the commit of a replace run on their own thread and 
+ * come back to the main loop when the files are done.
+ */
 typedef struct
 {
   CodeSlayerProjectsSearch  *search;
-  gchar             *label_name;
-  GList             *search_files;
-  CodeSlayerProject *project;
-} SearchContext;
+  CodeSlayerSearchReplace   *replace;
+  GCancellable              *cancellable;
+  gchar                    **file_paths;
+  guint                      written;
+  gboolean                   commit;
+} SearchReplace;
+
+typedef struct
+{
+  SearchScan                  *scan;
+  SearchFile                  *search_file;
+  SearchBatch                 *search_batch;
+  const gchar                 *file_path;
+  const gchar                 *file_name;
+  GString                     *line;
+  GArray                      *matches;
+  CodeSlayerSearchStatsCounts *counts;
+  CodeSlayerSearchIndexEntry  *index_entry;
+  gint64                       mtime;
+  goffset                      size;
+  gboolean                     closed;
+} SearchFileContext;
 
 static void codeslayer_projects_search_class_init  (CodeSlayerProjectsSearchClass *klass);
 static void codeslayer_projects_search_init        (CodeSlayerProjectsSearch      *search);
@@ -49,57 +218,202 @@ static gboolean on_delete_event                    (CodeSlayerProjectsSearch
 static void add_search_fields                      (CodeSlayerProjectsSearch      *search);
 static void add_more_options                       (CodeSlayerProjectsSearch      *search);
 static void add_results_window                     (CodeSlayerProjectsSearch      *search);
+static void add_preview                            (CodeSlayerProjectsSearch      *search);
+static void add_statistics                         (CodeSlayerProjectsSearch      *search);
 static void add_button_box                         (CodeSlayerProjectsSearch      *search);
 static void add_find_entry                         (CodeSlayerProjectsSearch      *search);
 static void add_file_entry                         (CodeSlayerProjectsSearch      *search);
 static void add_scope_combo_box                    (CodeSlayerProjectsSearch      *search);
 static void add_stop_button                        (CodeSlayerProjectsSearch      *search);
 static void add_match_case_button                  (CodeSlayerProjectsSearch      *search);
+static void add_regex_button                       (CodeSlayerProjectsSearch      *search);
+static void add_terms_button                       (CodeSlayerProjectsSearch      *search);
+static void add_load_terms_button                  (CodeSlayerProjectsSearch      *search);
+static void add_replace_entry                      (CodeSlayerProjectsSearch      *search);
 static void close_action                           (CodeSlayerProjectsSearch      *search);
 static void find_action                            (CodeSlayerProjectsSearch      *search);                                             
 static void stop_action                            (CodeSlayerProjectsSearch      *search);
+static void load_terms_action                      (CodeSlayerProjectsSearch      *search);
+static void replace_action                         (CodeSlayerProjectsSearch      *search);
+static gchar** get_result_file_paths               (CodeSlayerProjectsSearch      *search);
+static void start_replace                          (CodeSlayerProjectsSearch      *search,
+                                                    CodeSlayerSearchReplace       *replace,
+                                                    gchar                        **file_paths);
+static void execute_replace                        (SearchReplace                 *search_replace);
+static gboolean finish_replace                     (SearchReplace                 *search_replace);
+static void show_replaced                          (CodeSlayerProjectsSearch      *search,
+                                                    CodeSlayerSearchReplace       *replace,
+                                                    guint                          written);
+static void free_search_replace                    (SearchReplace                 *search_replace);
+static void cancel_replace                         (CodeSlayerProjectsSearch      *search);
+static gchar* get_find_settings                    (CodeSlayerProjectsSearch      *search);
+static gboolean run_replace_preview                (CodeSlayerProjectsSearch      *search,
+                                                    CodeSlayerSearchReplace       *replace);
+static void replace_toggled_action                 (GtkCellRendererToggle         *renderer,
+                                                    gchar                         *path,
+                                                    GtkTreeStore                  *treestore);
+static void set_busy                               (CodeSlayerProjectsSearch      *search,
+                                                    gboolean                       busy);
 static void match_case_action                      (CodeSlayerProjectsSearch      *search);
 static void scope_combo_box_changed                (CodeSlayerProjectsSearch      *search);
 static gboolean has_selection_scope                (CodeSlayerProjectsSearch      *search);
 static void execute                                (CodeSlayerProjectsSearch      *search);
-static void search_projects                        (CodeSlayerProjectsSearch      *search,
-                                                    GPatternSpec                  *find_pattern,
-                                                    GPatternSpec                  *file_pattern,
-                                                    GList                         *include_types,
-                                                    GList                         *exclude_dirs);
-static void create_search_files                    (CodeSlayerProjectsSearch      *search,
-                                                    GPatternSpec                  *find_pattern, 
-                                                    GPatternSpec                  *file_pattern, 
+static SearchScan* new_search_scan                 (CodeSlayerProfile             *profile,
+                                                    const gchar                   *find_text,
+                                                    const gchar                   *file_text,
+                                                    GRegex                        *find_regex,
+                                                    gboolean                       match_case,
+                                                    gboolean                       multiple_terms);
+static void free_search_scan                       (SearchScan                    *scan);
+static void run_search_scan                        (SearchScan                    *scan);
+static void search_projects                        (SearchScan                    *scan);
+static void push_search_task                       (SearchScan                    *scan,
                                                     GFile                         *file,
-                                                    GList                         **search_files, 
-                                                    GList                         *include_types,
-                                                    GList                         *exclude_dirs);
-static void create_search_results                  (CodeSlayerProjectsSearch      *search,
-                                                    GPatternSpec                  *find_pattern, 
-                                                    GPatternSpec                  *file_pattern, 
-                                                    GFile                         *file, 
-                                                    GList                         **search_files);
+                                                    CodeSlayerSearchIgnore        *ignore);
+static void create_search_files                    (SearchTask                    *task,
+                                                    SearchScan                    *scan);
+static GHashTable* take_snapshots                  (CodeSlayerProjectsSearch      *search);
+static gboolean create_search_candidate            (SearchScan                    *scan,
+                                                    const gchar                   *folder_path, 
+                                                    GFileInfo                     *file_info,
+                                                    GString                       *buffer,
+                                                    SearchCandidate               *candidate);
+static void create_search_results                  (SearchScan                    *scan,
+                                                    SearchCandidate               *candidate,
+                                                    gint                           fd,
+                                                    const gchar                   *contents,
+                                                    gsize                          length,
+                                                    GString                       *buffer);
+static void scan_search_candidates                 (SearchScan                    *scan,
+                                                    GArray                        *candidates,
+                                                    GString                       *buffer,
+                                                    CodeSlayerSearchStatsTimer    *timer);
+static void read_search_candidates                 (SearchScan                    *scan,
+                                                    GArray                        *candidates,
+                                                    GString                       *buffer,
+                                                    CodeSlayerSearchStatsTimer    *timer);
+static void read_search_candidate                  (guint                          index,
+                                                    const gchar                   *contents,
+                                                    gssize                         length,
+                                                    SearchRead                    *search_read);
+static CodeSlayerSearchIndex* get_search_index     (SearchScan                    *scan,
+                                                    CodeSlayerProject             *project);
+static void save_search_indexes                    (GHashTable                    *search_indexes);
+static gssize find_match                           (const gchar                   *text,
+                                                    gsize                          length,
+                                                    SearchFileContext             *context);
+static gssize find_regex_match                     (SearchScan                    *scan,
+                                                    const gchar                   *text,
+                                                    gsize                          length);
+static GRegex* create_regex                        (CodeSlayerProjectsSearch      *search);
+static GRegex* new_search_regex                    (const gchar                   *find_text,
+                                                    gboolean                       match_case,
+                                                    GError                       **error);
+static const gchar* insert_matched_terms           (SearchFileContext             *context,
+                                                    GStringChunk                  *text_chunk,
+                                                    const gchar                   *line,
+                                                    gsize                          length);
+static void add_search_result                      (const gchar                   *line,
+                                                    gsize                          length,
+                                                    gint                           line_number,
+                                                    goffset                        offset,
+                                                    SearchFileContext             *context);
+static void add_index_text                         (const gchar                   *text,
+                                                    gsize                          length,
+                                                    SearchFileContext             *context);
+static void find_result_match                      (SearchScan                    *scan,
+                                                    const gchar                   *line,
+                                                    gsize                          length,
+                                                    SearchResult                  *search_result);
+static void insert_result_text                     (GStringChunk                  *text_chunk,
+                                                    GString                       *buffer,
+                                                    const gchar                   *line,
+                                                    gsize                          length,
+                                                    SearchResult                  *search_result);
+static gchar* insert_valid_text                    (GStringChunk                  *text_chunk,
+                                                    const gchar                   *text,
+                                                    gsize                          length);
+static void push_search_batch                      (SearchFileContext             *context,
+                                                    gboolean                       last);
+static void free_search_batch                      (SearchBatch                   *search_batch);
+static void wake_search_stream                     (SearchStream                  *stream);
+static void wake_search_grep                       (SearchGrep                    *grep);
+static gboolean drain_search_stream                (SearchStream                  *stream);
+static void add_search_batch                       (SearchStream                  *stream,
+                                                    SearchBatch                   *search_batch);
+static void add_file_row                           (CodeSlayerProjectsSearch      *search,
+                                                    GtkTreeIter                   *project_iter,
+                                                    CodeSlayerProject             *project,
+                                                    const gchar                   *file_path,
+                                                    const gchar                   *file_name,
+                                                    gboolean                       has_results,
+                                                    GtkTreeIter                   *file_iter);
+static void add_result_row                         (CodeSlayerProjectsSearch      *search,
+                                                    GtkTreeIter                   *file_iter,
+                                                    SearchResult                  *search_result);
+static void finish_search_stream                   (SearchStream                  *stream);
+static void show_skipped                           (CodeSlayerProjectsSearch      *search,
+                                                    CodeSlayerSearchPolicy        *policy);
+static void show_stats                             (CodeSlayerProjectsSearch      *search,
+                                                    CodeSlayerSearchStats         *stats);
+static void write_stats                            (CodeSlayerProjectsSearch      *search,
+                                                    CodeSlayerSearchStats         *stats);
+static CodeSlayerSearchStatsCounts* get_search_counts (void);
+static void close_search_queue                     (GCancellable                  *cancellable,
+                                                    CodeSlayerSearchQueue         *queue);
+static void cancel_search                          (CodeSlayerProjectsSearch      *search);
+static gchar* get_search_settings                  (CodeSlayerProjectsSearch      *search);
+static SearchCache* create_search_cache            (CodeSlayerProjectsSearch      *search,
+                                                    const gchar                   *settings);
+static void free_search_cache                      (SearchCache                   *search_cache);
+static void cache_search_batch                     (SearchCache                   *search_cache,
+                                                    SearchBatch                   *search_batch);
+static gboolean is_refinement                      (CodeSlayerProjectsSearch      *search,
+                                                    const gchar                   *settings);
+static gboolean refine_search                      (CodeSlayerProjectsSearch      *search);
+static gboolean is_unchanged                       (const gchar                   *file_path,
+                                                    gint64                         mtime,
+                                                    goffset                        size);
+static SearchSeen* new_search_seen                 (void);
+static void add_seen_files                         (SearchSeen                    *seen,
+                                                    const gchar                   *folder_path,
+                                                    GFileInfo                     *folder_info,
+                                                    GArray                        *candidates);
+static void free_search_seen                       (SearchSeen                    *seen);
+static gchar* read_result_line                     (const gchar                   *file_path,
+                                                    goffset                        line_offset,
+                                                    gsize                         *length);
+static gint64 get_modification_time                (GFileInfo                     *file_info);
 static void add_project                            (CodeSlayerProjectsSearch      *search,
                                                     CodeSlayerProject             *project,
                                                     GtkTreeIter                   *project_iter);
 static gboolean select_document                    (CodeSlayerProjectsSearch      *search,
                                                     GtkTreeIter                   *treeiter,
                                                     GtkTreeViewColumn             *column);
+static void preview_action                         (CodeSlayerProjectsSearch      *search);
 static gchar* get_globbing                         (const gchar                   *entry, 
                                                     gboolean                       to_lowercase);
-static void get_text                               (gchar                         **text, 
-                                                    gboolean                       to_lowercase);
 static gboolean is_active                          (GtkWidget                     *toggle_button);
-static gint sort_iter_compare_func                 (GtkTreeModel                  *model, 
-                                                    GtkTreeIter                   *a, 
-                                                    GtkTreeIter                   *b, 
-                                                    gpointer                       userdata);
                                                   
-static gboolean set_stop_button_sensitive          (GtkWidget                     *stop_button);
-static gboolean create_search_tree                 (SearchContext                 *context);
-static void destroy_search_tree                    (SearchContext                 *context);
 
 
+#define SEARCH_QUEUE_CAPACITY 256
+#define SEARCH_BATCH_LENGTH 64
+#define SEARCH_TIME_BUDGET (8 * G_TIME_SPAN_MILLISECOND)
+#define SEARCH_PREFETCH_FILES 16
+#define SEARCH_PREFETCH_BYTES (8 * 1024 * 1024)
+#define SEARCH_READER_SIZE (256 * 1024)
+#define SEARCH_PREVIEW_FILES 8
+#define SEARCH_SNIPPET_LENGTH 240
+#define SEARCH_SNIPPET_BEFORE 80
+#define SEARCH_SNIPPET_ELLIPSIS "\342\200\246"
+
+/* every pool worker keeps its own ring */
+static GPrivate search_reader = G_PRIVATE_INIT ((GDestroyNotify) codeslayer_search_reader_free);
+
+/* and its own counts, which are added to the stats for each directory */
+static GPrivate search_counts = G_PRIVATE_INIT (g_free);
+
 #define CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), CODESLAYER_PROJECTS_SEARCH_TYPE, CodeSlayerProjectsSearchPrivate))
 
@@ -109,37 +423,58 @@ struct _CodeSlayerProjectsSearchPrivate
 {
   GtkWindow         *parent;
   CodeSlayerProfile *profile;
+  GtkWidget         *notebook;
   GtkWidget         *vbox;
   GtkWidget         *grid;
   GtkWidget         *find_entry;
+  GtkWidget         *replace_entry;
   GtkWidget         *file_entry;
   GtkWidget         *stop_button;
   GtkWidget         *find_button;
   GtkWidget         *match_case_button;
+  GtkWidget         *regex_button;
+  GtkWidget         *terms_button;
+  GtkWidget         *status_label;
+  GtkWidget         *stats_label;
   GtkWidget         *treeview;
-  GtkTreeStore      *treestore;
+  GtkWidget         *paned;
+  GtkWidget         *preview_view;
+  CodeSlayerSearchPreview *preview;
+  CodeSlayerSearchModel *model;
   GtkCellRenderer   *renderer;
   GtkWidget         *options_grid;
   GtkWidget         *scope_combo_box;
   gchar             *file_paths;
-  gboolean           stop_request;
+  GCancellable      *cancellable;
+  GThread           *thread;
+  GCancellable      *replace_cancellable;
+  GThread           *replace_thread;
+  gchar             *find_settings;
+  gboolean           finished;
+  GHashTable        *search_indexes;
+  SearchCache       *search_cache;
+  GHashTable        *snapshots;
+  gboolean           match_case;
+  gboolean           multiple_terms;
+  GRegex            *find_regex;
   const gchar       *find_text;
   const gchar       *file_text;
 };
 
 enum
 {
-  FILE_PATH = 0,
-  LINE_NUMBER,
-  TEXT,
-  PROJECT,
-  COLUMNS
+  PREVIEW_ENABLED = 0,
+  PREVIEW_TEXT,
+  PREVIEW_FILE,
+  PREVIEW_COLUMNS
 };
 
 enum
 {
   SELECT_DOCUMENT,
   CLOSE,
+  FILES_REPLACED,
+  SEARCH_FINISHED,
   LAST_SIGNAL
 };
 
@@ -159,21 +494,67 @@ enum
   PROP_FILE_PATHS
 };
 
-typedef struct
+/*
+ * With multiple terms the result also says which of them are on the line.
+ * The match is kept in bytes from the start of the line as it is in the 
+ * file, before the indent was stripped off the text. The text of a long 
+ * line is only a window around the match, and the whole line is read 
+ * from the file again when it is needed.
+ */
+struct _SearchResult
 {
-  gchar *file_path;
-  gint  line_number;
-  gchar *text;
+  gint         line_number;
+  goffset      line_offset;
+  gint         match_offset;
+  gint         match_length;
+  gint         indent;
+  gboolean     truncated;
+  const gchar *text;
+  const gchar *terms;
+};
 
-} SearchResult;
+/*
+ * The file path is kept once, right behind the struct, and the 
+ * results of the file refer to it.
+ */
+struct _SearchFile
+{
+  const gchar       *file_name;
+  const gchar       *file_path;
+  CodeSlayerProject *project;
+  gint64             mtime;
+  goffset            size;
+  GtkTreeIter        iter;
+  SearchCacheFile   *cache_file;
+};
 
-typedef struct
+/*
+ * The hits of the last plain text search. A search for longer text that
+ * contains the old text, or one that adds a file pattern, can only find
+ * lines that are in here, so it checks them again instead of walking 
+ * the projects. The cache is only used once its search has finished.
+ */
+struct _SearchCache
 {
-  gchar *file_name;
-  gchar *file_path;
-  GList *search_results;
+  gchar        *find_text;
+  gchar        *file_text;
+  gchar        *settings;
+  gboolean      match_case;
+  gboolean      complete;
+  GPtrArray    *cache_files;
+  GStringChunk *text_chunk;
+  SearchSeen   *seen;
+};
 
-} SearchFile;
+struct _SearchCacheFile
+{
+  const gchar       *file_path;
+  const gchar       *file_name;
+  CodeSlayerProject *project;
+  gint64             mtime;
+  goffset            size;
+  GArray            *search_results;
+};
 
 static void 
 codeslayer_projects_search_class_init (CodeSlayerProjectsSearchClass *klass)
@@ -211,6 +592,40 @@ codeslayer_projects_search_class_init (CodeSlayerProjectsSearchClass *klass)
                   NULL, NULL, 
                   g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 
+  /**
+   * CodeSlayerProjectsSearch::files-replaced
+   * @codeslayersearch: the search that received the signal
+   * @replace: the #CodeSlayerSearchReplace that wrote the files
+   *
+   * Note: for internal use only.
+   *
+   * The ::files-replaced signal is emitted after a replace wrote the files, 
+   * so the documents that are open can take over the same changes.
+   */
+  codeslayer_projects_search_signals[FILES_REPLACED] =
+    g_signal_new ("files-replaced", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CodeSlayerProjectsSearchClass, files_replaced),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  /**
+   * CodeSlayerProjectsSearch::search-finished
+   * @codeslayersearch: the search that received the signal
+   * @stats: the #CodeSlayerSearchStats of the search
+   *
+   * The ::search-finished signal is emitted when a search went through 
+   * all of the projects. Keep the stats with codeslayer_search_stats_ref().
+   */
+  codeslayer_projects_search_signals[SEARCH_FINISHED] =
+    g_signal_new ("search-finished", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CodeSlayerProjectsSearchClass, search_finished),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__BOXED, G_TYPE_NONE, 1, CODESLAYER_SEARCH_STATS_TYPE);
+
   G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) codeslayer_projects_search_finalize;
   
   g_type_class_add_private (klass, sizeof (CodeSlayerProjectsSearchPrivate));
@@ -236,7 +651,17 @@ codeslayer_projects_search_finalize (CodeSlayerProjectsSearch *search)
       g_free (priv->file_paths);
       priv->file_paths = NULL;
     }
-  priv->stop_request = TRUE;
+  cancel_search (search);
+  cancel_replace (search);
+  g_free (priv->find_settings);
+  g_hash_table_destroy (priv->search_indexes);
+  if (priv->search_cache != NULL)
+    free_search_cache (priv->search_cache);
+  if (priv->snapshots != NULL)
+    g_hash_table_destroy (priv->snapshots);
+  if (priv->find_regex != NULL)
+    g_regex_unref (priv->find_regex);
+  codeslayer_search_preview_free (priv->preview);
   G_OBJECT_CLASS (codeslayer_projects_search_parent_class)-> finalize (G_OBJECT (search));
 }
 
@@ -244,6 +669,7 @@ codeslayer_projects_search_finalize (CodeSlayerProjectsSearch *search)
  * codeslayer_projects_search_new:
  * @window: a #GtkWindow.
  * @profile: a #CodeSlayerProfile.
+ * @notebook: a #CodeSlayerNotebook.
  *
  * Creates a new #CodeSlayerProjectsSearch.
  *
@@ -251,7 +677,8 @@ codeslayer_projects_search_finalize (CodeSlayerProjectsSearch *search)
  */
 GtkWidget*
 codeslayer_projects_search_new (GtkWindow         *window, 
-                                CodeSlayerProfile *profile)
+                                CodeSlayerProfile *profile,
+                                GtkWidget         *notebook)
 {
   CodeSlayerProjectsSearchPrivate *priv;
   GtkWidget *search;
@@ -260,7 +687,16 @@ codeslayer_projects_search_new (GtkWindow         *window,
   priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
   priv->parent = window;
   priv->profile = profile;
+  priv->notebook = notebook;
   priv->file_paths = NULL;
+  priv->cancellable = NULL;
+  priv->thread = NULL;
+  priv->find_regex = NULL;
+  priv->search_cache = NULL;
+  priv->snapshots = NULL;
+  priv->preview = codeslayer_search_preview_new (SEARCH_PREVIEW_FILES);
+  priv->search_indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, 
+                                                (GDestroyNotify) codeslayer_search_index_free);
   
   gtk_window_set_transient_for (GTK_WINDOW (search), window);
   gtk_window_set_destroy_with_parent (GTK_WINDOW (search), TRUE);
@@ -276,6 +712,8 @@ codeslayer_projects_search_new (GtkWindow         *window,
   add_search_fields (CODESLAYER_PROJECTS_SEARCH (search));
   add_more_options (CODESLAYER_PROJECTS_SEARCH (search));
   add_results_window (CODESLAYER_PROJECTS_SEARCH (search));  
+  add_preview (CODESLAYER_PROJECTS_SEARCH (search));  
+  add_statistics (CODESLAYER_PROJECTS_SEARCH (search));  
   add_button_box (CODESLAYER_PROJECTS_SEARCH (search));
 
   return search;
@@ -336,6 +774,157 @@ codeslayer_projects_search_find_projects (CodeSlayerProjectsSearch *search)
   gtk_widget_set_tooltip_text (GTK_WIDGET (priv->scope_combo_box), NULL);
 }
 
+/**
+ * codeslayer_projects_search_clear_cache:
+ * @search: a #CodeSlayerProjectsSearch.
+ *
+ * Forgets the hits of the last search, so the next search walks the 
+ * projects again. Call this when files may have changed.
+ */
+void
+codeslayer_projects_search_clear_cache (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  if (priv->search_cache != NULL)
+    {
+      free_search_cache (priv->search_cache);
+      priv->search_cache = NULL;
+    }
+}
+
+/**
+ * codeslayer_projects_search_grep:
+ * @profile: a #CodeSlayerProfile.
+ * @find_text: the text to find.
+ * @regex: is TRUE if the text is a regular expression.
+ * @match_case: is FALSE to ignore the case of the text.
+ *
+ * Searches the projects of the profile the same way the search window 
+ * does, but without a window, and prints every hit as path:line:text 
+ * to stdout. The workers search in parallel, so the hits come out in 
+ * the order they are found and not sorted like in the window.
+ *
+ * Returns: 0 if something was found, 1 if nothing was found and 2 if 
+ * the search could not run, like grep.
+ */
+gint
+codeslayer_projects_search_grep (CodeSlayerProfile *profile,
+                                 const gchar       *find_text,
+                                 gboolean           regex,
+                                 gboolean           match_case)
+{
+  SearchGrep grep;
+  SearchScan *scan;
+  CodeSlayerSearchQueue *queue;
+  GRegex *find_regex = NULL;
+  GHashTable *search_indexes;
+  GThread *thread;
+  GString *output;
+  guint64 matches = 0;
+
+  if (!codeslayer_utils_has_text (find_text))
+    return 2;
+
+  if (regex)
+    {
+      GError *error = NULL;
+      find_regex = new_search_regex (find_text, match_case, &error);
+      if (find_regex == NULL)
+        {
+          g_printerr ("%s\n", error->message);
+          g_error_free (error);
+          return 2;
+        }
+    }
+
+  scan = new_search_scan (profile, find_text, NULL, find_regex, match_case, FALSE);
+
+  g_mutex_init (&grep.mutex);
+  g_cond_init (&grep.cond);
+  grep.woken = FALSE;
+
+  search_indexes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, 
+                                          (GDestroyNotify) codeslayer_search_index_free);
+  queue = codeslayer_search_queue_new (SEARCH_QUEUE_CAPACITY, 
+                                       (GDestroyNotify) free_search_batch,
+                                       (CodeSlayerSearchQueueNotify) wake_search_grep, 
+                                       &grep);
+  scan->cancellable = g_cancellable_new ();
+  scan->search_indexes = search_indexes;
+  scan->queue = codeslayer_search_queue_ref (queue);
+  scan->full_lines = TRUE;
+
+  thread = g_thread_new ("grep", (GThreadFunc) run_search_scan, scan);
+
+  output = g_string_sized_new (64 * 1024);
+
+  while (TRUE)
+    {
+      SearchBatch *search_batch;
+      guint i;
+
+      search_batch = codeslayer_search_queue_pop (queue);
+      if (search_batch == NULL)
+        {
+          /* a push after the sleep sets woken, so it is reset first */
+          g_mutex_lock (&grep.mutex);
+          grep.woken = FALSE;
+          g_mutex_unlock (&grep.mutex);
+
+          if (!codeslayer_search_queue_sleep (queue))
+            continue;
+
+          g_mutex_lock (&grep.mutex);
+          while (!grep.woken)
+            g_cond_wait (&grep.cond, &grep.mutex);
+          g_mutex_unlock (&grep.mutex);
+          continue;
+        }
+
+      if (search_batch->search_file == NULL)
+        {
+          free_search_batch (search_batch);
+          break;
+        }
+
+      for (i = 0; search_batch->search_results != NULL && i < search_batch->search_results->len; i++)
+        {
+          SearchResult *search_result;
+          search_result = &g_array_index (search_batch->search_results, SearchResult, i);
+          g_string_append_printf (output, "%s:%d:%s\n", search_batch->search_file->file_path,
+                                  search_result->line_number, search_result->text);
+          matches++;
+        }
+
+      if (output->len >= 32 * 1024)
+        {
+          fwrite (output->str, 1, output->len, stdout);
+          g_string_truncate (output, 0);
+        }
+
+      free_search_batch (search_batch);
+    }
+
+  fwrite (output->str, 1, output->len, stdout);
+  fflush (stdout);
+  g_string_free (output, TRUE);
+
+  g_thread_join (thread);
+
+  g_object_unref (scan->cancellable);
+  free_search_scan (scan);
+  codeslayer_search_queue_unref (queue);
+  g_hash_table_destroy (search_indexes);
+  if (find_regex != NULL)
+    g_regex_unref (find_regex);
+  g_mutex_clear (&grep.mutex);
+  g_cond_clear (&grep.cond);
+
+  return matches > 0 ? 0 : 1;
+}
+
 static void
 add_search_fields (CodeSlayerProjectsSearch *search)
 {
@@ -351,6 +940,9 @@ add_search_fields (CodeSlayerProjectsSearch *search)
   add_find_entry (search);
   add_stop_button (search);
   add_match_case_button (search);
+  add_regex_button (search);
+  add_terms_button (search);
+  add_replace_entry (search);
 
   gtk_box_pack_start (GTK_BOX (priv->vbox), GTK_WIDGET (priv->grid), FALSE, FALSE, 2);
 }
@@ -374,6 +966,7 @@ add_more_options (CodeSlayerProjectsSearch *search)
 
   add_file_entry (search);
   add_scope_combo_box (search);
+  add_load_terms_button (search);
   
   gtk_container_add (GTK_CONTAINER (expander), options_grid);
   gtk_box_pack_start (GTK_BOX (priv->vbox), expander, FALSE, FALSE, 2);
@@ -384,8 +977,7 @@ add_results_window (CodeSlayerProjectsSearch *search)
 {
   CodeSlayerProjectsSearchPrivate *priv;
   GtkWidget *treeview;
-  GtkTreeStore *treestore;
-  GtkTreeSortable *sortable;
+  CodeSlayerSearchModel *model;
   GtkTreeViewColumn *column;
   GtkCellRenderer *renderer;
   GtkWidget *scrolled_window;
@@ -395,18 +987,14 @@ add_results_window (CodeSlayerProjectsSearch *search)
   treeview = gtk_tree_view_new ();
   priv->treeview = treeview;
 
-  treestore = gtk_tree_store_new (COLUMNS, G_TYPE_STRING, G_TYPE_INT, 
-                                  G_TYPE_STRING, G_TYPE_POINTER);
-  priv->treestore = treestore;
+  /* the rows are sorted by the model once the search is done */
+  model = codeslayer_search_model_new ();
+  priv->model = model;
 
   gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (treeview), FALSE);
-  gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (treestore));
-  g_object_unref (treestore);
-
-  sortable = GTK_TREE_SORTABLE (treestore);
-  gtk_tree_sortable_set_sort_func (sortable, TEXT, sort_iter_compare_func,
-                                   GINT_TO_POINTER (TEXT), NULL);
-  gtk_tree_sortable_set_sort_column_id (sortable, TEXT, GTK_SORT_ASCENDING);
+  gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (treeview), TRUE);
+  gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (model));
+  g_object_unref (model);
 
   column = gtk_tree_view_column_new ();
 
@@ -414,7 +1002,9 @@ add_results_window (CodeSlayerProjectsSearch *search)
   priv->renderer = renderer;
 
   gtk_tree_view_column_pack_start (column, renderer, FALSE);
-  gtk_tree_view_column_set_attributes (column, renderer, "text", TEXT, NULL);
+  gtk_tree_view_column_set_attributes (column, renderer, "text", 
+                                       CODESLAYER_SEARCH_MODEL_TEXT, NULL);
+  gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
 
   gtk_tree_view_append_column (GTK_TREE_VIEW (treeview), column);
 
@@ -422,11 +1012,80 @@ add_results_window (CodeSlayerProjectsSearch *search)
   gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
                                   GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
   gtk_container_add (GTK_CONTAINER (scrolled_window), GTK_WIDGET (treeview));
-  gtk_box_pack_start (GTK_BOX (priv->vbox), GTK_WIDGET (scrolled_window), 
-                      TRUE, TRUE, 2);
+
+  priv->paned = gtk_paned_new (GTK_ORIENTATION_VERTICAL);
+  gtk_paned_pack1 (GTK_PANED (priv->paned), scrolled_window, TRUE, FALSE);
+  gtk_box_pack_start (GTK_BOX (priv->vbox), priv->paned, TRUE, TRUE, 2);
 
   g_signal_connect_swapped (G_OBJECT (treeview), "row-activated",
                             G_CALLBACK (select_document), search);
+
+  g_signal_connect_swapped (G_OBJECT (gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview))), 
+                            "changed", G_CALLBACK (preview_action), search);
+}
+
+/*
+ * The lines around the selected hit, so the hits can be looked over 
+ * without opening each one in the editor.
+ */
+static void
+add_preview (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  CodeSlayerRegistry *registry;
+  PangoFontDescription *font_description;
+  GtkTextBuffer *buffer;
+  GtkWidget *preview_view;
+  GtkWidget *scrolled_window;
+  gchar *fontname;
+  
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  
+  registry = codeslayer_profile_get_registry (priv->profile);
+
+  preview_view = gtk_text_view_new ();
+  priv->preview_view = preview_view;
+  gtk_text_view_set_editable (GTK_TEXT_VIEW (preview_view), FALSE);
+  gtk_text_view_set_cursor_visible (GTK_TEXT_VIEW (preview_view), FALSE);
+
+  fontname = codeslayer_registry_get_string (registry, CODESLAYER_REGISTRY_FONT);
+  font_description = pango_font_description_from_string (fontname);
+  if (fontname)
+    g_free (fontname);
+  gtk_widget_override_font (preview_view, font_description);
+  pango_font_description_free (font_description);
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (preview_view));
+  gtk_text_buffer_create_tag (buffer, "hit-line", "paragraph-background", "#eeeeec", NULL);
+  gtk_text_buffer_create_tag (buffer, "hit-match", "background", "#fff3a0", NULL);
+  
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), preview_view);
+  gtk_paned_pack2 (GTK_PANED (priv->paned), scrolled_window, FALSE, TRUE);
+}
+
+static void
+add_statistics (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GtkWidget *expander;
+  GtkWidget *stats_label;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  expander = gtk_expander_new (_("Statistics"));
+  gtk_expander_set_expanded (GTK_EXPANDER (expander), FALSE);
+
+  stats_label = gtk_label_new (NULL);
+  priv->stats_label = stats_label;
+  gtk_label_set_selectable (GTK_LABEL (stats_label), TRUE);
+  gtk_misc_set_alignment (GTK_MISC (stats_label), 0, .5);
+  gtk_widget_set_margin_left (stats_label, 25);
+
+  gtk_container_add (GTK_CONTAINER (expander), stats_label);
+  gtk_box_pack_start (GTK_BOX (priv->vbox), expander, FALSE, FALSE, 2);
 }
 
 static void
@@ -499,6 +1158,69 @@ add_match_case_button (CodeSlayerProjectsSearch *search)
                             G_CALLBACK (match_case_action), search);
 }
 
+static void
+add_regex_button (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GtkWidget *regex_button;
+  
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  regex_button = gtk_check_button_new_with_label (_("Regular Expression"));
+  gtk_widget_set_can_focus (regex_button, FALSE);
+  priv->regex_button = regex_button;
+
+  gtk_grid_attach_next_to (GTK_GRID (priv->grid), regex_button, priv->match_case_button, 
+                           GTK_POS_RIGHT, 1, 1);
+
+  g_signal_connect_swapped (G_OBJECT (regex_button), "clicked",
+                            G_CALLBACK (match_case_action), search);
+}
+
+static void
+add_terms_button (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GtkWidget *terms_button;
+  
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  terms_button = gtk_check_button_new_with_label (_("Multiple Terms"));
+  gtk_widget_set_can_focus (terms_button, FALSE);
+  gtk_widget_set_tooltip_text (terms_button, _("Find any of the comma separated terms"));
+  priv->terms_button = terms_button;
+
+  gtk_grid_attach_next_to (GTK_GRID (priv->grid), terms_button, priv->regex_button, 
+                           GTK_POS_RIGHT, 1, 1);
+
+  g_signal_connect_swapped (G_OBJECT (terms_button), "clicked",
+                            G_CALLBACK (match_case_action), search);
+}
+
+static void
+add_replace_entry (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GtkWidget *replace_label;
+  GtkWidget *replace_entry;
+  
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  replace_label = gtk_label_new (_("Replace With:"));
+  gtk_misc_set_alignment (GTK_MISC (replace_label), 1, .5);
+  gtk_misc_set_padding (GTK_MISC (replace_label), 4, 0);
+  gtk_grid_attach (GTK_GRID (priv->grid), replace_label, 0, 1, 1, 1);
+
+  replace_entry = gtk_entry_new ();
+  gtk_entry_set_width_chars (GTK_ENTRY (replace_entry), 40);
+  priv->replace_entry = replace_entry;
+  gtk_grid_attach_next_to (GTK_GRID (priv->grid), replace_entry, replace_label, 
+                           GTK_POS_RIGHT, 1, 1);
+
+  g_signal_connect_swapped (G_OBJECT (replace_entry), "activate",
+                            G_CALLBACK (replace_action), search);
+}
+
 static void
 add_file_entry (CodeSlayerProjectsSearch *search)
 {
@@ -552,13 +1274,31 @@ add_scope_combo_box (CodeSlayerProjectsSearch *search)
                            GTK_POS_RIGHT, 1, 1);
 }
 
+static void
+add_load_terms_button (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GtkWidget *load_terms_button;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  
+  load_terms_button = gtk_button_new_with_label (_("Load Terms..."));
+  gtk_widget_set_halign (load_terms_button, GTK_ALIGN_START);
+  gtk_grid_attach (GTK_GRID (priv->options_grid), load_terms_button, 1, 2, 1, 1);
+
+  g_signal_connect_swapped (G_OBJECT (load_terms_button), "clicked",
+                            G_CALLBACK (load_terms_action), search);
+}
+
 static void
 add_button_box (CodeSlayerProjectsSearch *search)
 {
   CodeSlayerProjectsSearchPrivate *priv;
   GtkWidget *button_box;
   GtkWidget *close_button;
+  GtkWidget *replace_button;
   GtkWidget *find_button;
+  GtkWidget *status_label;
   
   priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
 
@@ -568,15 +1308,26 @@ add_button_box (CodeSlayerProjectsSearch *search)
   gtk_box_set_spacing (GTK_BOX (button_box), 4);
 
   close_button = gtk_button_new_with_label (_("Close"));
+  replace_button = gtk_button_new_with_label (_("Replace..."));
   find_button = gtk_button_new_with_label (_("Find"));
   priv->find_button = find_button;
 
   gtk_box_pack_start (GTK_BOX(button_box), close_button, FALSE, FALSE, 0);
+  gtk_box_pack_start (GTK_BOX(button_box), replace_button, FALSE, FALSE, 0);
   gtk_box_pack_start (GTK_BOX(button_box), find_button, FALSE, FALSE, 0);
+
+  /* tells what the last search skipped, kept apart on the left */
+  status_label = gtk_label_new (NULL);
+  priv->status_label = status_label;
+  gtk_box_pack_start (GTK_BOX(button_box), status_label, FALSE, FALSE, 0);
+  gtk_button_box_set_child_secondary (GTK_BUTTON_BOX (button_box), status_label, TRUE);
   
   g_signal_connect_swapped (G_OBJECT (close_button), "clicked",
                             G_CALLBACK (close_action), search);
 
+  g_signal_connect_swapped (G_OBJECT (replace_button), "clicked",
+                            G_CALLBACK (replace_action), search);
+
   g_signal_connect_swapped (G_OBJECT (find_button), "clicked",
                             G_CALLBACK (find_action), search);
 
@@ -593,425 +1344,2808 @@ static void
 find_action (CodeSlayerProjectsSearch *search)
 {
   CodeSlayerProjectsSearchPrivate *priv;
-  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-  priv->stop_request = FALSE;
-  gtk_widget_set_sensitive (priv->stop_button, TRUE);
+  gchar *settings;
 
-  gtk_tree_store_clear (priv->treestore);
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  
+  /* only one search writes to the tree at a time */
+  cancel_search (search);
+
+  codeslayer_search_model_clear (priv->model);
+  gtk_label_set_text (GTK_LABEL (priv->status_label), "");
+  g_free (priv->find_settings);
+  priv->find_settings = get_find_settings (search);
+  priv->finished = FALSE;
   priv->find_text = gtk_entry_get_text (GTK_ENTRY (priv->find_entry));
   priv->file_text = gtk_entry_get_text (GTK_ENTRY (priv->file_entry));
+  priv->match_case = is_active (priv->match_case_button);
+  priv->multiple_terms = is_active (priv->terms_button);
+
+  if (!codeslayer_utils_has_text (priv->find_text) 
+      && !codeslayer_utils_has_text (priv->file_text))
+    return;
+
+  if (priv->find_regex != NULL)
+    {
+      g_regex_unref (priv->find_regex);
+      priv->find_regex = NULL;
+    }
+
+  if (is_active (priv->regex_button) && !priv->multiple_terms
+      && codeslayer_utils_has_text (priv->find_text))
+    {
+      priv->find_regex = create_regex (search);
+      if (priv->find_regex == NULL)
+        return;
+    }
+
+  if (priv->snapshots != NULL)
+    g_hash_table_destroy (priv->snapshots);
+  priv->snapshots = take_snapshots (search);
+
+  settings = get_search_settings (search);
+
+  /* the cache only knows what is on disk */
+  if (priv->snapshots == NULL && is_refinement (search, settings) 
+      && refine_search (search))
+    {
+      priv->finished = TRUE;
+      g_free (settings);
+      return;
+    }
+
+  if (priv->search_cache != NULL)
+    {
+      free_search_cache (priv->search_cache);
+      priv->search_cache = NULL;
+    }
+
+  /* only the plain text searches can be narrowed down later */
+  if (codeslayer_utils_has_text (priv->find_text) && priv->find_regex == NULL 
+      && !priv->multiple_terms && priv->snapshots == NULL && codeslayer_search_matcher_is_literal (priv->find_text))
+    priv->search_cache = create_search_cache (search, settings);
+
+  g_free (settings);
+  
+  gtk_widget_set_sensitive (priv->stop_button, TRUE);
   
-  g_thread_new ("find", (GThreadFunc) execute, search);
+  priv->cancellable = g_cancellable_new ();
+  priv->thread = g_thread_new ("find", (GThreadFunc) execute, search);
 }
 
-static void
-stop_action (CodeSlayerProjectsSearch *search)
+/*
+ * Copies the text of the documents that have not been saved, so that 
+ * the workers search what is in the editor and not what is on disk. 
+ * The copies are only read by the workers and kept until the next 
+ * search. Returns NULL when every document is saved.
+ */
+static GHashTable*
+take_snapshots (CodeSlayerProjectsSearch *search)
 {
   CodeSlayerProjectsSearchPrivate *priv;
-  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-  priv->stop_request = TRUE;
-}
+  GHashTable *snapshots = NULL;
+  GList *source_views;
+  GList *list;
 
-static void
-match_case_action (CodeSlayerProjectsSearch *search)
-{
-  find_action (search);
-}
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  
+  if (priv->notebook == NULL)
+    return NULL;
 
-static void
-scope_combo_box_changed (CodeSlayerProjectsSearch *search)
+  source_views = codeslayer_notebook_get_all_source_views (CODESLAYER_NOTEBOOK (priv->notebook));
+  
+  for (list = source_views; list != NULL; list = g_list_next (list))
+    {
+      CodeSlayerSourceView *source_view = list->data;
+      CodeSlayerDocument *document;
+      GtkTextBuffer *buffer;
+      GtkTextIter start, end;
+      const gchar *file_path;
+      gchar *text;
+
+      buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+      if (!gtk_text_buffer_get_modified (buffer))
+        continue;
+
+      document = codeslayer_source_view_get_document (source_view);
+      file_path = codeslayer_document_get_file_path (document);
+      if (file_path == NULL)
+        continue;
+      
+      if (snapshots == NULL)
+        snapshots = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, 
+                                           (GDestroyNotify) g_bytes_unref);
+
+      gtk_text_buffer_get_bounds (buffer, &start, &end);
+      text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+      g_hash_table_insert (snapshots, g_strdup (file_path), 
+                           g_bytes_new_take (text, strlen (text)));
+    }
+
+  g_list_free (source_views);
+
+  return snapshots;
+}
+
+/*
+ * The regular expression is compiled once and shared by all of the 
+ * workers. It works on bytes since the files do not have to be UTF-8.
+ */
+static GRegex*
+create_regex (CodeSlayerProjectsSearch *search)
 {
   CodeSlayerProjectsSearchPrivate *priv;
+  GRegex *regex;
+  GError *error = NULL;
+
   priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-  if (has_selection_scope (search) && priv->file_paths != NULL)
-    gtk_widget_set_tooltip_text (GTK_WIDGET (priv->scope_combo_box), priv->file_paths);
+
+  regex = new_search_regex (priv->find_text, priv->match_case, &error);
+  if (regex == NULL)
+    {
+      GtkWidget *dialog;
+      dialog = gtk_message_dialog_new (GTK_WINDOW (search), 
+                                       GTK_DIALOG_MODAL,
+                                       GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                                       "%s", error->message);
+      gtk_dialog_run (GTK_DIALOG (dialog));
+      gtk_widget_destroy (dialog);
+      g_error_free (error);
+    }
+
+  return regex;
+}
+
+static GRegex*
+new_search_regex (const gchar  *find_text,
+                  gboolean      match_case,
+                  GError      **error)
+{
+  GRegexCompileFlags flags;
+
+  flags = G_REGEX_OPTIMIZE | G_REGEX_MULTILINE | G_REGEX_RAW;
+  if (!match_case)
+    flags |= G_REGEX_CASELESS;
+
+  return g_regex_new (find_text, flags, 0, error);
+}
+
+/*
+ * Cancels the running search and waits for its thread. The workers 
+ * may be waiting on a full queue, so cancelling closes the queue too.
+ */
+static void
+cancel_search (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  if (priv->cancellable == NULL)
+    return;
+
+  g_cancellable_cancel (priv->cancellable);
+  g_thread_join (priv->thread);
+  g_object_unref (priv->cancellable);
+  priv->cancellable = NULL;
+  priv->thread = NULL;
+}
+
+static void
+stop_action (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  if (priv->cancellable != NULL)
+    g_cancellable_cancel (priv->cancellable);
+  gtk_widget_set_sensitive (priv->stop_button, FALSE);
+  codeslayer_search_model_sort (priv->model);
+}
+
+/*
+ * Reads one term per line and puts them in the find entry, so the 
+ * terms can still be looked at and changed before the search.
+ */
+static void
+load_terms_action (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GtkWidget *dialog;
+  gint response;
+  
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  
+  dialog = gtk_file_chooser_dialog_new (_("Select Terms File"), 
+                                        GTK_WINDOW (search),
+                                        GTK_FILE_CHOOSER_ACTION_OPEN,
+                                        _("Cancel"), GTK_RESPONSE_CANCEL,
+                                        _("Open"), GTK_RESPONSE_OK, 
+                                        NULL);
+                                        
+  gtk_window_set_skip_taskbar_hint (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_skip_pager_hint (GTK_WINDOW (dialog), TRUE);
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+
+  response = gtk_dialog_run (GTK_DIALOG (dialog));
+  if (response == GTK_RESPONSE_OK)
+    {
+      gchar *file_path;
+      gchar *contents;
+
+      file_path = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
+
+      if (g_file_get_contents (file_path, &contents, NULL, NULL))
+        {
+          gchar **lines, **tmp;
+          GString *terms;
+
+          terms = g_string_new (NULL);
+          lines = g_strsplit (contents, "\n", -1);
+
+          for (tmp = lines; *tmp != NULL; tmp++)
+            {
+              g_strstrip (*tmp);
+              if (**tmp == '\0')
+                continue;
+              if (terms->len > 0)
+                g_string_append (terms, ", ");
+              g_string_append (terms, *tmp);
+            }
+
+          gtk_entry_set_text (GTK_ENTRY (priv->find_entry), terms->str);
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (priv->terms_button), TRUE);
+
+          g_strfreev (lines);
+          g_string_free (terms, TRUE);
+          g_free (contents);
+        }
+
+      g_free (file_path);
+    }
+
+  gtk_widget_destroy (dialog);
+}
+
+/*
+ * Replaces the find text in the files of the last search. The files 
+ * are read again on a worker thread, and nothing is written until the 
+ * preview is accepted. The hits are only good for the find settings 
+ * they were searched with, so those may not have changed since.
+ */
+static void
+replace_action (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  CodeSlayerSearchReplace *replace;
+  GRegex *regex = NULL;
+  GError *error = NULL;
+  gchar *find_settings;
+  gboolean changed;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  if (priv->replace_cancellable != NULL)
+    return;
+
+  /* the files come from a search that has finished */
+  if (!priv->finished)
+    {
+      gtk_label_set_text (GTK_LABEL (priv->status_label), 
+                          _("Replace needs a finished search"));
+      return;
+    }
+
+  find_settings = get_find_settings (search);
+  changed = g_strcmp0 (find_settings, priv->find_settings) != 0;
+  g_free (find_settings);
+
+  if (changed)
+    {
+      gtk_label_set_text (GTK_LABEL (priv->status_label), 
+                          _("The find settings changed, search again before replacing"));
+      return;
+    }
+
+  priv->find_text = gtk_entry_get_text (GTK_ENTRY (priv->find_entry));
+  priv->match_case = is_active (priv->match_case_button);
+
+  if (!codeslayer_utils_has_text (priv->find_text))
+    return;
+
+  if (is_active (priv->terms_button)
+      || (!is_active (priv->regex_button) && !codeslayer_search_matcher_is_literal (priv->find_text)))
+    {
+      gtk_label_set_text (GTK_LABEL (priv->status_label), 
+                          _("Replace needs plain text or a regular expression"));
+      return;
+    }
+
+  if (is_active (priv->regex_button))
+    {
+      regex = create_regex (search);
+      if (regex == NULL)
+        return;
+    }
+
+  replace = codeslayer_search_replace_new (priv->find_text, regex, 
+                                           gtk_entry_get_text (GTK_ENTRY (priv->replace_entry)), 
+                                           priv->match_case, &error);
+  if (regex != NULL)
+    g_regex_unref (regex);
+
+  if (replace == NULL)
+    {
+      gtk_label_set_text (GTK_LABEL (priv->status_label), error->message);
+      g_error_free (error);
+      return;
+    }
+
+  start_replace (search, replace, get_result_file_paths (search));
+}
+
+/*
+ * The files that had hits, their line rows hold the path.
+ */
+static gchar**
+get_result_file_paths (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GtkTreeModel *model;
+  GtkTreeIter project_iter;
+  GPtrArray *file_paths;
+  gboolean valid;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  model = GTK_TREE_MODEL (priv->model);
+  file_paths = g_ptr_array_new ();
+
+  for (valid = gtk_tree_model_get_iter_first (model, &project_iter); valid;
+       valid = gtk_tree_model_iter_next (model, &project_iter))
+    {
+      GtkTreeIter file_iter;
+      gboolean more;
+
+      for (more = gtk_tree_model_iter_children (model, &file_iter, &project_iter); more;
+           more = gtk_tree_model_iter_next (model, &file_iter))
+        {
+          GtkTreeIter text_iter;
+          gchar *file_path;
+
+          if (!gtk_tree_model_iter_children (model, &text_iter, &file_iter))
+            continue;
+
+          gtk_tree_model_get (model, &text_iter, 
+                              CODESLAYER_SEARCH_MODEL_FILE_PATH, &file_path, -1);
+          if (file_path != NULL)
+            g_ptr_array_add (file_paths, file_path);
+        }
+    }
+
+  g_ptr_array_add (file_paths, NULL);
+
+  return (gchar**) g_ptr_array_free (file_paths, FALSE);
+}
+
+/*
+ * Runs the preview of the files, or the commit when there are no files, 
+ * on a thread of its own. The window can not be used until it is done.
+ */
+static void
+start_replace (CodeSlayerProjectsSearch  *search,
+               CodeSlayerSearchReplace   *replace,
+               gchar                    **file_paths)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  SearchReplace *search_replace;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  priv->replace_cancellable = g_cancellable_new ();
+
+  search_replace = g_malloc (sizeof (SearchReplace));
+  search_replace->search = search;
+  search_replace->replace = replace;
+  search_replace->cancellable = g_object_ref (priv->replace_cancellable);
+  search_replace->file_paths = file_paths;
+  search_replace->written = 0;
+  search_replace->commit = file_paths == NULL;
+
+  set_busy (search, TRUE);
+
+  priv->replace_thread = g_thread_new ("replace", (GThreadFunc) execute_replace, 
+                                       search_replace);
+}
+
+static void
+execute_replace (SearchReplace *search_replace)
+{
+  if (search_replace->commit)
+    search_replace->written = codeslayer_search_replace_commit (search_replace->replace, 
+                                                                search_replace->cancellable);
   else
-    gtk_widget_set_tooltip_text (GTK_WIDGET (priv->scope_combo_box), NULL);
+    codeslayer_search_replace_preview (search_replace->replace, search_replace->file_paths, 
+                                       search_replace->cancellable);
+
+  g_idle_add ((GSourceFunc) finish_replace, search_replace);
+}
+
+/*
+ * Back on the main loop. After the preview the changes are shown, and 
+ * when they are accepted the commit starts with the same replace.
+ */
+static gboolean
+finish_replace (SearchReplace *search_replace)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  CodeSlayerProjectsSearch *search = search_replace->search;
+  CodeSlayerSearchReplace *replace = search_replace->replace;
+
+  /* check first, a cancelled replace may belong to a window that is gone */
+  if (g_cancellable_is_cancelled (search_replace->cancellable))
+    {
+      codeslayer_search_replace_free (replace);
+      free_search_replace (search_replace);
+      return FALSE;
+    }
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  g_thread_join (priv->replace_thread);
+  g_object_unref (priv->replace_cancellable);
+  priv->replace_thread = NULL;
+  priv->replace_cancellable = NULL;
+
+  set_busy (search, FALSE);
+
+  if (search_replace->commit)
+    {
+      g_signal_emit_by_name ((gpointer) search, "files-replaced", replace);
+
+      /* the hits are gone, so are the old results */
+      codeslayer_search_model_clear (priv->model);
+      codeslayer_projects_search_clear_cache (search);
+      priv->finished = FALSE;
+
+      show_replaced (search, replace, search_replace->written);
+      codeslayer_search_replace_free (replace);
+    }
+  else if (codeslayer_search_replace_get_n_files (replace) == 0)
+    {
+      gtk_label_set_text (GTK_LABEL (priv->status_label), _("Nothing to replace"));
+      codeslayer_search_replace_free (replace);
+    }
+  else if (run_replace_preview (search, replace))
+    {
+      start_replace (search, replace, NULL);
+    }
+  else
+    {
+      codeslayer_search_replace_free (replace);
+    }
+
+  free_search_replace (search_replace);
+
+  return FALSE;
+}
+
+static void
+show_replaced (CodeSlayerProjectsSearch *search,
+               CodeSlayerSearchReplace  *replace,
+               guint                     written)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  gchar *status;
+  guint n_files;
+  guint i;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  n_files = codeslayer_search_replace_get_n_files (replace);
+
+  status = g_strdup_printf (_("Replaced in %d files"), written);
+  for (i = 0; i < n_files; i++)
+    {
+      CodeSlayerSearchReplaceFile *file;
+      const gchar *file_error;
+
+      file = codeslayer_search_replace_get_file (replace, i);
+      file_error = codeslayer_search_replace_file_get_error (file);
+
+      if (file_error != NULL)
+        {
+          gchar *tmp = status;
+          status = g_strdup_printf ("%s, %s: %s", tmp, 
+                                    codeslayer_search_replace_file_get_path (file), 
+                                    file_error);
+          g_free (tmp);
+          break;
+        }
+    }
+
+  gtk_label_set_text (GTK_LABEL (priv->status_label), status);
+  g_free (status);
+}
+
+static void
+free_search_replace (SearchReplace *search_replace)
+{
+  g_strfreev (search_replace->file_paths);
+  g_object_unref (search_replace->cancellable);
+  g_free (search_replace);
+}
+
+/*
+ * Only for when the window goes away. A file that is being written is 
+ * still finished, the ones after it are left alone.
+ */
+static void
+cancel_replace (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  if (priv->replace_cancellable == NULL)
+    return;
+
+  g_cancellable_cancel (priv->replace_cancellable);
+  g_thread_join (priv->replace_thread);
+  g_object_unref (priv->replace_cancellable);
+  priv->replace_cancellable = NULL;
+  priv->replace_thread = NULL;
+}
+
+/*
+ * What decides the hits of a search, as it is in the entries right now.
+ */
+static gchar*
+get_find_settings (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  return g_strdup_printf ("%s\n%d\n%d\n%d", 
+                          gtk_entry_get_text (GTK_ENTRY (priv->find_entry)),
+                          is_active (priv->match_case_button),
+                          is_active (priv->regex_button),
+                          is_active (priv->terms_button));
+}
+
+/*
+ * Shows every changed line before and after, a file can be left out by 
+ * unchecking it. Returns TRUE if the files should be written.
+ */
+static gboolean
+run_replace_preview (CodeSlayerProjectsSearch *search,
+                     CodeSlayerSearchReplace  *replace)
+{
+  GtkWidget *dialog;
+  GtkWidget *content_area;
+  GtkWidget *summary_label;
+  GtkWidget *treeview;
+  GtkTreeStore *treestore;
+  GtkTreeViewColumn *column;
+  GtkCellRenderer *renderer;
+  GtkWidget *scrolled_window;
+  GStringChunk *text_chunk;
+  GString *buffer;
+  gchar *summary;
+  guint n_files;
+  guint n_replaced = 0;
+  guint i, j;
+  gint response;
+
+  dialog = gtk_dialog_new_with_buttons (_("Replace Preview"), 
+                                        GTK_WINDOW (search),
+                                        GTK_DIALOG_MODAL,
+                                        _("Cancel"), GTK_RESPONSE_CANCEL,
+                                        _("Replace"), GTK_RESPONSE_OK,
+                                        NULL);
+  gtk_window_set_skip_taskbar_hint (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_skip_pager_hint (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_default_size (GTK_WINDOW (dialog), 600, 400);
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+
+  treestore = gtk_tree_store_new (PREVIEW_COLUMNS, G_TYPE_BOOLEAN, 
+                                  G_TYPE_STRING, G_TYPE_POINTER);
+
+  text_chunk = g_string_chunk_new (SEARCH_SNIPPET_LENGTH * 4);
+  buffer = g_string_new (NULL);
+
+  n_files = codeslayer_search_replace_get_n_files (replace);
+  for (i = 0; i < n_files; i++)
+    {
+      CodeSlayerSearchReplaceFile *file;
+      GtkTreeIter file_iter;
+      GArray *lines;
+      gchar *text;
+
+      file = codeslayer_search_replace_get_file (replace, i);
+      lines = codeslayer_search_replace_file_get_lines (file);
+      n_replaced += codeslayer_search_replace_file_get_n_replaced (file);
+
+      text = g_strdup_printf ("%s (%d)", codeslayer_search_replace_file_get_path (file), 
+                              codeslayer_search_replace_file_get_n_replaced (file));
+      gtk_tree_store_append (treestore, &file_iter, NULL);
+      gtk_tree_store_set (treestore, &file_iter, 
+                          PREVIEW_ENABLED, TRUE,
+                          PREVIEW_TEXT, text,
+                          PREVIEW_FILE, file, -1);
+      g_free (text);
+
+      for (j = 0; j < lines->len; j++)
+        {
+          CodeSlayerSearchReplaceLine *line;
+          GtkTreeIter line_iter;
+          SearchResult before;
+          SearchResult after;
+          gint offset = 0;
+
+          line = &g_array_index (lines, CodeSlayerSearchReplaceLine, j);
+
+          /* both sides get the window of the results around the first 
+             change, with the bytes that are not text as question marks */
+          while (line->before[offset] != '\0' && line->before[offset] == line->after[offset])
+            offset++;
+
+          g_string_chunk_clear (text_chunk);
+          before.match_offset = offset;
+          after.match_offset = offset;
+          insert_result_text (text_chunk, buffer, line->before, strlen (line->before), &before);
+          insert_result_text (text_chunk, buffer, line->after, strlen (line->after), &after);
+
+          text = g_strdup_printf ("(%d) %s  ->  %s", line->line_number, before.text, after.text);
+
+          gtk_tree_store_append (treestore, &line_iter, &file_iter);
+          gtk_tree_store_set (treestore, &line_iter, 
+                              PREVIEW_ENABLED, TRUE,
+                              PREVIEW_TEXT, text,
+                              PREVIEW_FILE, NULL, -1);
+          g_free (text);
+        }
+    }
+
+  g_string_chunk_free (text_chunk);
+  g_string_free (buffer, TRUE);
+
+  content_area = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
+
+  summary = g_strdup_printf (_("%d replacements in %d files"), n_replaced, n_files);
+  summary_label = gtk_label_new (summary);
+  gtk_misc_set_alignment (GTK_MISC (summary_label), 0, .5);
+  gtk_box_pack_start (GTK_BOX (content_area), summary_label, FALSE, FALSE, 4);
+  g_free (summary);
+
+  treeview = gtk_tree_view_new_with_model (GTK_TREE_MODEL (treestore));
+  gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (treeview), FALSE);
+  g_object_unref (treestore);
+
+  column = gtk_tree_view_column_new ();
+
+  renderer = gtk_cell_renderer_toggle_new ();
+  gtk_tree_view_column_pack_start (column, renderer, FALSE);
+  gtk_tree_view_column_set_attributes (column, renderer, "active", PREVIEW_ENABLED, NULL);
+  g_signal_connect (G_OBJECT (renderer), "toggled",
+                    G_CALLBACK (replace_toggled_action), treestore);
+
+  renderer = gtk_cell_renderer_text_new ();
+  gtk_tree_view_column_pack_start (column, renderer, FALSE);
+  gtk_tree_view_column_set_attributes (column, renderer, "text", PREVIEW_TEXT, NULL);
+
+  gtk_tree_view_append_column (GTK_TREE_VIEW (treeview), column);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), treeview);
+  gtk_box_pack_start (GTK_BOX (content_area), scrolled_window, TRUE, TRUE, 0);
+
+  gtk_widget_show_all (content_area);
+
+  response = gtk_dialog_run (GTK_DIALOG (dialog));
+  gtk_widget_destroy (dialog);
+
+  return response == GTK_RESPONSE_OK;
+}
+
+/*
+ * Only the file rows can be unchecked, the lines go with their file.
+ */
+static void
+replace_toggled_action (GtkCellRendererToggle *renderer,
+                        gchar                 *path,
+                        GtkTreeStore          *treestore)
+{
+  CodeSlayerSearchReplaceFile *file;
+  GtkTreeIter file_iter;
+  GtkTreeIter line_iter;
+  gboolean enabled;
+  gboolean more;
+
+  if (!gtk_tree_model_get_iter_from_string (GTK_TREE_MODEL (treestore), &file_iter, path))
+    return;
+
+  gtk_tree_model_get (GTK_TREE_MODEL (treestore), &file_iter, 
+                      PREVIEW_ENABLED, &enabled, 
+                      PREVIEW_FILE, &file, -1);
+  if (file == NULL)
+    return;
+
+  enabled = !enabled;
+  codeslayer_search_replace_file_set_enabled (file, enabled);
+  gtk_tree_store_set (treestore, &file_iter, PREVIEW_ENABLED, enabled, -1);
+
+  for (more = gtk_tree_model_iter_children (GTK_TREE_MODEL (treestore), &line_iter, &file_iter); 
+       more; more = gtk_tree_model_iter_next (GTK_TREE_MODEL (treestore), &line_iter))
+    gtk_tree_store_set (treestore, &line_iter, PREVIEW_ENABLED, enabled, -1);
+}
+
+/*
+ * The preview and the commit run on a thread of their own while the 
+ * window waits.
+ */
+static void
+set_busy (CodeSlayerProjectsSearch *search,
+          gboolean                  busy)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  GdkWindow *window;
+  GdkCursor *cursor = NULL;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  window = gtk_widget_get_window (GTK_WIDGET (search));
+  if (busy)
+    cursor = gdk_cursor_new_for_display (gtk_widget_get_display (GTK_WIDGET (search)), GDK_WATCH);
+
+  if (window != NULL)
+    gdk_window_set_cursor (window, cursor);
+
+  gtk_widget_set_sensitive (priv->vbox, !busy);
+
+  if (cursor != NULL)
+    g_object_unref (cursor);
+}
+
+static void
+match_case_action (CodeSlayerProjectsSearch *search)
+{
+  find_action (search);
+}
+
+static void
+scope_combo_box_changed (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  if (has_selection_scope (search) && priv->file_paths != NULL)
+    gtk_widget_set_tooltip_text (GTK_WIDGET (priv->scope_combo_box), priv->file_paths);
+  else
+    gtk_widget_set_tooltip_text (GTK_WIDGET (priv->scope_combo_box), NULL);
+}
+
+static gboolean
+has_selection_scope (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  gint active_pos;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  active_pos = gtk_combo_box_get_active (GTK_COMBO_BOX (priv->scope_combo_box));
+  return active_pos == SCOPE_SELECTION;
+}
+
+static void
+execute (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  SearchScan *scan;
+  SearchStream *stream;
+  
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  
+  /* the results are added to the tree while the search is still running */
+  stream = g_malloc (sizeof (SearchStream));
+  stream->search = search;
+  stream->project = NULL;
+  stream->cancellable = g_object_ref (priv->cancellable);
+  memset (&stream->counts, 0, sizeof (CodeSlayerSearchStatsCounts));
+  stream->queue = codeslayer_search_queue_new (SEARCH_QUEUE_CAPACITY, 
+                                               (GDestroyNotify) free_search_batch,
+                                               (CodeSlayerSearchQueueNotify) wake_search_stream, 
+                                               stream);
+
+  scan = new_search_scan (priv->profile, priv->find_text, priv->file_text, 
+                          priv->find_regex, priv->match_case, priv->multiple_terms);
+  if (scan == NULL)
+    {
+      SearchBatch *done_batch;
+
+      /* nothing to look for, the main loop still has to end the search */
+      done_batch = g_malloc0 (sizeof (SearchBatch));
+      done_batch->policy = codeslayer_search_policy_new (0);
+      done_batch->stats = codeslayer_search_stats_new ();
+      if (!codeslayer_search_queue_push (stream->queue, done_batch))
+        free_search_batch (done_batch);
+      return;
+    }
+
+  scan->cancellable = priv->cancellable;
+  scan->snapshots = priv->snapshots;
+  scan->search_indexes = priv->search_indexes;
+  if (has_selection_scope (search))
+    scan->file_paths = priv->file_paths;
+  scan->queue = codeslayer_search_queue_ref (stream->queue);
+
+  /* a search that can be refined later remembers what it looked at */
+  if (priv->search_cache != NULL)
+    scan->seen = new_search_seen ();
+
+  run_search_scan (scan);
+
+  free_search_scan (scan);
+}
+
+/*
+ * Everything a search needs from the settings, without the window, so 
+ * that a search can also run from the command line. Returns NULL when 
+ * there is nothing to search for.
+ */
+static SearchScan*
+new_search_scan (CodeSlayerProfile *profile,
+                 const gchar       *find_text,
+                 const gchar       *file_text,
+                 GRegex            *find_regex,
+                 gboolean           match_case,
+                 gboolean           multiple_terms)
+{
+  CodeSlayerRegistry *registry; 
+  SearchScan *scan;
+  gint threads;
+  goffset max_file_size;
+  gboolean use_index;
+  gboolean use_uring;
+  gboolean show_ignored;
+  
+  scan = g_malloc0 (sizeof (SearchScan));
+  scan->profile = profile;
+  scan->match_case = match_case;
+  scan->find_regex = find_regex;
+
+  if (codeslayer_utils_has_text (find_text) && multiple_terms)
+    {
+      scan->find_terms = codeslayer_search_terms_new (find_text, match_case);
+    }
+  else if (codeslayer_utils_has_text (find_text) && find_regex == NULL)
+    {
+      gchar *find_globbing;
+      find_globbing = get_globbing (find_text, match_case);
+      scan->find_pattern = g_pattern_spec_new (find_globbing);
+      g_free (find_globbing);
+    }
+
+  if (codeslayer_utils_has_text (file_text))
+    {
+      gchar *file_globbing;
+      file_globbing = get_globbing (file_text, match_case);
+      scan->file_pattern = g_pattern_spec_new (file_globbing);
+      g_free (file_globbing);
+    }
+  
+  if (scan->find_pattern == NULL && scan->file_pattern == NULL 
+      && scan->find_regex == NULL && scan->find_terms == NULL)
+    {
+      free_search_scan (scan);
+      return NULL;
+    }
+
+  registry = codeslayer_profile_get_registry (profile);
+
+  scan->exclude = codeslayer_registry_get_exclude (registry);
+  
+  threads = codeslayer_registry_get_integer (registry,
+                                             CODESLAYER_REGISTRY_PROJECTS_SEARCH_THREADS);
+
+  /* the size is kept in kilobytes */
+  max_file_size = codeslayer_registry_get_integer (registry,
+                                                   CODESLAYER_REGISTRY_PROJECTS_SEARCH_MAX_FILE_SIZE);
+  max_file_size *= 1024;
+
+  use_index = codeslayer_registry_get_boolean (registry,
+                                               CODESLAYER_REGISTRY_PROJECTS_SEARCH_INDEX);
+  use_uring = codeslayer_registry_get_boolean (registry,
+                                               CODESLAYER_REGISTRY_PROJECTS_SEARCH_IO_URING);
+  show_ignored = codeslayer_registry_get_boolean (registry,
+                                                  CODESLAYER_REGISTRY_PROJECTS_SHOW_IGNORED);
+
+  scan->threads = threads;
+  scan->use_ignore_files = !show_ignored;
+  scan->find_contents = scan->find_pattern != NULL || scan->find_regex != NULL 
+                        || scan->find_terms != NULL;
+  scan->policy = codeslayer_search_policy_new (max_file_size);
+  scan->stats = codeslayer_search_stats_new ();
+
+  /* the index only helps when the contents are searched */
+  scan->use_index = use_index && scan->find_contents;
+  scan->use_uring = use_uring && scan->find_contents;
+  
+  /* plain text can be found directly in the file contents */
+  if (scan->find_pattern != NULL && codeslayer_search_matcher_is_literal (find_text))
+    {
+      scan->find_matcher = codeslayer_search_matcher_new (find_text, match_case);
+      if (scan->use_index)
+        scan->index_query = codeslayer_search_index_query_new (find_text, match_case);
+    }
+
+  /* only run the regular expression where its plain text shows up */
+  if (scan->find_regex != NULL)
+    {
+      gchar *literal;
+      literal = codeslayer_search_matcher_get_regex_literal (find_text);
+      if (literal != NULL)
+        {
+          scan->find_matcher = codeslayer_search_matcher_new (literal, match_case);
+          if (scan->use_index)
+            scan->index_query = codeslayer_search_index_query_new (literal, match_case);
+          g_free (literal);
+        }
+    }
+
+  /* a file has to contain at least one of the terms */
+  if (scan->find_terms != NULL && scan->use_index)
+    {
+      gchar **terms;
+      terms = codeslayer_search_terms_split (find_text);
+      scan->index_query = codeslayer_search_index_query_new_for_terms (terms, match_case);
+      g_strfreev (terms);
+    }
+
+  return scan;
+}
+
+/*
+ * The policy and the stats are not freed here, they go to the consumer 
+ * with the last batch.
+ */
+static void
+free_search_scan (SearchScan *scan)
+{
+  if (scan->find_pattern != NULL)
+    g_pattern_spec_free (scan->find_pattern);
+  if (scan->file_pattern != NULL)
+    g_pattern_spec_free (scan->file_pattern);
+  if (scan->find_terms != NULL)
+    codeslayer_search_terms_free (scan->find_terms);
+  if (scan->find_matcher != NULL)
+    codeslayer_search_matcher_free (scan->find_matcher);
+  if (scan->index_query != NULL)
+    codeslayer_search_index_query_free (scan->index_query);
+  if (scan->exclude != NULL)
+    codeslayer_search_exclude_unref (scan->exclude);
+  if (scan->seen != NULL)
+    free_search_seen (scan->seen);
+  g_free (scan);
+}
+
+/*
+ * Walks the projects and pushes the results on the queue of the scan, 
+ * followed by a batch without a file once the search is done. Runs on 
+ * its own thread, the consumer is on the other end of the queue.
+ */
+static void
+run_search_scan (SearchScan *scan)
+{
+  SearchBatch *done_batch;
+  gulong handler_id;
+
+  handler_id = g_cancellable_connect (scan->cancellable, G_CALLBACK (close_search_queue),
+                                      codeslayer_search_queue_ref (scan->queue), 
+                                      (GDestroyNotify) codeslayer_search_queue_unref);
+
+  scan->pool = codeslayer_search_pool_new (scan->threads, 
+                                           (CodeSlayerSearchPoolFunc) create_search_files, 
+                                           scan);
+                                                       
+  search_projects (scan);
+  
+  codeslayer_search_pool_free (scan->pool);
+
+  /* a batch without a file tells the main loop the search is done */
+  done_batch = g_malloc0 (sizeof (SearchBatch));
+  done_batch->policy = scan->policy;
+  done_batch->stats = scan->stats;
+  done_batch->seen = scan->seen;
+  scan->seen = NULL;
+  if (!codeslayer_search_queue_push (scan->queue, done_batch))
+    free_search_batch (done_batch);
+  g_cancellable_disconnect (scan->cancellable, handler_id);
+  codeslayer_search_queue_unref (scan->queue);
+
+  /* a stopped search is waited on, so it does not write anything */
+  if (scan->use_index && !g_cancellable_is_cancelled (scan->cancellable))
+    save_search_indexes (scan->search_indexes);
+}
+
+static void
+search_projects (SearchScan *scan)
+{
+  GList *projects;
+  GList *folder_paths = NULL;
+  GList *list;
+  
+  projects = codeslayer_profile_get_projects (scan->profile);
+
+  /* a folder shared by projects is walked by the innermost one */
+  for (list = projects; list != NULL; list = g_list_next (list))
+    folder_paths = g_list_prepend (folder_paths, 
+                                   (gpointer) codeslayer_project_get_folder_path (list->data));
+  scan->visited = codeslayer_search_visited_new (folder_paths);
+  g_list_free (folder_paths);
+
+  list = projects;
+  
+  while (list != NULL)
+    {
+      CodeSlayerProject *project;
+      const gchar *folder_path;
+      gchar *folder_path_expanded;
+      gboolean whole_project = TRUE;
+      
+      project = list->data;
+      folder_path = codeslayer_project_get_folder_path (project);
+
+      /* the same folder again, or a link to one that was walked */
+      if (scan->file_paths == NULL
+          && !codeslayer_search_visited_add_folder (scan->visited, folder_path))
+        {
+          list = g_list_next (list);
+          continue;
+        }
+
+      folder_path_expanded = g_strconcat (folder_path, G_DIR_SEPARATOR_S, NULL);
+      scan->project = project;
+      codeslayer_search_policy_set_skip_types (scan->policy, 
+                                               codeslayer_project_get_skip_types (project));
+
+      if (scan->use_index)
+        {
+          scan->index = get_search_index (scan, project);
+          codeslayer_search_index_begin (scan->index);
+        }
+      
+      if (scan->file_paths != NULL)
+        {
+          gchar **split, **tmp;
+          split = g_strsplit (scan->file_paths, ";", -1);
+          tmp = split;
+          whole_project = FALSE;
+
+          while (*tmp != NULL)
+            {
+              gchar *tmp_expanded;
+              tmp_expanded = g_strconcat (*tmp, G_DIR_SEPARATOR_S, NULL);
+              
+              /* the selected directory still gets the rules of the ones above it */
+              if (g_str_has_prefix (tmp_expanded, folder_path_expanded)
+                  && !codeslayer_search_visited_is_nested (scan->visited, folder_path, *tmp)
+                  && codeslayer_search_visited_add_folder (scan->visited, *tmp))
+                {
+                  CodeSlayerSearchIgnore *ignore = NULL;
+                  if (scan->use_ignore_files)
+                    {
+                      gchar *parent_path;
+                      parent_path = g_path_get_dirname (*tmp);
+                      ignore = codeslayer_search_ignore_new_for_folder (folder_path, parent_path);
+                      g_free (parent_path);
+                    }
+                  push_search_task (scan, g_file_new_for_path (*tmp), ignore);
+                  codeslayer_search_ignore_unref (ignore);
+                }
+              /* the walk above skips a project inside the selection, it is walked here */
+              else if (g_str_has_prefix (folder_path_expanded, tmp_expanded)
+                       && codeslayer_search_visited_add_folder (scan->visited, folder_path))
+                {
+                  push_search_task (scan, g_file_new_for_path (folder_path), NULL);
+                }
+
+              g_free (tmp_expanded);
+              tmp++;
+            }
+          g_strfreev (split);
+        }
+      else
+        {
+          push_search_task (scan, g_file_new_for_path (folder_path), NULL);
+        }
+      
+      /* finish the project so its results stay together in the tree */
+      codeslayer_search_pool_wait (scan->pool);
+
+      /* only a walk over every file knows which files are gone */
+      if (scan->index != NULL && whole_project && scan->file_pattern == NULL
+          && !g_cancellable_is_cancelled (scan->cancellable))
+        codeslayer_search_index_prune (scan->index);
+
+      g_free (folder_path_expanded);
+      list = g_list_next (list);
+    }
+    
+  codeslayer_search_visited_free (scan->visited);
+  scan->visited = NULL;
+  g_list_free (projects);
+}
+
+/*
+ * Takes ownership of the file, the ignore rules of the directory above 
+ * are shared. Each task is a single directory, so a large tree is spread 
+ * over all of the pool workers.
+ */
+static void
+push_search_task (SearchScan             *scan,
+                  GFile                  *file,
+                  CodeSlayerSearchIgnore *ignore)
+{
+  SearchTask *task;
+  task = g_malloc (sizeof (SearchTask));
+  task->scan = scan;
+  task->file = file;
+  task->ignore = codeslayer_search_ignore_ref (ignore);
+  codeslayer_search_pool_push (scan->pool, task);
+}
+
+static void
+create_search_files (SearchTask *task,
+                     SearchScan *scan)
+{
+  GFileEnumerator *enumerator;
+  CodeSlayerSearchStatsCounts *counts;
+  CodeSlayerSearchStatsTimer timer;
+  CodeSlayerSearchIgnore *ignore = NULL;
+  GFileInfo *folder_info = NULL;
+  gchar *folder_path;
+  GString *buffer;
+
+  /* the search was stopped, do not walk any further */
+  if (g_cancellable_is_cancelled (scan->cancellable))
+    {
+      codeslayer_search_ignore_unref (task->ignore);
+      g_object_unref (task->file);
+      g_free (task);
+      return;
+    }
+
+  counts = get_search_counts ();
+  codeslayer_search_stats_timer_start (&timer);
+
+  folder_path = g_file_get_path (task->file);
+  if (scan->use_ignore_files)
+    ignore = codeslayer_search_ignore_new (task->ignore, folder_path);
+
+  /* the time of the folder is taken first, a file added while it is listed changes it */
+  if (scan->seen != NULL)
+    folder_info = g_file_query_info (task->file, 
+                                     "standard::size,time::modified,time::modified-usec",
+                                     G_FILE_QUERY_INFO_NONE, scan->cancellable, NULL);
+
+  enumerator = g_file_enumerate_children (task->file, 
+                                          "standard::*,time::modified,time::modified-usec,"
+                                          "unix::device,unix::inode,unix::nlink",
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, 
+                                          scan->cancellable, NULL);
+  if (enumerator != NULL)
+    {
+      GFileInfo *file_info;
+      GArray *candidates;
+      
+      /* one scratch buffer for the whole directory */
+      buffer = g_string_sized_new (256);
+      candidates = g_array_new (FALSE, FALSE, sizeof (SearchCandidate));
+
+      while ((file_info = g_file_enumerator_next_file (enumerator, scan->cancellable, NULL)) != NULL)
+        {
+          const char *file_name = g_file_info_get_name (file_info);
+          
+          /* only a directory needs a file object, a file only needs its path, 
+             and the folder of another project is walked with that project */
+          if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY
+              && !codeslayer_search_visited_is_project_folder (scan->visited, folder_path, file_name))
+            {
+              if (codeslayer_search_exclude_is_excluded_dir (scan->exclude, file_name)
+                  || codeslayer_search_ignore_is_ignored (ignore, folder_path, file_name, TRUE))
+                counts->counters[CODESLAYER_SEARCH_STATS_DIRECTORIES_EXCLUDED]++;
+              else if (codeslayer_search_visited_add (scan->visited, file_info))
+                push_search_task (scan, g_file_get_child (task->file, file_name), ignore);
+            }
+
+          if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_REGULAR)
+            {
+              SearchCandidate candidate;
+              if (codeslayer_search_exclude_is_excluded_file (scan->exclude, file_name)
+                  || codeslayer_search_ignore_is_ignored (ignore, folder_path, file_name, FALSE))
+                counts->counters[CODESLAYER_SEARCH_STATS_FILES_EXCLUDED]++;
+              else if (codeslayer_search_visited_add (scan->visited, file_info)
+                       && create_search_candidate (scan, folder_path, file_info, buffer, &candidate))
+                g_array_append_val (candidates, candidate);
+            }
+ 
+          g_object_unref (file_info);
+        }
+
+      counts->counters[CODESLAYER_SEARCH_STATS_DIRECTORIES]++;
+      codeslayer_search_stats_timer_lap (&timer, counts, CODESLAYER_SEARCH_STATS_WALK);
+
+      if (folder_info != NULL)
+        add_seen_files (scan->seen, folder_path, folder_info, candidates);
+
+      /* the whole directory is listed first, then read with the disk ahead */
+      scan_search_candidates (scan, candidates, buffer, &timer);
+
+      g_array_free (candidates, TRUE);
+      g_string_free (buffer, TRUE);
+      g_object_unref (enumerator);
+    }
+
+  codeslayer_search_stats_timer_sample (&timer, counts);
+  codeslayer_search_stats_merge (scan->stats, counts);
+
+  if (folder_info != NULL)
+    g_object_unref (folder_info);
+
+  codeslayer_search_ignore_unref (ignore);
+  codeslayer_search_ignore_unref (task->ignore);
+  g_free (folder_path);
+  g_object_unref (task->file);
+  g_free (task);
+}
+
+/*
+ * Returns TRUE if the file has to be read. A file that is only listed, 
+ * or that the index already knows is binary, is done with here.
+ */
+static gboolean
+create_search_candidate (SearchScan      *scan,
+                         const gchar     *folder_path,
+                         GFileInfo       *file_info,
+                         GString         *buffer,
+                         SearchCandidate *candidate)
+{
+  GPatternSpec *file_pattern = scan->file_pattern;
+  const gchar *file_name;
+
+  file_name = g_file_info_get_name (file_info);
+  candidate->size = g_file_info_get_size (file_info);
+  candidate->index_result = CODESLAYER_SEARCH_INDEX_STALE;
+  candidate->read = FALSE;
+
+  if (file_pattern != NULL)
+    {
+      const gchar *text = file_name;
+      
+      if (!scan->match_case)
+        {
+          g_string_assign (buffer, file_name);
+          codeslayer_search_matcher_fold (buffer->str, buffer->len);
+          text = buffer->str;
+        }
+
+      if (!g_pattern_match_string (file_pattern, text))
+        return FALSE;
+    }
+
+  /* only the files that are read have to pass the policy */
+  if (scan->find_contents 
+      && codeslayer_search_policy_check (scan->policy, file_name, candidate->size) != CODESLAYER_SEARCH_POLICY_ACCEPT)
+    return FALSE;
+    
+  candidate->file_path = g_build_filename (folder_path, file_name, NULL);
+  candidate->file_name = candidate->file_path + strlen (candidate->file_path) - strlen (file_name);
+  candidate->mtime = get_modification_time (file_info);
+
+  if (scan->index != NULL)
+    candidate->index_result = codeslayer_search_index_lookup (scan->index, scan->index_query, 
+                                                              candidate->file_path, 
+                                                              candidate->mtime, candidate->size);
+
+  if (scan->find_contents && scan->snapshots != NULL)
+    {
+      GBytes *snapshot;
+      snapshot = g_hash_table_lookup (scan->snapshots, candidate->file_path);
+      if (snapshot != NULL)
+        {
+          gsize length;
+          const gchar *contents;
+          
+          /* the entry is about the file on disk, so leave it alone */
+          candidate->index_result = CODESLAYER_SEARCH_INDEX_MATCH;
+          contents = g_bytes_get_data (snapshot, &length);
+          if (length > 0)
+            create_search_results (scan, candidate, -1, contents, length, buffer);
+          g_free (candidate->file_path);
+          return FALSE;
+        }
+    }
+
+  if (!scan->find_contents)
+    {
+      create_search_results (scan, candidate, -1, NULL, 0, buffer);
+    }
+  else if (candidate->index_result == CODESLAYER_SEARCH_INDEX_BINARY)
+    {
+      codeslayer_search_policy_skip (scan->policy, CODESLAYER_SEARCH_POLICY_SKIP_BINARY);
+    }
+  else if (candidate->index_result != CODESLAYER_SEARCH_INDEX_NO_MATCH)
+    {
+      return TRUE;
+    }
+
+  g_free (candidate->file_path);
+  return FALSE;
+}
+
+/*
+ * Reads the files ahead of the one that is matched, so the disk and 
+ * the worker are busy at the same time.
+ */
+static void
+scan_search_candidates (SearchScan                 *scan,
+                        GArray                     *candidates,
+                        GString                    *buffer,
+                        CodeSlayerSearchStatsTimer *timer)
+{
+  CodeSlayerSearchPrefetch *prefetch;
+  CodeSlayerSearchStatsCounts *counts;
+  guint ahead = 0;
+  guint i;
+
+  counts = get_search_counts ();
+
+  if (scan->use_uring)
+    read_search_candidates (scan, candidates, buffer, timer);
+
+  prefetch = codeslayer_search_prefetch_new (SEARCH_PREFETCH_FILES, SEARCH_PREFETCH_BYTES);
+
+  for (i = 0; i < candidates->len; i++)
+    {
+      SearchCandidate *candidate;
+      gint fd = -1;
+
+      candidate = &g_array_index (candidates, SearchCandidate, i);
+
+      if (!candidate->read && !g_cancellable_is_cancelled (scan->cancellable))
+        {
+          while (ahead < candidates->len)
+            {
+              SearchCandidate *next;
+              next = &g_array_index (candidates, SearchCandidate, ahead);
+              if (!next->read && !codeslayer_search_prefetch_push (prefetch, next->file_path, next->size))
+                break;
+              ahead++;
+            }
+
+          fd = codeslayer_search_prefetch_take (prefetch, candidate->file_path);
+          codeslayer_search_stats_timer_lap (timer, counts, CODESLAYER_SEARCH_STATS_READ);
+          create_search_results (scan, candidate, fd, NULL, 0, buffer);
+          codeslayer_search_stats_timer_lap (timer, counts, CODESLAYER_SEARCH_STATS_MATCH);
+        }
+
+      g_free (candidate->file_path);
+    }
+
+  codeslayer_search_prefetch_free (prefetch);
+}
+
+/*
+ * Reads the small files of the directory through io_uring, a few calls 
+ * for a whole batch instead of three for every file. A file that is not 
+ * the size it was listed with is left to the usual path.
+ */
+static void
+read_search_candidates (SearchScan                 *scan,
+                        GArray                     *candidates,
+                        GString                    *buffer,
+                        CodeSlayerSearchStatsTimer *timer)
+{
+  CodeSlayerSearchReader *reader;
+  SearchRead search_read;
+  GPtrArray *file_paths;
+  GArray *limits;
+  guint i;
+
+  reader = g_private_get (&search_reader);
+  if (reader == NULL)
+    {
+      reader = codeslayer_search_reader_new (TRUE);
+      g_private_set (&search_reader, reader);
+    }
+
+  /* without the kernel support the prefetch path is the faster one */
+  if (!codeslayer_search_reader_has_uring (reader))
+    return;
+
+  file_paths = g_ptr_array_new ();
+  limits = g_array_new (FALSE, FALSE, sizeof (gsize));
+  search_read.scan = scan;
+  search_read.candidates = candidates;
+  search_read.indexes = g_array_new (FALSE, FALSE, sizeof (guint));
+  search_read.buffer = buffer;
+  search_read.timer = timer;
+
+  for (i = 0; i < candidates->len; i++)
+    {
+      SearchCandidate *candidate;
+      gsize limit;
+
+      candidate = &g_array_index (candidates, SearchCandidate, i);
+      if (candidate->size > SEARCH_READER_SIZE)
+        continue;
+
+      /* one byte more tells a file that grew */
+      limit = candidate->size + 1;
+      g_ptr_array_add (file_paths, candidate->file_path);
+      g_array_append_val (limits, limit);
+      g_array_append_val (search_read.indexes, i);
+    }
+
+  if (file_paths->len > 0)
+    codeslayer_search_reader_read (reader, (const gchar * const *) file_paths->pdata, 
+                                   (const gsize *) limits->data, file_paths->len, 
+                                   (CodeSlayerSearchReaderFunc) read_search_candidate, 
+                                   &search_read);
+
+  codeslayer_search_stats_timer_lap (timer, get_search_counts (), CODESLAYER_SEARCH_STATS_READ);
+
+  g_array_free (search_read.indexes, TRUE);
+  g_array_free (limits, TRUE);
+  g_ptr_array_free (file_paths, TRUE);
+}
+
+static void
+read_search_candidate (guint        index,
+                       const gchar *contents,
+                       gssize       length,
+                       SearchRead  *search_read)
+{
+  CodeSlayerSearchStatsCounts *counts;
+  SearchCandidate *candidate;
+  guint i;
+
+  if (g_cancellable_is_cancelled (search_read->scan->cancellable))
+    return;
+
+  i = g_array_index (search_read->indexes, guint, index);
+  candidate = &g_array_index (search_read->candidates, SearchCandidate, i);
+
+  if (contents == NULL || length != candidate->size)
+    return;
+
+  counts = get_search_counts ();
+  codeslayer_search_stats_timer_lap (search_read->timer, counts, CODESLAYER_SEARCH_STATS_READ);
+  create_search_results (search_read->scan, candidate, -1, contents, length, 
+                         search_read->buffer);
+  codeslayer_search_stats_timer_lap (search_read->timer, counts, CODESLAYER_SEARCH_STATS_MATCH);
+  candidate->read = TRUE;
+}
+
+/*
+ * Takes the file, which is -1 when the contents are not searched or 
+ * were already read into contents.
+ */
+static void
+create_search_results (SearchScan      *scan,
+                       SearchCandidate *candidate,
+                       gint             fd,
+                       const gchar     *contents,
+                       gsize            length,
+                       GString         *buffer)
+{
+  SearchFileContext context;
+
+  context.scan = scan;
+  context.search_file = NULL;
+  context.search_batch = NULL;
+  context.file_path = candidate->file_path;
+  context.file_name = candidate->file_name;
+  context.line = buffer;
+  context.matches = NULL;
+  context.counts = get_search_counts ();
+  context.index_entry = NULL;
+  context.mtime = candidate->mtime;
+  context.size = candidate->size;
+  context.closed = FALSE;
+
+  if (!scan->find_contents)
+    {
+      context.counts->counters[CODESLAYER_SEARCH_STATS_MATCHES]++;
+      push_search_batch (&context, TRUE);
+    }
+  else
+    {
+      CodeSlayerSearchScannerResult result;
+      CodeSlayerSearchScannerCount count;
+      CodeSlayerSearchScannerBlockFunc block_func = NULL;
+
+      if (contents != NULL || fd != -1)
+        context.counts->counters[CODESLAYER_SEARCH_STATS_FILES_OPENED]++;
+
+      /* the file is read anyway, its entry is filled from the same blocks */
+      if (scan->index != NULL && candidate->index_result == CODESLAYER_SEARCH_INDEX_STALE)
+        {
+          context.index_entry = codeslayer_search_index_entry_new (candidate->size);
+          block_func = (CodeSlayerSearchScannerBlockFunc) add_index_text;
+        }
+
+      if (contents != NULL)
+        result = codeslayer_search_scanner_scan_text (contents, length, scan->cancellable, &count,
+                                                      (CodeSlayerSearchScannerFindFunc) find_match, 
+                                                      (CodeSlayerSearchScannerLineFunc) add_search_result, 
+                                                      block_func, &context);
+      else
+        result = codeslayer_search_scanner_scan_fd (fd, scan->cancellable, &count,
+                                                    (CodeSlayerSearchScannerFindFunc) find_match, 
+                                                    (CodeSlayerSearchScannerLineFunc) add_search_result, 
+                                                    block_func, &context);
+
+      context.counts->counters[CODESLAYER_SEARCH_STATS_BYTES_READ] += count.bytes;
+      context.counts->counters[CODESLAYER_SEARCH_STATS_LINES_SCANNED] += count.lines;
+      if (result == CODESLAYER_SEARCH_SCANNER_BINARY)
+        codeslayer_search_policy_skip (scan->policy, CODESLAYER_SEARCH_POLICY_SKIP_BINARY);
+      if ((context.search_file != NULL || context.search_batch != NULL) && !context.closed)
+        push_search_batch (&context, TRUE);
+
+      if (context.index_entry != NULL)
+        {
+          if (result == CODESLAYER_SEARCH_SCANNER_BINARY)
+            codeslayer_search_index_entry_set_binary (context.index_entry);
+
+          if (result != CODESLAYER_SEARCH_SCANNER_FAILED && !context.closed)
+            codeslayer_search_index_add (scan->index, candidate->file_path, candidate->mtime, 
+                                         candidate->size, context.index_entry);
+          else
+            codeslayer_search_index_entry_free (context.index_entry);
+        }
+    }
+  
+  if (context.matches != NULL)
+    g_array_free (context.matches, TRUE);
+}
+
+static void
+add_index_text (const gchar       *text,
+                gsize              length,
+                SearchFileContext *context)
+{
+  codeslayer_search_index_entry_add_text (context->index_entry, text, length);
+}
+
+static gssize
+find_match (const gchar       *text,
+            gsize              length,
+            SearchFileContext *context)
+{
+  SearchScan *scan = context->scan;
+  const gchar *end = text + length;
+  const gchar *line_start = text;
+
+  if (context->closed || g_cancellable_is_cancelled (scan->cancellable))
+    return -1;
+
+  if (scan->find_terms != NULL)
+    return codeslayer_search_terms_find (scan->find_terms, text, length);
+
+  if (scan->find_regex != NULL)
+    return find_regex_match (scan, text, length);
+
+  if (scan->find_matcher != NULL)
+    return codeslayer_search_matcher_find (scan->find_matcher, text, length);
+
+  /* the globbing needs nul terminated lines so reuse one buffer for them */
+  while (line_start < end)
+    {
+      const gchar *line_end;
+
+      line_end = memchr (line_start, '\n', end - line_start);
+      if (line_end == NULL)
+        line_end = end;
+
+      g_string_truncate (context->line, 0);
+      g_string_append_len (context->line, line_start, line_end - line_start);
+      if (!scan->match_case)
+        codeslayer_search_matcher_fold (context->line->str, context->line->len);
+
+      if (g_pattern_match_string (scan->find_pattern, context->line->str))
+        return line_start - text;
+
+      line_start = line_end + 1;
+    }
+
+  return -1;
+}
+
+/*
+ * Matches line by line like grep does. Every candidate is checked 
+ * again on its own line, since a match over the whole text may run 
+ * into the next line. A GMatchInfo can not be reused between calls, 
+ * so one is only created when there is no plain text to look for.
+ */
+static gssize
+find_regex_match (SearchScan  *scan,
+                  const gchar *text,
+                  gsize        length)
+{
+  const gchar *end = text + length;
+  const gchar *pos = text;
+
+  /* pos is always at the start of a line */
+  while (pos < end)
+    {
+      const gchar *candidate;
+      const gchar *line_start;
+      const gchar *line_end;
+      const gchar *match_end = NULL;
+
+      if (scan->find_matcher != NULL)
+        {
+          gssize offset;
+          offset = codeslayer_search_matcher_find (scan->find_matcher, pos, end - pos);
+          if (offset < 0)
+            return -1;
+          candidate = pos + offset;
+        }
+      else
+        {
+          GMatchInfo *match_info;
+          gint start_pos;
+          gint end_pos;
+          
+          if (!g_regex_match_full (scan->find_regex, pos, end - pos, 0, 0, &match_info, NULL))
+            {
+              g_match_info_free (match_info);
+              return -1;
+            }
+          g_match_info_fetch_pos (match_info, 0, &start_pos, &end_pos);
+          g_match_info_free (match_info);
+          candidate = pos + start_pos;
+          match_end = pos + end_pos;
+        }
+
+      line_start = candidate;
+      while (line_start > pos && line_start[-1] != '\n')
+        line_start--;
+
+      line_end = memchr (candidate, '\n', end - candidate);
+      if (line_end == NULL)
+        line_end = end;
+
+      if ((match_end != NULL && match_end <= line_end)
+          || g_regex_match_full (scan->find_regex, line_start, line_end - line_start, 
+                                 0, 0, NULL, NULL))
+        return line_start - text;
+
+      pos = line_end + 1;
+    }
+
+  return -1;
+}
+
+static void
+add_search_result (const gchar       *line,
+                   gsize              length,
+                   gint               line_number,
+                   goffset            offset,
+                   SearchFileContext *context)
+{
+  SearchBatch *search_batch;
+  SearchResult search_result;
+
+  search_batch = context->search_batch;
+  if (search_batch == NULL)
+    {
+      search_batch = g_malloc0 (sizeof (SearchBatch));
+      context->search_batch = search_batch;
+    }
+
+  if (search_batch->search_results == NULL)
+    {
+      search_batch->search_results = g_array_sized_new (FALSE, FALSE, sizeof (SearchResult), 
+                                                        SEARCH_BATCH_LENGTH);
+      search_batch->text_chunk = g_string_chunk_new (SEARCH_BATCH_LENGTH * 64);
+    }
+
+  find_result_match (context->scan, line, length, &search_result);
+
+  search_result.line_number = line_number;
+  search_result.line_offset = offset;
+
+  /* the command line prints the line as it is, only the tree gets a window 
+     and needs the text to be valid */
+  if (context->scan->full_lines)
+    {
+      search_result.indent = 0;
+      search_result.truncated = FALSE;
+      search_result.text = g_string_chunk_insert_len (search_batch->text_chunk, line, length);
+    }
+  else
+    {
+      insert_result_text (search_batch->text_chunk, context->line, line, length, &search_result);
+    }
+
+  search_result.terms = NULL;
+  if (context->scan->find_terms != NULL)
+    search_result.terms = insert_matched_terms (context, search_batch->text_chunk, 
+                                                line, length);
+  g_array_append_val (search_batch->search_results, search_result);
+  context->counts->counters[CODESLAYER_SEARCH_STATS_MATCHES]++;
+  
+  if (search_batch->search_results->len >= SEARCH_BATCH_LENGTH)
+    push_search_batch (context, FALSE);
+}
+
+/*
+ * Finds the hit on its line again, so opening the result can select it 
+ * without searching the document. A globbing match has no range.
+ */
+static void
+find_result_match (SearchScan   *scan,
+                   const gchar  *line,
+                   gsize         length,
+                   SearchResult *search_result)
+{
+  gssize offset = -1;
+  gsize match_length = 0;
+
+  if (scan->find_terms != NULL)
+    {
+      offset = codeslayer_search_terms_find_match (scan->find_terms, line, length, &match_length);
+    }
+  else if (scan->find_regex != NULL)
+    {
+      GMatchInfo *match_info;
+      if (g_regex_match_full (scan->find_regex, line, length, 0, 0, &match_info, NULL))
+        {
+          gint start_pos;
+          gint end_pos;
+          g_match_info_fetch_pos (match_info, 0, &start_pos, &end_pos);
+          offset = start_pos;
+          match_length = end_pos - start_pos;
+        }
+      g_match_info_free (match_info);
+    }
+  else if (scan->find_matcher != NULL)
+    {
+      offset = codeslayer_search_matcher_find (scan->find_matcher, line, length);
+      if (offset >= 0)
+        match_length = codeslayer_search_matcher_get_length (scan->find_matcher, line + offset,
+                                                             length - offset);
+    }
+
+  search_result->match_offset = MAX (offset, 0);
+  search_result->match_length = offset >= 0 ? match_length : 0;
+}
+
+/*
+ * Puts the line without the space around it in the text of the result. 
+ * A long line only keeps a window around the match, with an ellipsis 
+ * where it was cut, so a hit in a minified file costs no more than any
+ * other hit.
+ */
+static void
+insert_result_text (GStringChunk *text_chunk,
+                    GString      *buffer,
+                    const gchar  *line,
+                    gsize         length,
+                    SearchResult *search_result)
+{
+  const gchar *start = line;
+  const gchar *end = line + length;
+  const gchar *from;
+  const gchar *to;
+
+  /* same as g_strstrip without the copy */
+  while (start < end && g_ascii_isspace (*start))
+    start++;
+  while (end > start && g_ascii_isspace (end[-1]))
+    end--;
+
+  search_result->indent = start - line;
+
+  if (end - start <= SEARCH_SNIPPET_LENGTH)
+    {
+      search_result->truncated = FALSE;
+      search_result->text = insert_valid_text (text_chunk, start, end - start);
+      return;
+    }
+
+  from = line + MAX (search_result->match_offset - SEARCH_SNIPPET_BEFORE, 0);
+  from = CLAMP (from, start, end - SEARCH_SNIPPET_LENGTH);
+  to = from + SEARCH_SNIPPET_LENGTH;
+
+  /* keep whole characters at both ends */
+  while (from > start && (*from & 0xC0) == 0x80)
+    from--;
+  while (to < end && (*to & 0xC0) == 0x80)
+    to++;
+
+  g_string_truncate (buffer, 0);
+  if (from > start)
+    g_string_append (buffer, SEARCH_SNIPPET_ELLIPSIS);
+  g_string_append_len (buffer, from, to - from);
+  if (to < end)
+    g_string_append (buffer, SEARCH_SNIPPET_ELLIPSIS);
+
+  search_result->truncated = TRUE;
+  search_result->text = insert_valid_text (text_chunk, buffer->str, buffer->len);
+}
+
+/*
+ * Same as the context of the preview, a byte that is not part of a 
+ * character shows as a question mark. The bytes keep their offsets, 
+ * so the match can still be selected.
+ */
+static gchar*
+insert_valid_text (GStringChunk *text_chunk,
+                   const gchar  *text,
+                   gsize         length)
+{
+  const gchar *end;
+  const gchar *pos;
+  gchar *copy;
+
+  copy = g_string_chunk_insert_len (text_chunk, text, length);
+  end = copy + length;
+  pos = copy;
+
+  while (!g_utf8_validate (pos, end - pos, &pos))
+    {
+      /* a nul also stops the validation */
+      *(gchar*) pos = '?';
+      pos++;
+    }
+
+  return copy;
+}
+
+/*
+ * Lists the terms on the line. The line buffer is free to use here,
+ * since only the globbing needs it.
+ */
+static const gchar*
+insert_matched_terms (SearchFileContext *context,
+                      GStringChunk      *text_chunk,
+                      const gchar       *line,
+                      gsize              length)
+{
+  CodeSlayerSearchTerms *find_terms = context->scan->find_terms;
+  guint i;
+
+  if (context->matches == NULL)
+    context->matches = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  g_array_set_size (context->matches, 0);
+  codeslayer_search_terms_get_matches (find_terms, line, length, context->matches);
+
+  g_string_truncate (context->line, 0);
+  for (i = 0; i < context->matches->len; i++)
+    {
+      guint term = g_array_index (context->matches, guint, i);
+      if (i > 0)
+        g_string_append (context->line, ", ");
+      g_string_append (context->line, codeslayer_search_terms_get_term (find_terms, term));
+    }
+
+  return g_string_chunk_insert_len (text_chunk, context->line->str, context->line->len);
+}
+
+/*
+ * Hands the hits found so far to the main loop. The last batch of a 
+ * file passes the search file on to the main loop as well.
+ */
+static void
+push_search_batch (SearchFileContext *context,
+                   gboolean           last)
+{
+  SearchBatch *search_batch;
+  gboolean first;
+
+  first = context->search_file == NULL;
+
+  if (context->search_file == NULL)
+    {
+      SearchFile *search_file;
+      gchar *file_path;
+      gsize length;
+
+      length = strlen (context->file_path);
+      search_file = g_malloc (sizeof (SearchFile) + length + 1);
+      file_path = (gchar*) (search_file + 1);
+      memcpy (file_path, context->file_path, length + 1);
+      search_file->file_path = file_path;
+      search_file->file_name = file_path + length - strlen (context->file_name);
+      search_file->project = context->scan->project;
+      search_file->mtime = context->mtime;
+      search_file->size = context->size;
+      search_file->cache_file = NULL;
+      context->search_file = search_file;
+    }
+
+  search_batch = context->search_batch;
+  if (search_batch == NULL)
+    search_batch = g_malloc0 (sizeof (SearchBatch));
+
+  search_batch->first = first;
+  search_batch->search_file = context->search_file;
+  search_batch->last = last;
+  context->search_batch = NULL;
+
+  if (!codeslayer_search_queue_push (context->scan->queue, search_batch))
+    {
+      /* the search was stopped, the file is not needed anymore */
+      search_batch->last = TRUE;
+      free_search_batch (search_batch);
+      context->closed = TRUE;
+    }
+}
+
+static void
+free_search_batch (SearchBatch *search_batch)
+{
+  if (search_batch->search_results != NULL)
+    {
+      g_array_free (search_batch->search_results, TRUE);
+      g_string_chunk_free (search_batch->text_chunk);
+    }
+
+  if (search_batch->last)
+    g_free (search_batch->search_file);
+
+  if (search_batch->policy != NULL)
+    codeslayer_search_policy_free (search_batch->policy);
+
+  if (search_batch->stats != NULL)
+    codeslayer_search_stats_unref (search_batch->stats);
+
+  if (search_batch->seen != NULL)
+    free_search_seen (search_batch->seen);
+
+  g_free (search_batch);
+}
+
+/*
+ * Called from a worker when the first batch arrives after the main loop
+ * ran out of batches.
+ */
+static void
+wake_search_stream (SearchStream *stream)
+{
+  g_idle_add ((GSourceFunc) drain_search_stream, stream);
+}
+
+static void
+wake_search_grep (SearchGrep *grep)
+{
+  g_mutex_lock (&grep->mutex);
+  grep->woken = TRUE;
+  g_cond_signal (&grep->cond);
+  g_mutex_unlock (&grep->mutex);
+}
+
+/*
+ * Adds batches to the tree for a short while and then gives the main 
+ * loop back, so the window stays responsive while the search runs.
+ */
+static gboolean
+drain_search_stream (SearchStream *stream)
+{
+  CodeSlayerSearchStatsTimer timer;
+  gint64 end_time;
+
+  end_time = g_get_monotonic_time () + SEARCH_TIME_BUDGET;
+  codeslayer_search_stats_timer_start (&timer);
+
+  do
+    {
+      SearchBatch *search_batch;
+
+      /* check first, a cancelled search may belong to a window that is gone */
+      if (g_cancellable_is_cancelled (stream->cancellable))
+        {
+          finish_search_stream (stream);
+          return FALSE;
+        }
+
+      search_batch = codeslayer_search_queue_pop (stream->queue);
+      if (search_batch == NULL)
+        {
+          codeslayer_search_stats_timer_sample (&timer, &stream->counts);
+          if (codeslayer_search_queue_sleep (stream->queue))
+            return FALSE;
+          continue;
+        }
+
+      if (search_batch->search_file == NULL)
+        {
+          CodeSlayerProjectsSearchPrivate *priv;
+          priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (stream->search);
+          gtk_widget_set_sensitive (priv->stop_button, FALSE);
+          codeslayer_search_model_sort (priv->model);
+          codeslayer_search_stats_timer_lap (&timer, &stream->counts, CODESLAYER_SEARCH_STATS_DISPLAY);
+          codeslayer_search_stats_timer_sample (&timer, &stream->counts);
+          codeslayer_search_stats_merge (search_batch->stats, &stream->counts);
+          codeslayer_search_stats_finish (search_batch->stats);
+          show_skipped (stream->search, search_batch->policy);
+          show_stats (stream->search, search_batch->stats);
+          write_stats (stream->search, search_batch->stats);
+          if (priv->search_cache != NULL && search_batch->seen != NULL)
+            {
+              priv->search_cache->complete = TRUE;
+              priv->search_cache->seen = search_batch->seen;
+              search_batch->seen = NULL;
+            }
+          priv->finished = TRUE;
+          g_signal_emit_by_name ((gpointer) stream->search, "search-finished", 
+                                 search_batch->stats);
+          free_search_batch (search_batch);
+          finish_search_stream (stream);
+          return FALSE;
+        }
+
+      add_search_batch (stream, search_batch);
+      free_search_batch (search_batch);
+      codeslayer_search_stats_timer_lap (&timer, &stream->counts, CODESLAYER_SEARCH_STATS_DISPLAY);
+    }
+  while (g_get_monotonic_time () < end_time);
+
+  codeslayer_search_stats_timer_sample (&timer, &stream->counts);
+
+  return TRUE;
+}
+
+static void
+add_search_batch (SearchStream *stream, 
+                  SearchBatch  *search_batch)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  SearchFile *search_file = search_batch->search_file;
+  guint i;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (stream->search);
+
+  if (stream->project != search_file->project)
+    {
+      stream->project = search_file->project;
+      add_project (stream->search, stream->project, &stream->project_iter);
+    }
+
+  if (search_batch->first)
+    add_file_row (stream->search, &stream->project_iter, search_file->project, 
+                  search_file->file_path, search_file->file_name, 
+                  search_batch->search_results != NULL, &search_file->iter);
+  
+  for (i = 0; search_batch->search_results != NULL && i < search_batch->search_results->len; i++)
+    {
+      SearchResult *search_result;
+      search_result = &g_array_index (search_batch->search_results, SearchResult, i);
+      add_result_row (stream->search, &search_file->iter, search_result);
+    }
+
+  if (priv->search_cache != NULL)
+    cache_search_batch (priv->search_cache, search_batch);
+}
+
+static void
+add_file_row (CodeSlayerProjectsSearch *search,
+              GtkTreeIter              *project_iter,
+              CodeSlayerProject        *project,
+              const gchar              *file_path,
+              const gchar              *file_name,
+              gboolean                  has_results,
+              GtkTreeIter              *file_iter)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  const gchar *project_folder_path;
+  gchar *search_file_name;
+  gchar *search_file_path;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  project_folder_path = codeslayer_project_get_folder_path (project);
+
+  search_file_path = codeslayer_utils_substr (file_path,
+                                              strlen (project_folder_path) + 1,
+                                              strlen (file_path));
+                                      
+  search_file_name = g_strconcat (file_name, " - ", search_file_path, NULL);
+  
+  codeslayer_search_model_append_file (priv->model, project_iter, file_path, 
+                                       search_file_name, has_results, file_iter);
+
+  g_free (search_file_path);
+  g_free (search_file_name);
+}
+
+static void
+add_result_row (CodeSlayerProjectsSearch *search,
+                GtkTreeIter              *file_iter,
+                SearchResult             *search_result)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  codeslayer_search_model_append_result (priv->model, file_iter, 
+                                         search_result->line_number,
+                                         search_result->line_offset,
+                                         search_result->match_offset,
+                                         search_result->match_length,
+                                         search_result->text, 
+                                         search_result->terms);
+}
+
+/*
+ * Closing the queue releases any worker waiting for room and stops the
+ * workers from looking any further.
+ */
+static void
+finish_search_stream (SearchStream *stream)
+{
+  codeslayer_search_queue_close (stream->queue);
+  codeslayer_search_queue_unref (stream->queue);
+  g_object_unref (stream->cancellable);
+  g_free (stream);
+}
+
+/*
+ * Everything besides the entries that decides which files are searched.
+ * A cache is only good for a search with the same settings.
+ */
+static gchar*
+get_search_settings (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  CodeSlayerRegistry *registry;
+  gchar *exclude_types_str;
+  gchar *exclude_dirs_str;
+  gchar *settings;
+  gint max_file_size;
+  gboolean show_ignored;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  registry = codeslayer_profile_get_registry (priv->profile);
+  exclude_types_str = codeslayer_registry_get_string (registry,
+                                                      CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_TYPES);
+  exclude_dirs_str = codeslayer_registry_get_string (registry,
+                                                     CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_DIRS);
+  max_file_size = codeslayer_registry_get_integer (registry,
+                                                   CODESLAYER_REGISTRY_PROJECTS_SEARCH_MAX_FILE_SIZE);
+  show_ignored = codeslayer_registry_get_boolean (registry,
+                                                  CODESLAYER_REGISTRY_PROJECTS_SHOW_IGNORED);
+
+  settings = g_strdup_printf ("%s\n%s\n%s\n%d\n%d", 
+                              has_selection_scope (search) && priv->file_paths ? priv->file_paths : "",
+                              exclude_types_str, exclude_dirs_str, max_file_size, show_ignored);
+
+  g_free (exclude_types_str);
+  g_free (exclude_dirs_str);
+
+  return settings;
+}
+
+static SearchCache*
+create_search_cache (CodeSlayerProjectsSearch *search,
+                     const gchar              *settings)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  SearchCache *search_cache;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  search_cache = g_malloc (sizeof (SearchCache));
+  search_cache->find_text = g_strdup (priv->find_text);
+  search_cache->file_text = g_strdup (priv->file_text);
+  search_cache->settings = g_strdup (settings);
+  search_cache->match_case = priv->match_case;
+  search_cache->complete = FALSE;
+  search_cache->seen = NULL;
+  search_cache->cache_files = g_ptr_array_new ();
+  search_cache->text_chunk = g_string_chunk_new (4096);
+
+  return search_cache;
+}
+
+static void
+free_search_cache (SearchCache *search_cache)
+{
+  guint i;
+
+  for (i = 0; i < search_cache->cache_files->len; i++)
+    {
+      SearchCacheFile *cache_file = g_ptr_array_index (search_cache->cache_files, i);
+      g_array_free (cache_file->search_results, TRUE);
+      g_free (cache_file);
+    }
+
+  g_ptr_array_free (search_cache->cache_files, TRUE);
+  g_string_chunk_free (search_cache->text_chunk);
+  if (search_cache->seen != NULL)
+    free_search_seen (search_cache->seen);
+  g_free (search_cache->find_text);
+  g_free (search_cache->file_text);
+  g_free (search_cache->settings);
+  g_free (search_cache);
+}
+
+static void
+cache_search_batch (SearchCache *search_cache,
+                    SearchBatch *search_batch)
+{
+  SearchFile *search_file = search_batch->search_file;
+  SearchCacheFile *cache_file;
+  guint i;
+
+  if (search_batch->search_results == NULL)
+    return;
+
+  cache_file = search_file->cache_file;
+  if (cache_file == NULL)
+    {
+      cache_file = g_malloc (sizeof (SearchCacheFile));
+      cache_file->file_path = g_string_chunk_insert (search_cache->text_chunk, 
+                                                     search_file->file_path);
+      cache_file->file_name = cache_file->file_path + strlen (cache_file->file_path) 
+                              - strlen (search_file->file_name);
+      cache_file->project = search_file->project;
+      cache_file->mtime = search_file->mtime;
+      cache_file->size = search_file->size;
+      cache_file->search_results = g_array_new (FALSE, FALSE, sizeof (SearchResult));
+      g_ptr_array_add (search_cache->cache_files, cache_file);
+      search_file->cache_file = cache_file;
+    }
+
+  for (i = 0; i < search_batch->search_results->len; i++)
+    {
+      SearchResult search_result;
+      search_result = g_array_index (search_batch->search_results, SearchResult, i);
+      search_result.text = g_string_chunk_insert (search_cache->text_chunk, search_result.text);
+      search_result.terms = NULL;
+      g_array_append_val (cache_file->search_results, search_result);
+    }
+}
+
+/*
+ * Every line with the new text has the old text too, as long as the new
+ * text does not start or end with space that was stripped off the hits.
+ */
+static gboolean
+is_refinement (CodeSlayerProjectsSearch *search,
+               const gchar              *settings)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  SearchCache *search_cache;
+  const gchar *find_text;
+  gboolean result;
+  gchar *old_text;
+  gchar *new_text;
+  gsize length;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  search_cache = priv->search_cache;
+  find_text = priv->find_text;
+
+  if (search_cache == NULL || !search_cache->complete 
+      || g_strcmp0 (search_cache->settings, settings) != 0
+      || search_cache->match_case != priv->match_case)
+    return FALSE;
+
+  if (priv->find_regex != NULL || priv->multiple_terms
+      || !codeslayer_utils_has_text (find_text)
+      || !codeslayer_search_matcher_is_literal (find_text))
+    return FALSE;
+
+  length = strlen (find_text);
+  if (g_ascii_isspace (find_text[0]) || g_ascii_isspace (find_text[length - 1]))
+    return FALSE;
+
+  /* the same search again is a refresh */
+  if (g_strcmp0 (search_cache->find_text, find_text) == 0
+      && g_strcmp0 (search_cache->file_text, priv->file_text) == 0)
+    return FALSE;
+
+  if (codeslayer_utils_has_text (search_cache->file_text)
+      && g_strcmp0 (search_cache->file_text, priv->file_text) != 0)
+    return FALSE;
+
+  old_text = g_strdup (search_cache->find_text);
+  new_text = g_strdup (find_text);
+  if (!priv->match_case)
+    {
+      codeslayer_search_matcher_fold (old_text, strlen (old_text));
+      codeslayer_search_matcher_fold (new_text, length);
+    }
+
+  result = strstr (new_text, old_text) != NULL;
+
+  g_free (old_text);
+  g_free (new_text);
+
+  return result;
+}
+
+/*
+ * Checks the hits of the last search again and puts the ones that are 
+ * left in the tree. Returns FALSE when one of the files changed, which 
+ * calls for a real search.
+ */
+static gboolean
+refine_search (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  SearchCache *search_cache;
+  SearchCache *refined_cache;
+  CodeSlayerSearchMatcher *matcher;
+  GPatternSpec *file_pattern = NULL;
+  CodeSlayerProject *project = NULL;
+  GtkTreeIter project_iter;
+  GString *buffer;
+  guint i, j;
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  search_cache = priv->search_cache;
+
+  /* a file without a hit may have one now, the hits are a part of what was seen */
+  for (i = 0; i < search_cache->seen->seen_files->len; i++)
+    {
+      SearchSeenFile *seen_file;
+      seen_file = &g_array_index (search_cache->seen->seen_files, SearchSeenFile, i);
+      if (!is_unchanged (seen_file->file_path, seen_file->mtime, seen_file->size))
+        return FALSE;
+    }
+
+  if (codeslayer_utils_has_text (priv->file_text))
+    {
+      gchar *file_globbing;
+      file_globbing = get_globbing (priv->file_text, priv->match_case);
+      file_pattern = g_pattern_spec_new (file_globbing);
+      g_free (file_globbing);
+    }
+
+  matcher = codeslayer_search_matcher_new (priv->find_text, priv->match_case);
+  refined_cache = create_search_cache (search, search_cache->settings);
+  refined_cache->complete = TRUE;
+  buffer = g_string_new (NULL);
+
+  for (i = 0; i < search_cache->cache_files->len; i++)
+    {
+      SearchCacheFile *cache_file = g_ptr_array_index (search_cache->cache_files, i);
+      SearchCacheFile *refined_file = NULL;
+      GtkTreeIter file_iter;
+
+      if (file_pattern != NULL)
+        {
+          g_string_assign (buffer, cache_file->file_name);
+          if (!priv->match_case)
+            codeslayer_search_matcher_fold (buffer->str, buffer->len);
+          if (!g_pattern_match_string (file_pattern, buffer->str))
+            continue;
+        }
+
+      for (j = 0; j < cache_file->search_results->len; j++)
+        {
+          SearchResult search_result;
+          gchar *line = NULL;
+          gssize offset;
+          gsize length;
+
+          search_result = g_array_index (cache_file->search_results, SearchResult, j);
+
+          /* only a window of a long line was kept, the longer text may be anywhere on it */
+          if (search_result.truncated)
+            {
+              line = read_result_line (cache_file->file_path, search_result.line_offset, &length);
+              if (line == NULL)
+                continue;
+
+              offset = codeslayer_search_matcher_find (matcher, line, length);
+              if (offset < 0)
+                {
+                  g_free (line);
+                  continue;
+                }
+
+              search_result.match_offset = offset;
+              search_result.match_length = codeslayer_search_matcher_get_length (matcher, 
+                                                                                 line + offset, 
+                                                                                 length - offset);
+              insert_result_text (refined_cache->text_chunk, buffer, line, length, &search_result);
+              g_free (line);
+            }
+          else
+            {
+              length = strlen (search_result.text);
+              offset = codeslayer_search_matcher_find (matcher, search_result.text, length);
+              if (offset < 0)
+                continue;
+
+              /* the longer text is found in the stripped line, put the indent back */
+              search_result.match_offset = search_result.indent + offset;
+              search_result.match_length = codeslayer_search_matcher_get_length (matcher, 
+                                                                                 search_result.text + offset, 
+                                                                                 length - offset);
+              search_result.text = g_string_chunk_insert (refined_cache->text_chunk, 
+                                                          search_result.text);
+            }
+
+          if (refined_file == NULL)
+            {
+              if (project != cache_file->project)
+                {
+                  project = cache_file->project;
+                  add_project (search, project, &project_iter);
+                }
+
+              refined_file = g_malloc (sizeof (SearchCacheFile));
+              *refined_file = *cache_file;
+              refined_file->file_path = g_string_chunk_insert (refined_cache->text_chunk, 
+                                                               cache_file->file_path);
+              refined_file->file_name = refined_file->file_path 
+                                        + (cache_file->file_name - cache_file->file_path);
+              refined_file->search_results = g_array_new (FALSE, FALSE, sizeof (SearchResult));
+              g_ptr_array_add (refined_cache->cache_files, refined_file);
+
+              add_file_row (search, &project_iter, project, refined_file->file_path, 
+                            refined_file->file_name, TRUE, &file_iter);
+            }
+
+          g_array_append_val (refined_file->search_results, search_result);
+          add_result_row (search, &file_iter, &search_result);
+        }
+    }
+
+  g_string_free (buffer, TRUE);
+  codeslayer_search_matcher_free (matcher);
+  if (file_pattern != NULL)
+    g_pattern_spec_free (file_pattern);
+
+  /* nothing changed, so the same files are good for the next refine */
+  refined_cache->seen = search_cache->seen;
+  search_cache->seen = NULL;
+
+  free_search_cache (search_cache);
+  priv->search_cache = refined_cache;
+  codeslayer_search_model_sort (priv->model);
+
+  return TRUE;
+}
+
+static gboolean
+is_unchanged (const gchar *file_path,
+              gint64       mtime,
+              goffset      size)
+{
+  GFileInfo *file_info;
+  GFile *file;
+  gboolean result;
+
+  file = g_file_new_for_path (file_path);
+  file_info = g_file_query_info (file, 
+                                 "standard::size,time::modified,time::modified-usec",
+                                 G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  g_object_unref (file);
+
+  if (file_info == NULL)
+    return FALSE;
+
+  result = g_file_info_get_size (file_info) == size
+           && get_modification_time (file_info) == mtime;
+
+  g_object_unref (file_info);
+
+  return result;
 }
 
-static gboolean
-has_selection_scope (CodeSlayerProjectsSearch *search)
+static SearchSeen*
+new_search_seen (void)
 {
-  CodeSlayerProjectsSearchPrivate *priv;
-  gint active_pos;
-  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-  active_pos = gtk_combo_box_get_active (GTK_COMBO_BOX (priv->scope_combo_box));
-  return active_pos == SCOPE_SELECTION;
+  SearchSeen *seen;
+  seen = g_malloc (sizeof (SearchSeen));
+  g_mutex_init (&seen->mutex);
+  seen->seen_files = g_array_new (FALSE, FALSE, sizeof (SearchSeenFile));
+  seen->text_chunk = g_string_chunk_new (64 * 1024);
+  return seen;
 }
 
+/*
+ * Called by the workers once for each folder, with the folder itself 
+ * and the files of it that were going to be read.
+ */
 static void
-execute (CodeSlayerProjectsSearch *search)
+add_seen_files (SearchSeen  *seen,
+                const gchar *folder_path,
+                GFileInfo   *folder_info,
+                GArray      *candidates)
 {
-  CodeSlayerProjectsSearchPrivate *priv;
-  CodeSlayerRegistry *registry; 
-  
-  gchar *find_globbing = NULL;
-  GPatternSpec *find_pattern = NULL;  
-  
-  gchar *file_globbing = NULL;
-  GPatternSpec *file_pattern = NULL;
-  
-  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-  
-  registry = codeslayer_profile_get_registry (priv->profile);
+  SearchSeenFile seen_file;
+  guint i;
 
-  if (codeslayer_utils_has_text (priv->find_text))
-    {
-      find_globbing = get_globbing (priv->find_text, is_active (priv->match_case_button));
-      find_pattern = g_pattern_spec_new (find_globbing);
-    }
+  g_mutex_lock (&seen->mutex);
 
-  if (codeslayer_utils_has_text (priv->file_text))
-    {
-      file_globbing = get_globbing (priv->file_text, is_active (priv->match_case_button));
-      file_pattern = g_pattern_spec_new (file_globbing);
-    }
-  
-  if (find_pattern != NULL || file_pattern != NULL)
+  seen_file.file_path = g_string_chunk_insert (seen->text_chunk, folder_path);
+  seen_file.mtime = get_modification_time (folder_info);
+  seen_file.size = g_file_info_get_size (folder_info);
+  g_array_append_val (seen->seen_files, seen_file);
+
+  for (i = 0; i < candidates->len; i++)
     {
-      gchar *exclude_types_str;
-      gchar *exclude_dirs_str;
-      GList *exclude_types = NULL;
-      GList *exclude_dirs = NULL;
-      
-      exclude_types_str = codeslayer_registry_get_string (registry,
-                                                          CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_TYPES);
-      exclude_dirs_str = codeslayer_registry_get_string (registry,
-                                                         CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_DIRS);
-      exclude_types = codeslayer_utils_string_to_list (exclude_types_str);
-      exclude_dirs = codeslayer_utils_string_to_list (exclude_dirs_str);
-                                                           
-      search_projects (search, find_pattern, file_pattern, exclude_types, exclude_dirs);
-      
-      g_free (exclude_types_str);
-      g_free (exclude_dirs_str);
-      if (exclude_types)
-        {
-          g_list_foreach (exclude_types, (GFunc) g_free, NULL);
-          g_list_free (exclude_types);
-        }
-      if (exclude_dirs)
-        {
-          g_list_foreach (exclude_dirs, (GFunc) g_free, NULL);
-          g_list_free (exclude_dirs);
-        }
-      
-      if (has_selection_scope (search) && priv->file_paths)
-        {
-          SearchContext *context;
-        
-          gchar *label_name;
-          label_name = g_strdup_printf (_("Find \"%s\""),
-                                        find_pattern != NULL ? priv->find_text : priv->file_text);
-          context = g_malloc (sizeof (SearchContext));
-          context->search = search;
-          context->label_name = label_name;
-        }
+      SearchCandidate *candidate = &g_array_index (candidates, SearchCandidate, i);
+      seen_file.file_path = g_string_chunk_insert (seen->text_chunk, candidate->file_path);
+      seen_file.mtime = candidate->mtime;
+      seen_file.size = candidate->size;
+      g_array_append_val (seen->seen_files, seen_file);
     }
-    
-  if (find_globbing != NULL)
-    g_free (find_globbing);
-  if (find_pattern != NULL)
-    g_pattern_spec_free (find_pattern);
-  
-  if (file_globbing != NULL)
-    g_free (file_globbing);  
-  if (file_pattern != NULL)
-    g_pattern_spec_free (file_pattern);
 
-  g_idle_add ((GSourceFunc) set_stop_button_sensitive, priv->stop_button);
+  g_mutex_unlock (&seen->mutex);
 }
 
 static void
-search_projects (CodeSlayerProjectsSearch *search,
-                 GPatternSpec             *find_pattern,
-                 GPatternSpec             *file_pattern,
-                 GList                    *exclude_types,
-                 GList                    *exclude_dirs)
+free_search_seen (SearchSeen *seen)
 {
-  CodeSlayerProjectsSearchPrivate *priv;
-  GList *projects;
-  GList *list;
-  
-  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-  
-  projects = codeslayer_profile_get_projects (priv->profile);
-  list = projects;
-  
-  while (list != NULL)
-    {
-      CodeSlayerProject *project;
-      GList *search_files = NULL;
-      const gchar *folder_path;
-      gchar *folder_path_expanded;
-      
-      project = list->data;
-      folder_path = codeslayer_project_get_folder_path (project);
-      folder_path_expanded = g_strconcat (folder_path, G_DIR_SEPARATOR_S, NULL);
-      
-      if (has_selection_scope (search) && priv->file_paths)
-        {
-          gchar **split, **tmp;
-          split = g_strsplit (priv->file_paths, ";", -1);
-          tmp = split;
+  g_mutex_clear (&seen->mutex);
+  g_array_free (seen->seen_files, TRUE);
+  g_string_chunk_free (seen->text_chunk);
+  g_free (seen);
+}
 
-          while (*tmp != NULL)
-            {
-              gchar *tmp_expanded;
-              tmp_expanded = g_strconcat (*tmp, G_DIR_SEPARATOR_S, NULL);
-              
-              if (g_str_has_prefix (tmp_expanded, folder_path_expanded))
-                {
-                  GFile *file;
-                  file = g_file_new_for_path (*tmp);
-                  create_search_files (search, find_pattern, file_pattern, file, 
-                                       &search_files, exclude_types, exclude_dirs);
-                  g_object_unref (file);
-                }
-              g_free (tmp_expanded);
-              tmp++;
-            }
-          g_strfreev (split);
-        }
-      else
-        {
-          GFile *file;
-          file = g_file_new_for_path (folder_path);
-          create_search_files (search, find_pattern, file_pattern, file, 
-                               &search_files, exclude_types, exclude_dirs);
-          g_object_unref (file);
-        }
-        
-      if (search_files != NULL)
-        {
-          SearchContext *context;
-          context = g_malloc (sizeof (SearchContext));
-          context->search = search;
-          context->search_files = search_files;
-          context->project = project;
-          g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, (GSourceFunc) create_search_tree, context, (GDestroyNotify)destroy_search_tree);
-        }
+/*
+ * The whole line at the offset, however long it is. The file is known 
+ * to be unchanged, so the offset still points at the start of the line.
+ */
+static gchar*
+read_result_line (const gchar *file_path,
+                  goffset      line_offset,
+                  gsize       *length)
+{
+  GFile *file;
+  GFileInputStream *input_stream;
+  GDataInputStream *data_stream;
+  gchar *line = NULL;
 
-      g_free (folder_path_expanded);
-      list = g_list_next (list);
+  file = g_file_new_for_path (file_path);
+  input_stream = g_file_read (file, NULL, NULL);
+  g_object_unref (file);
+
+  if (input_stream == NULL)
+    return NULL;
+
+  if (g_seekable_seek (G_SEEKABLE (input_stream), line_offset, G_SEEK_SET, NULL, NULL))
+    {
+      data_stream = g_data_input_stream_new (G_INPUT_STREAM (input_stream));
+      line = g_data_input_stream_read_line (data_stream, length, NULL, NULL);
+      g_object_unref (data_stream);
     }
-    
-  g_list_free (projects);
+
+  g_object_unref (input_stream);
+
+  return line;
 }
 
-static void
-create_search_files (CodeSlayerProjectsSearch *search,
-                     GPatternSpec             *find_pattern,
-                     GPatternSpec             *file_pattern,
-                     GFile                    *file,
-                     GList                    **search_files, 
-                     GList                    *exclude_types,
-                     GList                    *exclude_dirs)
+static gint64
+get_modification_time (GFileInfo *file_info)
 {
-  GFileEnumerator *enumerator;
+  gint64 mtime;
+  mtime = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  return mtime * G_USEC_PER_SEC 
+         + g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
 
-  enumerator = g_file_enumerate_children (file, "standard::*",
-                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, 
-                                          NULL, NULL);
-  if (enumerator != NULL)
+/*
+ * The indexes are loaded on the first search of a project and kept 
+ * until the window goes away. Only the search thread touches them.
+ */
+static CodeSlayerSearchIndex*
+get_search_index (SearchScan        *scan,
+                  CodeSlayerProject *project)
+{
+  CodeSlayerSearchIndex *index;
+  const gchar *folder_path;
+
+  folder_path = codeslayer_project_get_folder_path (project);
+  index = g_hash_table_lookup (scan->search_indexes, folder_path);
+  if (index == NULL)
     {
-      GFileInfo *file_info;
-      while ((file_info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
-        {
-          GFile *child;
+      gchar *profile_folder_path;
+      gchar *checksum;
+      gchar *index_file;
+      gchar *index_path;
+
+      /* the folder path does not work as a file name */
+      checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, folder_path, -1);
+      index_file = g_strconcat (CODESLAYER_PROJECTS_SEARCH_INDEX_FILE, "-", checksum, NULL);
+      profile_folder_path = codeslayer_profile_get_config_folder_path (scan->profile);
+      index_path = g_build_filename (profile_folder_path, index_file, NULL);
+
+      index = codeslayer_search_index_load (index_path);
+      g_hash_table_insert (scan->search_indexes, g_strdup (folder_path), index);
+
+      g_free (checksum);
+      g_free (index_file);
+      g_free (profile_folder_path);
+      g_free (index_path);
+    }
 
-          const char *file_name = g_file_info_get_name (file_info);
-          child = g_file_get_child (file, file_name);
-          
-          if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY 
-                && !codeslayer_utils_contains_element (exclude_dirs, file_name))
-            {
-              create_search_files (search, find_pattern, file_pattern, 
-                                   child, search_files, exclude_types, exclude_dirs);
-            }
+  return index;
+}
 
-          if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_REGULAR
-                && !codeslayer_utils_contains_element_with_suffix (exclude_types, file_name))
-            {
-              create_search_results (search, find_pattern, file_pattern, 
-                                     child, search_files);
-            }
- 
-          g_object_unref (child);
-          g_object_unref (file_info);
-        }
-      g_object_unref (enumerator);
+static void
+save_search_indexes (GHashTable *search_indexes)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_hash_table_iter_init (&iter, search_indexes);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      if (!codeslayer_search_index_save (value))
+        g_warning ("Error writing the search index file.");
     }
 }
 
+/*
+ * Tells how many files the policy kept out of the search and why.
+ */
 static void
-create_search_results (CodeSlayerProjectsSearch *search,
-                       GPatternSpec             *find_pattern,
-                       GPatternSpec             *file_pattern,
-                       GFile                    *file,
-                       GList                    **search_files)
+show_skipped (CodeSlayerProjectsSearch *search,
+              CodeSlayerSearchPolicy   *policy)
 {
   CodeSlayerProjectsSearchPrivate *priv;
-  gchar *file_path;
-  gchar *base_name;
-  gchar *file_name;
+  GString *text;
+  gint binary;
+  gint size;
+  gint type;
 
   priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-  
-  base_name = g_file_get_basename (file);
-  file_name = g_strdup (base_name);
-  get_text (&file_name, is_active (priv->match_case_button));
-  if (file_pattern != NULL && !g_pattern_match_string (file_pattern, file_name))
-    {
-      g_free (file_name);
-      g_free (base_name);
-      return;
-    }
-    
-  file_path = g_file_get_path (file);    
 
-  if (find_pattern == NULL)
-    {
-      SearchFile *search_file = NULL;
-      search_file = g_malloc (sizeof (SearchFile));
-      search_file->file_name = g_strdup (base_name);
-      search_file->file_path = g_strdup (file_path);
-      search_file->search_results = NULL;
-      *search_files = g_list_append (*search_files, search_file);
-    }
-  else
-    {
-      SearchFile *search_file = NULL;
-      GIOChannel *channel;
-      gint line_number;
-      gchar *text;
+  binary = codeslayer_search_policy_get_skipped (policy, CODESLAYER_SEARCH_POLICY_SKIP_BINARY);
+  size = codeslayer_search_policy_get_skipped (policy, CODESLAYER_SEARCH_POLICY_SKIP_SIZE);
+  type = codeslayer_search_policy_get_skipped (policy, CODESLAYER_SEARCH_POLICY_SKIP_TYPE);
 
-      channel = g_io_channel_new_file (file_path, "r", NULL);
+  if (binary + size + type == 0)
+    return;
 
-      for (line_number = 1; g_io_channel_read_line (channel, &text, NULL, NULL, NULL) == G_IO_STATUS_NORMAL; line_number++)
-        {
-          if (text == NULL)
-            continue;
-            
-          get_text (&text, is_active (priv->match_case_button));
-          
-          if (g_pattern_match_string (find_pattern, text))
-            {
-              SearchResult *search_result;
-              search_result = g_malloc (sizeof (SearchResult));
-              search_result->file_path = g_strdup (file_path);
-              search_result->line_number = line_number;
-              search_result->text = g_strstrip (g_strdup (text));
+  text = g_string_new (_("Skipped:"));
+  if (binary > 0)
+    g_string_append_printf (text, _(" %d binary"), binary);
+  if (size > 0)
+    g_string_append_printf (text, _(" %d too large"), size);
+  if (type > 0)
+    g_string_append_printf (text, _(" %d by type"), type);
 
-              if (search_file == NULL)
-                {
-                  search_file = g_malloc (sizeof (SearchFile));
-                  search_file->file_name = g_strdup (base_name);
-                  search_file->file_path = g_strdup (file_path);
-                  search_file->search_results = NULL;
-                  *search_files = g_list_append (*search_files, search_file);
-                }
-            
-              search_file->search_results = g_list_append (search_file->search_results, search_result);
-            }
-          
-          g_free (text);
-        }    
-    
-      g_io_channel_shutdown(channel, FALSE, NULL);
-      g_io_channel_unref (channel);
-    }
-  
-  g_free (file_path);
-  g_free (file_name);
-  g_free (base_name);
+  gtk_label_set_text (GTK_LABEL (priv->status_label), text->str);
+  g_string_free (text, TRUE);
 }
 
-static gboolean
-create_search_tree (SearchContext *context)
+/*
+ * Fills the statistics footer. The phase times of the workers are added 
+ * up, so they can be longer than the search took.
+ */
+static void
+show_stats (CodeSlayerProjectsSearch *search,
+            CodeSlayerSearchStats    *stats)
 {
   CodeSlayerProjectsSearchPrivate *priv;
-  const gchar *project_folder_path;
-  GtkTreeIter project_iter;
+  GString *text;
+  gchar *counters[CODESLAYER_SEARCH_STATS_COUNTER_LAST];
+  gchar *bytes;
+  gint i;
+
+  const gchar *phases[CODESLAYER_SEARCH_STATS_PHASE_LAST] = 
+  {
+    N_("Walk"),
+    N_("Read"),
+    N_("Match"),
+    N_("Display")
+  };
+
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+
+  text = g_string_new (NULL);
+
+  /* the counters are printed first, a msgid can not hold G_GUINT64_FORMAT */
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_COUNTER_LAST; i++)
+    counters[i] = g_strdup_printf ("%" G_GUINT64_FORMAT, 
+                                   codeslayer_search_stats_get_counter (stats, i));
+
+  g_string_append_printf (text, _("Directories: %s walked, %s excluded\n"),
+                          counters[CODESLAYER_SEARCH_STATS_DIRECTORIES],
+                          counters[CODESLAYER_SEARCH_STATS_DIRECTORIES_EXCLUDED]);
+  g_string_append_printf (text, _("Files: %s opened, %s excluded\n"),
+                          counters[CODESLAYER_SEARCH_STATS_FILES_OPENED],
+                          counters[CODESLAYER_SEARCH_STATS_FILES_EXCLUDED]);
+
+  bytes = g_format_size (codeslayer_search_stats_get_counter (stats, CODESLAYER_SEARCH_STATS_BYTES_READ));
+  g_string_append_printf (text, _("Scanned: %s, %s lines, %s matches\n"),
+                          bytes, 
+                          counters[CODESLAYER_SEARCH_STATS_LINES_SCANNED],
+                          counters[CODESLAYER_SEARCH_STATS_MATCHES]);
+  g_free (bytes);
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_COUNTER_LAST; i++)
+    g_free (counters[i]);
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_PHASE_LAST; i++)
+    g_string_append_printf (text, _("%s%s: %.2fs (CPU %.2fs)"), i > 0 ? ", " : "", _(phases[i]),
+                            codeslayer_search_stats_get_wall_time (stats, i) / (gdouble) G_USEC_PER_SEC,
+                            codeslayer_search_stats_get_cpu_time (stats, i) / (gdouble) G_USEC_PER_SEC);
+
+  g_string_append_printf (text, _("\nTotal: %.2fs (CPU %.2fs)"),
+                          codeslayer_search_stats_get_total_wall_time (stats) / (gdouble) G_USEC_PER_SEC,
+                          codeslayer_search_stats_get_total_cpu_time (stats) / (gdouble) G_USEC_PER_SEC);
+
+  gtk_label_set_text (GTK_LABEL (priv->stats_label), text->str);
+  g_string_free (text, TRUE);
+}
+
+/*
+ * Adds the stats as one line to the log in the profile folder, when the
+ * log is turned on.
+ */
+static void
+write_stats (CodeSlayerProjectsSearch *search,
+             CodeSlayerSearchStats    *stats)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  CodeSlayerRegistry *registry;
+  GFileOutputStream *stream;
+  gchar *profile_folder_path;
+  gchar *stats_path;
+  GFile *file;
+  gchar *json;
+  gchar *line;
 
-  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (context->search);
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
 
-  project_folder_path = codeslayer_project_get_folder_path (context->project);
+  registry = codeslayer_profile_get_registry (priv->profile);
+  if (!codeslayer_registry_get_boolean (registry, CODESLAYER_REGISTRY_PROJECTS_SEARCH_STATS_LOG))
+    return;
+
+  profile_folder_path = codeslayer_profile_get_config_folder_path (priv->profile);
+  stats_path = g_build_filename (profile_folder_path, CODESLAYER_PROJECTS_SEARCH_STATS_FILE, NULL);
+  file = g_file_new_for_path (stats_path);
+
+  json = codeslayer_search_stats_to_json (stats);
+  line = g_strconcat (json, "\n", NULL);
+
+  stream = g_file_append_to (file, G_FILE_CREATE_NONE, NULL, NULL);
+  if (stream == NULL 
+      || !g_output_stream_write_all (G_OUTPUT_STREAM (stream), line, strlen (line), NULL, NULL, NULL)
+      || !g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, NULL))
+    g_warning ("Error writing the search stats file.");
+
+  if (stream != NULL)
+    g_object_unref (stream);
+  g_object_unref (file);
+  g_free (line);
+  g_free (json);
+  g_free (stats_path);
+  g_free (profile_folder_path);
+}
 
-  add_project (context->search, context->project, &project_iter);
+/*
+ * The counts of the worker that is running.
+ */
+static CodeSlayerSearchStatsCounts*
+get_search_counts (void)
+{
+  CodeSlayerSearchStatsCounts *counts;
 
-  while (priv->stop_request == FALSE && context->search_files != NULL)
+  counts = g_private_get (&search_counts);
+  if (counts == NULL)
     {
-      SearchFile *search_file = context->search_files->data;
-      gchar *search_file_name;
-      gchar *search_file_path;
-      GtkTreeIter file_iter;
-      GtkTreeIter text_iter;
-      GList *tmp;
-
-      search_file_path = codeslayer_utils_substr (search_file->file_path,
-                                          strlen (project_folder_path) + 1,
-                                          strlen (search_file->file_path));
-                                          
-      search_file_name = g_strconcat (search_file->file_name, 
-                                      " - ", 
-                                      search_file_path, NULL);
-      
-      gtk_tree_store_append (priv->treestore, &file_iter, &project_iter);
-      
-      tmp = search_file->search_results;
-      if (tmp != NULL)
-        {
-          gtk_tree_store_set (priv->treestore, &file_iter, 
-                              FILE_PATH, NULL, 
-                              LINE_NUMBER, 0, 
-                              TEXT, search_file_name,
-                              PROJECT, context->project, -1);
-        }
-      else
-        {
-          gtk_tree_store_set (priv->treestore, &file_iter, 
-                              FILE_PATH, search_file->file_path, 
-                              LINE_NUMBER, 0, 
-                              TEXT, search_file_name,
-                              PROJECT, context->project, -1);
-        }      
-      
-      while (tmp != NULL)
-        {
-          SearchResult *search_result = tmp->data;
-          gchar *line_text;
-          gchar *full_text;
-          
-          line_text = g_malloc (sizeof (gchar) * 10);
-          g_sprintf (line_text, "%d", search_result->line_number);
-          full_text = g_strconcat ("(", line_text, ") ", search_result->text, NULL);
-                                       
-          gtk_tree_store_append (priv->treestore, &text_iter, &file_iter);
-          gtk_tree_store_set (priv->treestore, &text_iter,
-                              FILE_PATH, search_result->file_path,
-                              LINE_NUMBER, search_result->line_number,
-                              TEXT, full_text,
-                              PROJECT, context->project, -1);
-
-          g_free (line_text);
-          g_free (full_text);
-          g_free (search_result->file_path);
-          g_free (search_result->text);
-          g_free (search_result);
-          tmp = g_list_next (tmp);
-        }
-      
-      g_free (search_file_path);
-      g_free (search_file_name);
-      g_free (search_file->file_path);
-      g_free (search_file->file_name);
-      g_list_free (search_file->search_results);
-      g_free (search_file);
-      context->search_files = g_list_next (context->search_files);
+      counts = g_malloc0 (sizeof (CodeSlayerSearchStatsCounts));
+      g_private_set (&search_counts, counts);
     }
-  
-  return FALSE;    
+
+  return counts;
+}
+
+static void
+close_search_queue (GCancellable          *cancellable,
+                    CodeSlayerSearchQueue *queue)
+{
+  codeslayer_search_queue_close (queue);
 }
 
 static void 
@@ -1020,17 +4154,8 @@ add_project (CodeSlayerProjectsSearch *search,
              GtkTreeIter              *project_iter)
 {
   CodeSlayerProjectsSearchPrivate *priv;
-  const gchar *project_name;
-
   priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
-
-  gtk_tree_store_append (priv->treestore, project_iter, NULL);
-  project_name = codeslayer_project_get_name (project);
-  gtk_tree_store_set (priv->treestore, project_iter, 
-                      FILE_PATH, NULL,
-                      LINE_NUMBER, 0, 
-                      TEXT, project_name, 
-                      PROJECT, project, -1);
+  codeslayer_search_model_append_project (priv->model, project, project_iter);
 }
 
 static gboolean
@@ -1050,13 +4175,17 @@ select_document (CodeSlayerProjectsSearch *search,
     {
       gchar *file_path = NULL;
       gint line_number;
+      gint match_offset;
+      gint match_length;
       CodeSlayerProject *project;
       CodeSlayerDocument *document;
 
-      gtk_tree_model_get (GTK_TREE_MODEL (priv->treestore), &iter,
-                          FILE_PATH, &file_path,
-                          LINE_NUMBER, &line_number, 
-                          PROJECT, &project, -1);
+      gtk_tree_model_get (model, &iter,
+                          CODESLAYER_SEARCH_MODEL_FILE_PATH, &file_path,
+                          CODESLAYER_SEARCH_MODEL_LINE_NUMBER, &line_number, 
+                          CODESLAYER_SEARCH_MODEL_MATCH_OFFSET, &match_offset, 
+                          CODESLAYER_SEARCH_MODEL_MATCH_LENGTH, &match_length, 
+                          CODESLAYER_SEARCH_MODEL_PROJECT, &project, -1);
 
       if (file_path == NULL)
         {
@@ -1072,6 +4201,7 @@ select_document (CodeSlayerProjectsSearch *search,
       document = codeslayer_document_new ();
       codeslayer_document_set_file_path (document, file_path);
       codeslayer_document_set_line_number (document, line_number);
+      codeslayer_document_set_match_range (document, match_offset, match_length);
       codeslayer_document_set_project (document, project);
       
       g_signal_emit_by_name ((gpointer) search, "select-document", document);
@@ -1083,6 +4213,90 @@ select_document (CodeSlayerProjectsSearch *search,
   return FALSE;
 }
 
+/*
+ * Only the lines around the hit are read, and only when the row is 
+ * selected. A file without hits shows its first lines.
+ */
+static void
+preview_action (CodeSlayerProjectsSearch *search)
+{
+  CodeSlayerProjectsSearchPrivate *priv;
+  CodeSlayerRegistry *registry;
+  GtkTreeSelection *treeselection;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end;
+  gchar *file_path = NULL;
+  gchar *text = NULL;
+  gint line_number = 0;
+  gint match_offset = 0;
+  gint match_length = 0;
+  gint64 line_offset = 0;
+  gsize hit_offset;
+  gint context_lines;
+  
+  priv = CODESLAYER_PROJECTS_SEARCH_GET_PRIVATE (search);
+  
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->preview_view));
+
+  treeselection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->treeview));
+  if (gtk_tree_selection_get_selected (treeselection, &model, &iter))
+    gtk_tree_model_get (model, &iter,
+                        CODESLAYER_SEARCH_MODEL_FILE_PATH, &file_path,
+                        CODESLAYER_SEARCH_MODEL_LINE_NUMBER, &line_number, 
+                        CODESLAYER_SEARCH_MODEL_LINE_OFFSET, &line_offset, 
+                        CODESLAYER_SEARCH_MODEL_MATCH_OFFSET, &match_offset, 
+                        CODESLAYER_SEARCH_MODEL_MATCH_LENGTH, &match_length, -1);
+
+  if (file_path != NULL)
+    {
+      registry = codeslayer_profile_get_registry (priv->profile);
+      context_lines = codeslayer_registry_get_integer (registry, 
+                                                       CODESLAYER_REGISTRY_PROJECTS_SEARCH_PREVIEW_LINES);
+      text = codeslayer_search_preview_get (priv->preview, file_path, line_offset, 
+                                            MAX (context_lines, 0), &hit_offset);
+      g_free (file_path);
+    }
+
+  if (text == NULL)
+    {
+      gtk_text_buffer_set_text (buffer, "", -1);
+      return;
+    }
+
+  gtk_text_buffer_set_text (buffer, text, -1);
+
+  if (line_number > 0)
+    {
+      const gchar *line = text + hit_offset;
+      const gchar *line_end;
+      gsize length;
+      
+      line_end = strchr (line, '\n');
+      length = line_end != NULL ? (gsize) (line_end - line) : strlen (line);
+
+      gtk_text_buffer_get_iter_at_offset (buffer, &start, g_utf8_pointer_to_offset (text, line));
+      gtk_text_buffer_get_iter_at_offset (buffer, &end, g_utf8_pointer_to_offset (text, line + length));
+      gtk_text_buffer_apply_tag_by_name (buffer, "hit-line", &start, &end);
+
+      /* the file may have changed since it was searched */
+      if (match_length > 0 && (gsize) (match_offset + match_length) <= length)
+        {
+          gtk_text_buffer_get_iter_at_offset (buffer, &start, 
+                                              g_utf8_pointer_to_offset (text, line + match_offset));
+          gtk_text_buffer_get_iter_at_offset (buffer, &end, 
+                                              g_utf8_pointer_to_offset (text, line + match_offset + match_length));
+          gtk_text_buffer_apply_tag_by_name (buffer, "hit-match", &start, &end);
+        }
+
+      gtk_text_buffer_get_iter_at_offset (buffer, &start, g_utf8_pointer_to_offset (text, line));
+      gtk_text_view_scroll_to_iter (GTK_TEXT_VIEW (priv->preview_view), &start, 0, TRUE, 0, .5);
+    }
+  
+  g_free (text);
+}
+
 static gchar*
 get_globbing (const gchar *entry, 
               gboolean     match_case)
@@ -1105,82 +4319,8 @@ get_globbing (const gchar *entry,
   return result;
 }
 
-static void
-get_text (gchar    **text, 
-          gboolean  match_case)
-{
-  gchar *result;
-
-  if (match_case)
-    {
-      result = *text;
-    }
-  else
-    {
-      result = codeslayer_utils_to_lowercase (*text);
-      g_free (*text);
-    }
-    
-  *text = result;
-}
-
 static gboolean
 is_active (GtkWidget *toggle_button)
 {
   return gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (toggle_button));
 }
-
-static gint
-sort_iter_compare_func (GtkTreeModel *model, 
-                        GtkTreeIter  *a,
-                        GtkTreeIter  *b, 
-                        gpointer      userdata)
-{
-  gint ret = 0;
-
-  gint sortcol;
-  sortcol = GPOINTER_TO_INT (userdata);
-
-  switch (sortcol)
-    {
-    case TEXT:
-      {
-        gchar *text1, *text2;
-        gint line_number1, line_number2;
-
-        gtk_tree_model_get (model, a, 
-                            LINE_NUMBER, &line_number1, 
-                            TEXT, &text1, -1);
-        gtk_tree_model_get (model, b, 
-                            LINE_NUMBER, &line_number2, 
-                            TEXT, &text2, -1);
-
-        if (line_number1 < line_number2)
-          ret = -1;
-        else if (line_number1 > line_number2)
-          ret = 1;
-        else
-          ret = g_strcmp0 (text1, text2);
-
-        g_free (text1);
-        g_free (text2);
-      }
-      break;
-    }
-
-  return ret;
-}
-
-static gboolean 
-set_stop_button_sensitive (GtkWidget *stop_button)
-{
-  gtk_widget_set_sensitive (stop_button, FALSE);
-  return FALSE;
-}
-
-static void 
-destroy_search_tree (SearchContext *context)
-{
-  g_list_free (context->search_files);
-  g_free (context);
-}
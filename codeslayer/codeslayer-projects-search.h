@@ -22,6 +22,7 @@
 #include <gtk/gtk.h>
 #include <codeslayer/codeslayer-profiles.h>
 #include <codeslayer/codeslayer-profile.h>
+#include <codeslayer/codeslayer-search-stats.h>
 
 G_BEGIN_DECLS
 
@@ -31,6 +32,9 @@ G_BEGIN_DECLS
 #define IS_CODESLAYER_PROJECTS_SEARCH(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CODESLAYER_PROJECTS_SEARCH_TYPE))
 #define IS_CODESLAYER_PROJECTS_SEARCH_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CODESLAYER_PROJECTS_SEARCH_TYPE))
 
+#define CODESLAYER_PROJECTS_SEARCH_INDEX_FILE "searchindex"
+#define CODESLAYER_PROJECTS_SEARCH_STATS_FILE "searchstats.jsonl"
+
 typedef struct _CodeSlayerProjectsSearch CodeSlayerProjectsSearch;
 typedef struct _CodeSlayerProjectsSearchClass CodeSlayerProjectsSearchClass;
 
@@ -45,15 +49,24 @@ struct _CodeSlayerProjectsSearchClass
 
   void (*select_document) (CodeSlayerProjectsSearch *search);
   void (*close) (CodeSlayerProjectsSearch *search);
+  void (*files_replaced) (CodeSlayerProjectsSearch *search);
+  void (*search_finished) (CodeSlayerProjectsSearch *search,
+                           CodeSlayerSearchStats    *stats);
 };
 
 GType codeslayer_projects_search_get_type (void) G_GNUC_CONST;
      
 GtkWidget*  codeslayer_projects_search_new             (GtkWindow                 *window, 
-                                                        CodeSlayerProfile         *profile);
+                                                        CodeSlayerProfile         *profile,
+                                                        GtkWidget                 *notebook);
 void        codeslayer_projects_search_find_projects   (CodeSlayerProjectsSearch  *search);
 void        codeslayer_projects_search_find_selection  (CodeSlayerProjectsSearch  *search, 
                                                         const gchar               *file_paths);
+void        codeslayer_projects_search_clear_cache     (CodeSlayerProjectsSearch  *search);
+gint        codeslayer_projects_search_grep            (CodeSlayerProfile         *profile,
+                                                        const gchar               *find_text,
+                                                        gboolean                   regex,
+                                                        gboolean                   match_case);
 
 G_END_DECLS
 
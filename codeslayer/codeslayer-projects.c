@@ -21,6 +21,8 @@
 #include <codeslayer/codeslayer-projects.h>
 #include <codeslayer/codeslayer-project-properties.h>
 #include <codeslayer/codeslayer-utils.h>
+#include <codeslayer/codeslayer-search-exclude.h>
+#include <codeslayer/codeslayer-search-ignore.h>
 #include <codeslayer/codeslayer-menuitem.h>
 #include <codeslayer/codeslayer-marshaller.h>
 
@@ -52,7 +54,7 @@ static void append_treestore_children         (CodeSlayerProjects      *projects
                                                CodeSlayerProject       *project, 
                                                GtkTreeIter              iter, 
                                                const gchar             *folder_path);
-static gboolean is_file_shown                 (CodeSlayerRegistry      *registry, 
+static gboolean is_file_shown                 (CodeSlayerSearchExclude *exclude, 
                                                const char              *file_name, 
                                                GFileType                file_type);
 static gboolean row_activated_action          (CodeSlayerProjects      *projects, 
@@ -175,6 +177,7 @@ enum
   RENAME_FILE_FOLDER,
   DELETE_FILE_FOLDER,
   SEARCH_FIND,
+  SEARCH_FINISHED,
   FIND_PROJECTS,
   CUT_FILE_FOLDER,
   COPY_FILE_FOLDER,
@@ -340,6 +343,14 @@ codeslayer_projects_class_init (CodeSlayerProjectsClass *klass)
                   NULL, NULL,
                   g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 
+  codeslayer_projects_signals[SEARCH_FINISHED] =
+    g_signal_new ("search-finished", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CodeSlayerProjectsClass, search_finished), 
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__BOXED, G_TYPE_NONE, 1, CODESLAYER_SEARCH_STATS_TYPE);
+
   /* private signals */
 
   codeslayer_projects_signals[RENAME_FILE_FOLDER] =
@@ -2047,12 +2058,20 @@ append_treestore_children (CodeSlayerProjects *projects,
   char *file_path;
   GFileEnumerator *enumerator;
   CodeSlayerRegistry *registry; 
+  CodeSlayerSearchExclude *exclude;
+  CodeSlayerSearchIgnore *ignore = NULL;
   
   priv = CODESLAYER_PROJECTS_GET_PRIVATE (projects);
 
   file = g_file_new_for_path (parentdir);
   file_path = g_file_get_path (file);
   registry = codeslayer_profile_get_registry (priv->profile);
+  exclude = codeslayer_registry_get_exclude (registry);
+
+  /* the rows are listed a directory at a time, so the rules are read from the project down */
+  if (!codeslayer_registry_get_boolean (registry, CODESLAYER_REGISTRY_PROJECTS_SHOW_IGNORED))
+    ignore = codeslayer_search_ignore_new_for_folder (codeslayer_project_get_folder_path (project), 
+                                                      file_path);
 
   enumerator = g_file_enumerate_children (file, "standard::*",
                                           G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, 
@@ -2069,7 +2088,9 @@ append_treestore_children (CodeSlayerProjects *projects,
           file_name = g_file_info_get_name (file_info);
           file_type = g_file_info_get_file_type (file_info);
 
-          if (!is_file_shown (registry, file_name, file_type))
+          if (!is_file_shown (exclude, file_name, file_type)
+              || codeslayer_search_ignore_is_ignored (ignore, file_path, file_name, 
+                                                      file_type == G_FILE_TYPE_DIRECTORY))
             {
               g_object_unref (file_info);
               continue;
@@ -2097,58 +2118,26 @@ append_treestore_children (CodeSlayerProjects *projects,
       g_object_unref (enumerator);
     }
 
+  codeslayer_search_exclude_unref (exclude);
+  codeslayer_search_ignore_unref (ignore);
   g_object_unref (file);
   g_free (file_path);
 }
 
 static gboolean
-is_file_shown (CodeSlayerRegistry *registry, 
-               const char         *file_name, 
-               GFileType          file_type)
+is_file_shown (CodeSlayerSearchExclude *exclude, 
+               const char              *file_name, 
+               GFileType                file_type)
 {
-  gchar *exclude_types_str;
-  GList *exclude_types = NULL;
-  gchar *exclude_dirs_str;
-  GList *exclude_dirs = NULL;
-  gboolean result = TRUE;
-
-  exclude_types_str = codeslayer_registry_get_string (registry,
-                                                      CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_TYPES);
-
-  exclude_types = codeslayer_utils_string_to_list (exclude_types_str);
-  
   if (file_type == G_FILE_TYPE_REGULAR
-      && codeslayer_utils_contains_element_with_suffix (exclude_types, file_name))
-    {
-      result = FALSE;
-    }
-  
-  exclude_dirs_str = codeslayer_registry_get_string (registry,
-                                                     CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_DIRS);
-
-  exclude_dirs = codeslayer_utils_string_to_list (exclude_dirs_str);
+      && codeslayer_search_exclude_is_excluded_file (exclude, file_name))
+    return FALSE;
   
   if (file_type == G_FILE_TYPE_DIRECTORY
-      && codeslayer_utils_contains_element (exclude_dirs, file_name))
-    {
-      result = FALSE;
-    }
-  
-  g_free (exclude_types_str);
-  if (exclude_types)
-    {
-      g_list_foreach (exclude_types, (GFunc) g_free, NULL);
-      g_list_free (exclude_types);
-    }
-
-  g_free (exclude_dirs_str);
-  if (exclude_dirs)
-    {
-      g_list_foreach (exclude_dirs, (GFunc) g_free, NULL);
-      g_list_free (exclude_dirs);
-    }
+      && codeslayer_search_exclude_is_excluded_dir (exclude, file_name))
+    return FALSE;
   
-  return result;
+  return TRUE;
 }
 
 static gboolean
@@ -25,6 +25,7 @@
 #include <codeslayer/codeslayer-registry.h>
 #include <codeslayer/codeslayer-project.h>
 #include <codeslayer/codeslayer-document.h>
+#include <codeslayer/codeslayer-search-stats.h>
 
 G_BEGIN_DECLS
 
@@ -63,6 +64,9 @@ struct _CodeSlayerProjectsClass
 
   /* private signals */
   void (*rename_file_folder) (CodeSlayerProjects *projects);
+
+  void (*search_finished) (CodeSlayerProjects    *projects,
+                           CodeSlayerSearchStats *stats);
 };
 
 GType codeslayer_projects_get_type (void) G_GNUC_CONST;
@@ -35,6 +35,7 @@ static void codeslayer_registry_class_init  (CodeSlayerRegistryClass *klass);
 static void codeslayer_registry_init        (CodeSlayerRegistry      *registry);
 static void codeslayer_registry_finalize    (CodeSlayerRegistry      *registry);
 static void remove_all_registry             (CodeSlayerRegistry      *registry);
+static void drop_exclude                    (CodeSlayerRegistry      *registry);
 
 #define CODESLAYER_REGISTRY_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), CODESLAYER_REGISTRY_TYPE, CodeSlayerRegistryPrivate))
@@ -43,7 +44,9 @@ typedef struct _CodeSlayerRegistryPrivate CodeSlayerRegistryPrivate;
 
 struct _CodeSlayerRegistryPrivate
 {
-  GHashTable *hashtable;
+  GHashTable              *hashtable;
+  CodeSlayerSearchExclude *exclude;
+  GMutex                   mutex;
 };
 
 enum
@@ -98,11 +101,17 @@ codeslayer_registry_init (CodeSlayerRegistry *registry)
   CodeSlayerRegistryPrivate *priv;
   priv = CODESLAYER_REGISTRY_GET_PRIVATE (registry);
   priv->hashtable = NULL;
+  priv->exclude = NULL;
+  g_mutex_init (&priv->mutex);
 }
 
 static void
 codeslayer_registry_finalize (CodeSlayerRegistry *registry)
 {
+  CodeSlayerRegistryPrivate *priv;
+  priv = CODESLAYER_REGISTRY_GET_PRIVATE (registry);
+  drop_exclude (registry);
+  g_mutex_clear (&priv->mutex);
   remove_all_registry (registry);
   G_OBJECT_CLASS (codeslayer_registry_parent_class)->finalize (G_OBJECT (registry));
 }
@@ -126,6 +135,10 @@ codeslayer_registry_new ()
   priv->hashtable = g_hash_table_new_full ((GHashFunc)g_str_hash, (GEqualFunc)g_str_equal, 
                                           (GDestroyNotify)g_free, (GDestroyNotify)g_free);
 
+  /* connected before anyone else, so every observer sees the new settings */
+  g_signal_connect (G_OBJECT (registry), "registry-changed",
+                    G_CALLBACK (drop_exclude), NULL);
+
   return registry;
 }
 
@@ -313,6 +326,54 @@ codeslayer_registry_set_string (CodeSlayerRegistry *registry,
   codeslayer_registry_set_setting (registry, key, value);
 }
 
+/**
+ * codeslayer_registry_get_exclude:
+ * @registry: a #CodeSlayerRegistry.
+ *
+ * The excluded file types and directories are compiled the first time 
+ * they are asked for, and then kept until the registry changes.
+ *
+ * Returns: the excluded file types and directories. Free with 
+ * codeslayer_search_exclude_unref().
+ */
+CodeSlayerSearchExclude*
+codeslayer_registry_get_exclude (CodeSlayerRegistry *registry)
+{
+  CodeSlayerRegistryPrivate *priv;
+  CodeSlayerSearchExclude *exclude;
+
+  priv = CODESLAYER_REGISTRY_GET_PRIVATE (registry);
+
+  /* the searches ask from their own threads */
+  g_mutex_lock (&priv->mutex);
+
+  if (priv->exclude == NULL)
+    priv->exclude = codeslayer_search_exclude_new (g_hash_table_lookup (priv->hashtable, 
+                                                                        CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_TYPES),
+                                                   g_hash_table_lookup (priv->hashtable, 
+                                                                        CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_DIRS));
+  exclude = codeslayer_search_exclude_ref (priv->exclude);
+
+  g_mutex_unlock (&priv->mutex);
+
+  return exclude;
+}
+
+static void
+drop_exclude (CodeSlayerRegistry *registry)
+{
+  CodeSlayerRegistryPrivate *priv;
+  priv = CODESLAYER_REGISTRY_GET_PRIVATE (registry);
+
+  g_mutex_lock (&priv->mutex);
+  if (priv->exclude != NULL)
+    {
+      codeslayer_search_exclude_unref (priv->exclude);
+      priv->exclude = NULL;
+    }
+  g_mutex_unlock (&priv->mutex);
+}
+
 static void
 remove_all_registry (CodeSlayerRegistry *registry)
 {
@@ -20,6 +20,7 @@
 #define __CODESLAYER_REGISTRY_H__
 
 #include <gtk/gtk.h>
+#include <codeslayer/codeslayer-search-exclude.h>
 
 G_BEGIN_DECLS
 
@@ -67,6 +68,13 @@ G_BEGIN_DECLS
 #define CODESLAYER_REGISTRY_BOTTOM_PANE_TAB_POSITION "bottom_pane_tab_position"
 #define CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_TYPES "projects_exclude_types"
 #define CODESLAYER_REGISTRY_PROJECTS_EXCLUDE_DIRS "projects_exclude_dirs"
+#define CODESLAYER_REGISTRY_PROJECTS_SHOW_IGNORED "projects_show_ignored"
+#define CODESLAYER_REGISTRY_PROJECTS_SEARCH_THREADS "projects_search_threads"
+#define CODESLAYER_REGISTRY_PROJECTS_SEARCH_MAX_FILE_SIZE "projects_search_max_file_size"
+#define CODESLAYER_REGISTRY_PROJECTS_SEARCH_INDEX "projects_search_index"
+#define CODESLAYER_REGISTRY_PROJECTS_SEARCH_IO_URING "projects_search_io_uring"
+#define CODESLAYER_REGISTRY_PROJECTS_SEARCH_STATS_LOG "projects_search_stats_log"
+#define CODESLAYER_REGISTRY_PROJECTS_SEARCH_PREVIEW_LINES "projects_search_preview_lines"
 
 typedef struct _CodeSlayerRegistry CodeSlayerRegistry;
 typedef struct _CodeSlayerRegistryClass CodeSlayerRegistryClass;
@@ -113,6 +121,7 @@ gchar*               codeslayer_registry_get_string     (CodeSlayerRegistry *reg
 void                 codeslayer_registry_set_string     (CodeSlayerRegistry *registry, 
                                                          gchar              *key,
                                                          gchar              *value);
+CodeSlayerSearchExclude* codeslayer_registry_get_exclude (CodeSlayerRegistry *registry);
 
 G_END_DECLS
 
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <codeslayer/codeslayer-search-matcher.h>
+
+/*
+ * Compares the literal matcher with the globbing the project search used
+ * before it, a "*text*" pattern matched against every line. The corpus
+ * is made up of source like lines with the literal on a few of them, and
+ * every way of searching has to find the same number of lines.
+ *
+ *   codeslayer-search-bench [literal] [megabytes] [rounds]
+ */
+
+#define BENCH_LITERAL "codeslayer_search_matcher"
+#define BENCH_MEGABYTES 64
+#define BENCH_ROUNDS 5
+#define BENCH_HIT_EVERY 5000
+
+static const gchar *words[] = {
+  "static", "void", "gchar", "const", "return", "if", "else", "while",
+  "for", "g_free", "priv", "buffer", "length", "text", "list", "NULL",
+  "TRUE", "FALSE", "gboolean", "gint", "g_list_next", "project", "file",
+  "=", "==", "!=", "(", ")", "{", "}", ";", "->", "*", "+", "0", "1"
+};
+
+static gchar*      create_corpus         (gsize                    size,
+                                          const gchar             *literal,
+                                          gsize                   *length);
+static guint       count_pattern         (gchar                  **lines,
+                                          const gchar             *literal,
+                                          gboolean                 match_case);
+static guint       count_matcher         (CodeSlayerSearchMatcher *matcher,
+                                          const gchar             *text,
+                                          gsize                    length);
+static void        print_result          (const gchar             *name,
+                                          gboolean                 match_case,
+                                          guint                    count,
+                                          gdouble                  seconds,
+                                          gsize                    length);
+
+int
+main (int   argc,
+      char *argv[])
+{
+  const gchar *literal = BENCH_LITERAL;
+  const gchar *kernels[] = { "memchr", "sse2", "avx2" };
+  gsize megabytes = BENCH_MEGABYTES;
+  gint rounds = BENCH_ROUNDS;
+  gchar *corpus;
+  gchar **lines;
+  gsize length;
+  gint status = 0;
+  gint c;
+
+  if (argc > 1)
+    literal = argv[1];
+  if (argc > 2)
+    megabytes = MAX (1, atoi (argv[2]));
+  if (argc > 3)
+    rounds = MAX (1, atoi (argv[3]));
+
+  if (*literal == '\0' || strchr (literal, '\n') != NULL)
+    {
+      g_printerr ("The literal has to be a single line of text.\n");
+      return 1;
+    }
+
+  corpus = create_corpus (megabytes * 1024 * 1024, literal, &length);
+  lines = g_strsplit (corpus, "\n", -1);
+
+  g_print ("corpus: %" G_GSIZE_FORMAT " bytes, literal \"%s\", best kernel %s\n",
+           length, literal, codeslayer_search_matcher_get_kernel ());
+
+  for (c = 0; c < 2; c++)
+    {
+      gboolean match_case = c == 0;
+      GTimer *timer;
+      guint expected = 0;
+      guint i;
+      gint r;
+
+      timer = g_timer_new ();
+      for (r = 0; r < rounds; r++)
+        expected = count_pattern (lines, literal, match_case);
+      print_result ("g_pattern", match_case, expected,
+                    g_timer_elapsed (timer, NULL) / rounds, length);
+
+      for (i = 0; i < G_N_ELEMENTS (kernels); i++)
+        {
+          CodeSlayerSearchMatcher *matcher;
+          guint count = 0;
+
+          matcher = codeslayer_search_matcher_new_for_kernel (literal, match_case, kernels[i]);
+          if (matcher == NULL)
+            {
+              g_print ("%-10s %-6s not supported by this CPU\n", kernels[i],
+                       match_case ? "case" : "nocase");
+              continue;
+            }
+
+          g_timer_start (timer);
+          for (r = 0; r < rounds; r++)
+            count = count_matcher (matcher, corpus, length);
+          print_result (kernels[i], match_case, count,
+                        g_timer_elapsed (timer, NULL) / rounds, length);
+
+          if (count != expected)
+            {
+              g_printerr ("%s found %u lines, the pattern found %u\n", kernels[i], count, expected);
+              status = 1;
+            }
+
+          codeslayer_search_matcher_free (matcher);
+        }
+
+      g_timer_destroy (timer);
+    }
+
+  g_strfreev (lines);
+  g_free (corpus);
+
+  return status;
+}
+
+/*
+ * The same seed every run, so the numbers can be compared between runs.
+ * Every so many lines get the literal, some of them in upper case.
+ */
+static gchar*
+create_corpus (gsize        size,
+               const gchar *literal,
+               gsize       *length)
+{
+  GString *corpus;
+  GRand *rand;
+  guint line = 0;
+
+  corpus = g_string_sized_new (size + 256);
+  rand = g_rand_new_with_seed (42);
+
+  while (corpus->len < size)
+    {
+      gint n_words;
+      gint i;
+
+      g_string_append_len (corpus, "        ", g_rand_int_range (rand, 0, 8));
+
+      n_words = g_rand_int_range (rand, 2, 14);
+      for (i = 0; i < n_words; i++)
+        {
+          g_string_append (corpus, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+          g_string_append_c (corpus, ' ');
+        }
+
+      if (++line % BENCH_HIT_EVERY == 0)
+        {
+          if (line % (BENCH_HIT_EVERY * 2) == 0)
+            {
+              gchar *upper;
+              upper = g_ascii_strup (literal, -1);
+              g_string_append (corpus, upper);
+              g_free (upper);
+            }
+          else
+            {
+              g_string_append (corpus, literal);
+            }
+        }
+
+      g_string_append_c (corpus, '\n');
+    }
+
+  g_rand_free (rand);
+
+  *length = corpus->len;
+  return g_string_free (corpus, FALSE);
+}
+
+/*
+ * How the search worked before the matcher, a lower case copy of every
+ * line when the case is ignored.
+ */
+static guint
+count_pattern (gchar       **lines,
+               const gchar  *literal,
+               gboolean      match_case)
+{
+  GPatternSpec *pattern;
+  gchar *lower_literal;
+  gchar *globbing;
+  guint count = 0;
+
+  lower_literal = g_ascii_strdown (literal, -1);
+  globbing = g_strconcat ("*", match_case ? literal : lower_literal, "*", NULL);
+  g_free (lower_literal);
+
+  pattern = g_pattern_spec_new (globbing);
+
+  for (; *lines != NULL; lines++)
+    {
+      if (match_case)
+        {
+          if (g_pattern_match_string (pattern, *lines))
+            count++;
+        }
+      else
+        {
+          gchar *lower;
+          lower = g_ascii_strdown (*lines, -1);
+          if (g_pattern_match_string (pattern, lower))
+            count++;
+          g_free (lower);
+        }
+    }
+
+  g_pattern_spec_free (pattern);
+  g_free (globbing);
+
+  return count;
+}
+
+/*
+ * Searches the whole corpus at once and goes on after the line of each
+ * match, the way the scanner does.
+ */
+static guint
+count_matcher (CodeSlayerSearchMatcher *matcher,
+               const gchar             *text,
+               gsize                    length)
+{
+  const gchar *pos = text;
+  const gchar *end = text + length;
+  guint count = 0;
+
+  while (pos < end)
+    {
+      const gchar *line_end;
+      gssize offset;
+
+      offset = codeslayer_search_matcher_find (matcher, pos, end - pos);
+      if (offset < 0)
+        break;
+
+      count++;
+
+      line_end = memchr (pos + offset, '\n', end - pos - offset);
+      if (line_end == NULL)
+        break;
+      pos = line_end + 1;
+    }
+
+  return count;
+}
+
+static void
+print_result (const gchar *name,
+              gboolean     match_case,
+              guint        count,
+              gdouble      seconds,
+              gsize        length)
+{
+  g_print ("%-10s %-6s %8u lines %10.2f ms %10.1f MB/s\n", name,
+           match_case ? "case" : "nocase", count, seconds * 1000,
+           seconds > 0 ? length / seconds / (1024 * 1024) : 0.0);
+}
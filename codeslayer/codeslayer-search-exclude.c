@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-exclude.h>
+
+/**
+ * SECTION:codeslayer-search-exclude
+ * @short_description: The excluded file types and directories.
+ * @title: CodeSlayerSearchExclude
+ * @include: codeslayer/codeslayer-search-exclude.h
+ *
+ * The comma separated lists of the excluded file types and directories
+ * compiled for lookups. A directory is excluded by its name, so the
+ * names go in a hash set. A file type is any ending of the file name,
+ * so the types go in a trie of the reversed types, which is walked from
+ * the end of the name and stops at the first byte no type has.
+ *
+ * It is only read once it is compiled, so it can be shared between
+ * threads.
+ */
+
+typedef struct
+{
+  guint  first_child;
+  guint  next_sibling;
+  guchar byte;
+  guchar type_end;
+} ExcludeNode;
+
+struct _CodeSlayerSearchExclude
+{
+  gint        ref_count;
+  GHashTable *dirs;
+  GArray     *nodes;
+};
+
+static void   add_type    (CodeSlayerSearchExclude *exclude,
+                           const gchar             *type);
+static guint  find_child  (CodeSlayerSearchExclude *exclude,
+                           guint                    node,
+                           guchar                   byte);
+
+/**
+ * codeslayer_search_exclude_new:
+ * @exclude_types: the excluded file types as a comma separated list.
+ * @exclude_dirs: the excluded directories as a comma separated list.
+ *
+ * Returns: a new #CodeSlayerSearchExclude. Free with
+ * codeslayer_search_exclude_unref().
+ */
+CodeSlayerSearchExclude*
+codeslayer_search_exclude_new (const gchar *exclude_types,
+                               const gchar *exclude_dirs)
+{
+  CodeSlayerSearchExclude *exclude;
+  ExcludeNode root = {0, 0, 0, FALSE};
+  gchar **split, **tmp;
+
+  exclude = g_malloc (sizeof (CodeSlayerSearchExclude));
+  exclude->ref_count = 1;
+  exclude->dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  exclude->nodes = g_array_new (FALSE, FALSE, sizeof (ExcludeNode));
+  g_array_append_val (exclude->nodes, root);
+
+  /* an empty entry would otherwise be the ending of every name */
+  split = g_strsplit (exclude_types != NULL ? exclude_types : "", ",", 0);
+  for (tmp = split; *tmp != NULL; tmp++)
+    {
+      g_strstrip (*tmp);
+      if (**tmp != '\0')
+        add_type (exclude, *tmp);
+    }
+  g_strfreev (split);
+
+  split = g_strsplit (exclude_dirs != NULL ? exclude_dirs : "", ",", 0);
+  for (tmp = split; *tmp != NULL; tmp++)
+    {
+      g_strstrip (*tmp);
+      if (**tmp != '\0')
+        g_hash_table_add (exclude->dirs, g_strdup (*tmp));
+    }
+  g_strfreev (split);
+
+  return exclude;
+}
+
+/**
+ * codeslayer_search_exclude_ref:
+ * @exclude: a #CodeSlayerSearchExclude.
+ *
+ * Returns: the @exclude.
+ */
+CodeSlayerSearchExclude*
+codeslayer_search_exclude_ref (CodeSlayerSearchExclude *exclude)
+{
+  g_atomic_int_inc (&exclude->ref_count);
+  return exclude;
+}
+
+/**
+ * codeslayer_search_exclude_unref:
+ * @exclude: a #CodeSlayerSearchExclude.
+ */
+void
+codeslayer_search_exclude_unref (CodeSlayerSearchExclude *exclude)
+{
+  if (!g_atomic_int_dec_and_test (&exclude->ref_count))
+    return;
+
+  g_hash_table_destroy (exclude->dirs);
+  g_array_free (exclude->nodes, TRUE);
+  g_free (exclude);
+}
+
+/**
+ * codeslayer_search_exclude_is_excluded_file:
+ * @exclude: a #CodeSlayerSearchExclude.
+ * @file_name: the name of the file.
+ *
+ * Returns: TRUE if the name ends with one of the excluded file types.
+ */
+gboolean
+codeslayer_search_exclude_is_excluded_file (CodeSlayerSearchExclude *exclude,
+                                            const gchar             *file_name)
+{
+  const gchar *pos;
+  guint node = 0;
+
+  pos = file_name + strlen (file_name);
+  while (pos > file_name)
+    {
+      node = find_child (exclude, node, *--pos);
+      if (node == 0)
+        return FALSE;
+      if (g_array_index (exclude->nodes, ExcludeNode, node).type_end)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/**
+ * codeslayer_search_exclude_is_excluded_dir:
+ * @exclude: a #CodeSlayerSearchExclude.
+ * @dir_name: the name of the directory.
+ *
+ * Returns: TRUE if the directory is one of the excluded directories.
+ */
+gboolean
+codeslayer_search_exclude_is_excluded_dir (CodeSlayerSearchExclude *exclude,
+                                           const gchar             *dir_name)
+{
+  return g_hash_table_contains (exclude->dirs, dir_name);
+}
+
+static void
+add_type (CodeSlayerSearchExclude *exclude,
+          const gchar             *type)
+{
+  const gchar *pos;
+  guint node = 0;
+
+  pos = type + strlen (type);
+  while (pos > type)
+    {
+      guchar byte = *--pos;
+      guint child;
+
+      child = find_child (exclude, node, byte);
+      if (child == 0)
+        {
+          ExcludeNode *parent;
+          ExcludeNode added;
+
+          parent = &g_array_index (exclude->nodes, ExcludeNode, node);
+          added.first_child = 0;
+          added.next_sibling = parent->first_child;
+          added.byte = byte;
+          added.type_end = FALSE;
+
+          child = exclude->nodes->len;
+          parent->first_child = child;
+          g_array_append_val (exclude->nodes, added);
+        }
+      node = child;
+    }
+
+  g_array_index (exclude->nodes, ExcludeNode, node).type_end = TRUE;
+}
+
+/*
+ * The root is never a child, so 0 means there is none.
+ */
+static guint
+find_child (CodeSlayerSearchExclude *exclude,
+            guint                    node,
+            guchar                   byte)
+{
+  ExcludeNode *nodes = (ExcludeNode*) exclude->nodes->data;
+  guint child;
+
+  for (child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling)
+    {
+      if (nodes[child].byte == byte)
+        return child;
+    }
+
+  return 0;
+}
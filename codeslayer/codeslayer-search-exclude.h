@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_EXCLUDE_H__
+#define	__CODESLAYER_SEARCH_EXCLUDE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchExclude CodeSlayerSearchExclude;
+
+CodeSlayerSearchExclude*  codeslayer_search_exclude_new               (const gchar             *exclude_types,
+                                                                       const gchar             *exclude_dirs);
+CodeSlayerSearchExclude*  codeslayer_search_exclude_ref               (CodeSlayerSearchExclude *exclude);
+void                      codeslayer_search_exclude_unref             (CodeSlayerSearchExclude *exclude);
+gboolean                  codeslayer_search_exclude_is_excluded_file  (CodeSlayerSearchExclude *exclude,
+                                                                       const gchar             *file_name);
+gboolean                  codeslayer_search_exclude_is_excluded_dir   (CodeSlayerSearchExclude *exclude,
+                                                                       const gchar             *dir_name);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_EXCLUDE_H__ */
@@ -0,0 +1,604 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-ignore.h>
+
+/*
+ * The rules of the .gitignore and .ignore files of one directory. The
+ * rules are compiled when the walk enters the directory and then handed
+ * down to every directory under it, so each ignore file is read once.
+ * A directory without an ignore file just shares the rules of its parent.
+ *
+ * Most rules are a plain name or a file extension, so those are looked
+ * up in a hash table by the name or the extension of the file, and only
+ * the other globs are tried one after the other. Within a directory the
+ * last rule that matches decides, and the rules of a directory come
+ * before the rules of the directories above it, the same as git.
+ *
+ * The rules are only read once they are compiled, so the workers of a
+ * search share them.
+ */
+
+typedef struct
+{
+  gchar    *pattern;
+  gboolean  negated;
+  gboolean  dir_only;
+  gboolean  anchored;
+} IgnoreRule;
+
+struct _CodeSlayerSearchIgnore
+{
+  gint                    ref_count;
+  CodeSlayerSearchIgnore *parent;
+  gchar                  *folder_path;
+  gsize                   folder_length;
+  GArray                 *rules;
+  GHashTable             *names;
+  GHashTable             *extensions;
+  GArray                 *globs;
+  gboolean                anchored;
+};
+
+static const gchar *ignore_files[] = {".gitignore", ".ignore", NULL};
+
+static void          free_ignore        (CodeSlayerSearchIgnore *ignore);
+static void          add_rule           (CodeSlayerSearchIgnore *ignore,
+                                         gchar                  *line);
+static void          add_rule_index     (GHashTable             *table,
+                                         const gchar            *key,
+                                         guint                   index);
+static gint          match_rules        (CodeSlayerSearchIgnore *ignore,
+                                         const gchar            *folder_path,
+                                         const gchar            *file_name,
+                                         gboolean                is_dir);
+static gint          find_last_rule     (CodeSlayerSearchIgnore *ignore,
+                                         GArray                 *indexes,
+                                         gint                    match,
+                                         const gchar            *file_name,
+                                         const gchar            *relative_path,
+                                         gboolean                is_dir);
+static gchar*        get_relative_path  (CodeSlayerSearchIgnore *ignore,
+                                         const gchar            *folder_path,
+                                         const gchar            *file_name);
+static gboolean      glob_match         (const gchar            *pattern,
+                                         const gchar            *string);
+static const gchar*  match_class        (const gchar            *pattern,
+                                         guchar                  c,
+                                         gboolean               *matched);
+
+/**
+ * codeslayer_search_ignore_new:
+ * @parent: (allow-none): the rules of the directory above.
+ * @folder_path: the directory the walk is entering.
+ *
+ * Returns: the rules that apply to the files of the directory, or
+ * %NULL if there are none. Free with codeslayer_search_ignore_unref().
+ */
+CodeSlayerSearchIgnore*
+codeslayer_search_ignore_new (CodeSlayerSearchIgnore *parent,
+                              const gchar            *folder_path)
+{
+  CodeSlayerSearchIgnore *ignore;
+  gsize length;
+  gint i;
+
+  ignore = g_malloc0 (sizeof (CodeSlayerSearchIgnore));
+  ignore->rules = g_array_new (FALSE, FALSE, sizeof (IgnoreRule));
+  ignore->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, (GDestroyNotify) g_array_unref);
+  ignore->extensions = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              NULL, (GDestroyNotify) g_array_unref);
+  ignore->globs = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (i = 0; ignore_files[i] != NULL; i++)
+    {
+      gchar *file_path;
+      gchar *contents;
+
+      file_path = g_build_filename (folder_path, ignore_files[i], NULL);
+      if (g_file_get_contents (file_path, &contents, NULL, NULL))
+        {
+          gchar **lines, **tmp;
+          lines = g_strsplit (contents, "\n", -1);
+          for (tmp = lines; *tmp != NULL; tmp++)
+            add_rule (ignore, *tmp);
+          g_strfreev (lines);
+          g_free (contents);
+        }
+      g_free (file_path);
+    }
+
+  if (ignore->rules->len == 0)
+    {
+      free_ignore (ignore);
+      return codeslayer_search_ignore_ref (parent);
+    }
+
+  /* the relative paths are taken from here, so no trailing separator */
+  length = strlen (folder_path);
+  while (length > 1 && folder_path[length - 1] == G_DIR_SEPARATOR)
+    length--;
+
+  ignore->ref_count = 1;
+  ignore->parent = codeslayer_search_ignore_ref (parent);
+  ignore->folder_path = g_strndup (folder_path, length);
+  ignore->folder_length = length;
+
+  return ignore;
+}
+
+/**
+ * codeslayer_search_ignore_new_for_folder:
+ * @root_path: the folder of the project.
+ * @folder_path: a directory in the project.
+ *
+ * Reads the ignore files of every directory from the project down to
+ * the directory, for when the directory is not reached by a walk.
+ *
+ * Returns: the same as codeslayer_search_ignore_new().
+ */
+CodeSlayerSearchIgnore*
+codeslayer_search_ignore_new_for_folder (const gchar *root_path,
+                                         const gchar *folder_path)
+{
+  CodeSlayerSearchIgnore *ignore;
+  gsize length;
+
+  ignore = codeslayer_search_ignore_new (NULL, root_path);
+
+  length = strlen (root_path);
+  while (length > 1 && root_path[length - 1] == G_DIR_SEPARATOR)
+    length--;
+
+  if (strncmp (folder_path, root_path, length) == 0
+      && folder_path[length] == G_DIR_SEPARATOR)
+    {
+      gchar **split, **tmp;
+      gchar *path;
+
+      path = g_strndup (root_path, length);
+      split = g_strsplit (folder_path + length, G_DIR_SEPARATOR_S, -1);
+
+      for (tmp = split; *tmp != NULL; tmp++)
+        {
+          CodeSlayerSearchIgnore *child;
+          gchar *child_path;
+
+          if (**tmp == '\0')
+            continue;
+
+          child_path = g_build_filename (path, *tmp, NULL);
+          child = codeslayer_search_ignore_new (ignore, child_path);
+          codeslayer_search_ignore_unref (ignore);
+          ignore = child;
+
+          g_free (path);
+          path = child_path;
+        }
+
+      g_strfreev (split);
+      g_free (path);
+    }
+
+  return ignore;
+}
+
+/**
+ * codeslayer_search_ignore_ref:
+ * @ignore: (allow-none): a #CodeSlayerSearchIgnore.
+ *
+ * Returns: the @ignore.
+ */
+CodeSlayerSearchIgnore*
+codeslayer_search_ignore_ref (CodeSlayerSearchIgnore *ignore)
+{
+  if (ignore != NULL)
+    g_atomic_int_inc (&ignore->ref_count);
+  return ignore;
+}
+
+/**
+ * codeslayer_search_ignore_unref:
+ * @ignore: (allow-none): a #CodeSlayerSearchIgnore.
+ */
+void
+codeslayer_search_ignore_unref (CodeSlayerSearchIgnore *ignore)
+{
+  while (ignore != NULL && g_atomic_int_dec_and_test (&ignore->ref_count))
+    {
+      CodeSlayerSearchIgnore *parent = ignore->parent;
+      free_ignore (ignore);
+      ignore = parent;
+    }
+}
+
+/**
+ * codeslayer_search_ignore_is_ignored:
+ * @ignore: (allow-none): the rules of the directory.
+ * @folder_path: the directory of the file.
+ * @file_name: the name of the file.
+ * @is_dir: is TRUE if the file is a directory.
+ *
+ * Returns: TRUE if the file should be left out of the walk.
+ */
+gboolean
+codeslayer_search_ignore_is_ignored (CodeSlayerSearchIgnore *ignore,
+                                     const gchar            *folder_path,
+                                     const gchar            *file_name,
+                                     gboolean                is_dir)
+{
+  for (; ignore != NULL; ignore = ignore->parent)
+    {
+      gint match;
+      match = match_rules (ignore, folder_path, file_name, is_dir);
+      if (match != -1)
+        return !g_array_index (ignore->rules, IgnoreRule, match).negated;
+    }
+
+  return FALSE;
+}
+
+static void
+free_ignore (CodeSlayerSearchIgnore *ignore)
+{
+  guint i;
+
+  for (i = 0; i < ignore->rules->len; i++)
+    g_free (g_array_index (ignore->rules, IgnoreRule, i).pattern);
+
+  g_hash_table_destroy (ignore->names);
+  g_hash_table_destroy (ignore->extensions);
+  g_array_free (ignore->rules, TRUE);
+  g_array_free (ignore->globs, TRUE);
+  g_free (ignore->folder_path);
+  g_free (ignore);
+}
+
+static void
+add_rule (CodeSlayerSearchIgnore *ignore,
+          gchar                  *line)
+{
+  IgnoreRule rule = {NULL, FALSE, FALSE, FALSE};
+  gchar *pattern = line;
+  gsize length;
+  guint index;
+
+  /* trailing spaces are dropped unless they are escaped */
+  length = strlen (line);
+  while (length > 0 && (line[length - 1] == '\r' ||
+                        (line[length - 1] == ' ' && (length < 2 || line[length - 2] != '\\'))))
+    length--;
+  line[length] = '\0';
+
+  if (*pattern == '\0' || *pattern == '#')
+    return;
+
+  if (*pattern == '!')
+    {
+      rule.negated = TRUE;
+      pattern++;
+    }
+  else if (*pattern == '\\' && (pattern[1] == '#' || pattern[1] == '!'))
+    {
+      pattern++;
+    }
+
+  length = strlen (pattern);
+  if (length > 0 && pattern[length - 1] == '/')
+    {
+      rule.dir_only = TRUE;
+      pattern[--length] = '\0';
+    }
+
+  /* a slash ties the pattern to this directory, unless it only leads with ** */
+  if (g_str_has_prefix (pattern, "**/") && strchr (pattern + 3, '/') == NULL)
+    {
+      pattern += 3;
+    }
+  else if (strchr (pattern, '/') != NULL)
+    {
+      rule.anchored = TRUE;
+      while (*pattern == '/')
+        pattern++;
+    }
+
+  if (*pattern == '\0')
+    return;
+
+  rule.pattern = g_strdup (pattern);
+  index = ignore->rules->len;
+  g_array_append_val (ignore->rules, rule);
+
+  if (rule.anchored)
+    {
+      ignore->anchored = TRUE;
+      g_array_append_val (ignore->globs, index);
+    }
+  else if (strpbrk (pattern, "*?[\\") == NULL)
+    {
+      add_rule_index (ignore->names, rule.pattern, index);
+    }
+  else if (pattern[0] == '*' && pattern[1] == '.' && strpbrk (pattern + 1, "*?[\\") == NULL)
+    {
+      add_rule_index (ignore->extensions, strrchr (rule.pattern, '.') + 1, index);
+    }
+  else
+    {
+      g_array_append_val (ignore->globs, index);
+    }
+}
+
+static void
+add_rule_index (GHashTable  *table,
+                const gchar *key,
+                guint        index)
+{
+  GArray *indexes;
+
+  indexes = g_hash_table_lookup (table, key);
+  if (indexes == NULL)
+    {
+      indexes = g_array_new (FALSE, FALSE, sizeof (guint));
+      g_hash_table_insert (table, (gpointer) key, indexes);
+    }
+
+  g_array_append_val (indexes, index);
+}
+
+/*
+ * Returns the index of the last rule of the directory that matches the
+ * file, or -1 when none of them do.
+ */
+static gint
+match_rules (CodeSlayerSearchIgnore *ignore,
+             const gchar            *folder_path,
+             const gchar            *file_name,
+             gboolean                is_dir)
+{
+  const gchar *extension;
+  gchar *relative_path = NULL;
+  gint match = -1;
+
+  if (ignore->anchored)
+    relative_path = get_relative_path (ignore, folder_path, file_name);
+
+  match = find_last_rule (ignore, g_hash_table_lookup (ignore->names, file_name),
+                          match, file_name, relative_path, is_dir);
+
+  extension = strrchr (file_name, '.');
+  if (extension != NULL)
+    match = find_last_rule (ignore, g_hash_table_lookup (ignore->extensions, extension + 1),
+                            match, file_name, relative_path, is_dir);
+
+  match = find_last_rule (ignore, ignore->globs, match, file_name, relative_path, is_dir);
+
+  g_free (relative_path);
+  return match;
+}
+
+/*
+ * The indexes are in the order of the rules, so looking from the end
+ * stops at the first rule that matches, or at the match already found.
+ */
+static gint
+find_last_rule (CodeSlayerSearchIgnore *ignore,
+                GArray                 *indexes,
+                gint                    match,
+                const gchar            *file_name,
+                const gchar            *relative_path,
+                gboolean                is_dir)
+{
+  guint i;
+
+  if (indexes == NULL)
+    return match;
+
+  for (i = indexes->len; i > 0; i--)
+    {
+      guint index = g_array_index (indexes, guint, i - 1);
+      IgnoreRule *rule;
+
+      if ((gint) index <= match)
+        break;
+
+      rule = &g_array_index (ignore->rules, IgnoreRule, index);
+      if (rule->dir_only && !is_dir)
+        continue;
+
+      if (rule->anchored)
+        {
+          if (relative_path != NULL && glob_match (rule->pattern, relative_path))
+            return index;
+        }
+      else if (glob_match (rule->pattern, file_name))
+        {
+          return index;
+        }
+    }
+
+  return match;
+}
+
+static gchar*
+get_relative_path (CodeSlayerSearchIgnore *ignore,
+                   const gchar            *folder_path,
+                   const gchar            *file_name)
+{
+  const gchar *rest;
+
+  if (strncmp (folder_path, ignore->folder_path, ignore->folder_length) != 0)
+    return NULL;
+
+  rest = folder_path + ignore->folder_length;
+  if (*rest != '\0' && *rest != G_DIR_SEPARATOR && ignore->folder_length > 1)
+    return NULL;
+
+  while (*rest == G_DIR_SEPARATOR)
+    rest++;
+
+  if (*rest == '\0')
+    return g_strdup (file_name);
+
+  return g_strconcat (rest, G_DIR_SEPARATOR_S, file_name, NULL);
+}
+
+/*
+ * A glob the way git reads it. Only ** crosses a slash, and a **
+ * followed by a slash also matches no directories at all.
+ */
+static gboolean
+glob_match (const gchar *pattern,
+            const gchar *string)
+{
+  while (*pattern != '\0')
+    {
+      const gchar *end;
+      gboolean matched;
+
+      switch (*pattern)
+        {
+        case '*':
+          if (pattern[1] == '*')
+            {
+              pattern += 2;
+              if (*pattern == '/')
+                {
+                  pattern++;
+                  while (!glob_match (pattern, string))
+                    {
+                      string = strchr (string, '/');
+                      if (string == NULL)
+                        return FALSE;
+                      string++;
+                    }
+                  return TRUE;
+                }
+
+              for (;; string++)
+                {
+                  if (glob_match (pattern, string))
+                    return TRUE;
+                  if (*string == '\0')
+                    return FALSE;
+                }
+            }
+
+          pattern++;
+          if (*pattern == '\0')
+            return strchr (string, '/') == NULL;
+
+          for (;; string++)
+            {
+              if (glob_match (pattern, string))
+                return TRUE;
+              if (*string == '\0' || *string == '/')
+                return FALSE;
+            }
+
+        case '?':
+          if (*string == '\0' || *string == '/')
+            return FALSE;
+          pattern++;
+          string++;
+          break;
+
+        case '[':
+          if (*string == '\0' || *string == '/')
+            return FALSE;
+          end = match_class (pattern, *string, &matched);
+          if (end != NULL)
+            {
+              if (!matched)
+                return FALSE;
+              pattern = end;
+              string++;
+              break;
+            }
+          /* an unclosed class is just the bracket */
+          if (*string != '[')
+            return FALSE;
+          pattern++;
+          string++;
+          break;
+
+        case '\\':
+          if (pattern[1] != '\0')
+            pattern++;
+          /* fall through */
+
+        default:
+          if (*pattern != *string)
+            return FALSE;
+          pattern++;
+          string++;
+          break;
+        }
+    }
+
+  return *string == '\0';
+}
+
+/*
+ * Returns the pattern after the class, or NULL if the class is not closed.
+ */
+static const gchar*
+match_class (const gchar *pattern,
+             guchar       c,
+             gboolean    *matched)
+{
+  const gchar *first;
+  gboolean negated = FALSE;
+  gboolean found = FALSE;
+
+  pattern++;
+  if (*pattern == '!' || *pattern == '^')
+    {
+      negated = TRUE;
+      pattern++;
+    }
+
+  /* a bracket right at the start is part of the class */
+  first = pattern;
+  while (*pattern != ']' || pattern == first)
+    {
+      guchar low, high;
+
+      if (*pattern == '\0')
+        return NULL;
+
+      if (*pattern == '\\' && pattern[1] != '\0')
+        pattern++;
+      low = high = *pattern++;
+
+      if (*pattern == '-' && pattern[1] != ']' && pattern[1] != '\0')
+        {
+          pattern++;
+          if (*pattern == '\\' && pattern[1] != '\0')
+            pattern++;
+          high = *pattern++;
+        }
+
+      if (c >= low && c <= high)
+        found = TRUE;
+    }
+
+  *matched = found != negated;
+  return pattern + 1;
+}
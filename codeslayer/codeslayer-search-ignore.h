@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_IGNORE_H__
+#define	__CODESLAYER_SEARCH_IGNORE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchIgnore CodeSlayerSearchIgnore;
+
+CodeSlayerSearchIgnore*  codeslayer_search_ignore_new             (CodeSlayerSearchIgnore *parent,
+                                                                   const gchar            *folder_path);
+CodeSlayerSearchIgnore*  codeslayer_search_ignore_new_for_folder  (const gchar            *root_path,
+                                                                   const gchar            *folder_path);
+CodeSlayerSearchIgnore*  codeslayer_search_ignore_ref             (CodeSlayerSearchIgnore *ignore);
+void                     codeslayer_search_ignore_unref           (CodeSlayerSearchIgnore *ignore);
+gboolean                 codeslayer_search_ignore_is_ignored      (CodeSlayerSearchIgnore *ignore,
+                                                                   const gchar            *folder_path,
+                                                                   const gchar            *file_name,
+                                                                   gboolean                is_dir);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_IGNORE_H__ */
@@ -0,0 +1,639 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-index.h>
+
+/*
+ * Remembers which three byte sequences each file of a project has, so a 
+ * search only has to read the files that can contain its text. Every 
+ * file keeps a small bloom filter of its trigrams, sized by the length 
+ * of the file, together with the modification time and size it had when 
+ * it was read. A file that changed since then is stale and has to be 
+ * read again, which brings its entry up to date.
+ *
+ * Letters are folded to lowercase, so the same index serves searches 
+ * with and without Match Case. Trigrams that span a newline are left 
+ * out since a search never matches across lines.
+ *
+ * The entries are looked up and replaced by all of the search workers, 
+ * so the table is guarded by a mutex. A new entry is filled from the 
+ * blocks the search reads anyway, outside of the lock, so the file is 
+ * never read a second time.
+ */
+
+#define INDEX_MAGIC "CSSI"
+#define INDEX_VERSION 1
+#define INDEX_MIN_BITS 512
+#define INDEX_MAX_BITS (1024 * 1024)
+
+struct _CodeSlayerSearchIndexEntry
+{
+  gint64   mtime;
+  gint64   size;
+  guint    generation;
+  gboolean binary;
+  guint32  n_bits;
+  guint8  *bits;
+};
+
+typedef CodeSlayerSearchIndexEntry IndexEntry;
+
+struct _CodeSlayerSearchIndex
+{
+  gchar      *index_path;
+  GHashTable *entries;
+  GMutex      mutex;
+  guint       generation;
+  gboolean    dirty;
+};
+
+/*
+ * A file matches when it has all of the trigrams of any one of the 
+ * alternatives. Each alternative ends where the next one starts.
+ */
+struct _CodeSlayerSearchIndexQuery
+{
+  GArray *trigrams;
+  GArray *ends;
+};
+
+static IndexEntry* create_entry    (gint64       size);
+static void free_entry             (IndexEntry  *entry);
+static void load_entries           (CodeSlayerSearchIndex *index,
+                                    const gchar *contents,
+                                    gsize        length);
+static gboolean has_trigram        (IndexEntry  *entry,
+                                    guint32      trigram);
+static void get_positions          (guint32      trigram,
+                                    guint32      n_bits,
+                                    guint32     *first,
+                                    guint32     *second);
+static guint32 mix                 (guint32      h);
+static guint32 get_trigram         (const guchar *text);
+static gboolean add_alternative    (CodeSlayerSearchIndexQuery *query,
+                                    const gchar *literal,
+                                    gboolean     match_case);
+
+/**
+ * codeslayer_search_index_load:
+ * @index_path: the file the index is kept in.
+ *
+ * Loads the index from the file. A missing or damaged file gives an 
+ * empty index, which fills up as files are searched.
+ *
+ * Returns: a new #CodeSlayerSearchIndex.
+ */
+CodeSlayerSearchIndex*
+codeslayer_search_index_load (const gchar *index_path)
+{
+  CodeSlayerSearchIndex *index;
+  GMappedFile *mapped_file;
+
+  index = g_malloc0 (sizeof (CodeSlayerSearchIndex));
+  index->index_path = g_strdup (index_path);
+  index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, 
+                                          (GDestroyNotify) free_entry);
+  g_mutex_init (&index->mutex);
+
+  mapped_file = g_mapped_file_new (index_path, FALSE, NULL);
+  if (mapped_file != NULL)
+    {
+      load_entries (index, g_mapped_file_get_contents (mapped_file), 
+                    g_mapped_file_get_length (mapped_file));
+      g_mapped_file_unref (mapped_file);
+    }
+
+  return index;
+}
+
+/**
+ * codeslayer_search_index_free:
+ * @index: a #CodeSlayerSearchIndex.
+ */
+void
+codeslayer_search_index_free (CodeSlayerSearchIndex *index)
+{
+  g_hash_table_destroy (index->entries);
+  g_mutex_clear (&index->mutex);
+  g_free (index->index_path);
+  g_free (index);
+}
+
+/**
+ * codeslayer_search_index_save:
+ * @index: a #CodeSlayerSearchIndex.
+ *
+ * Writes the index back to its file if it changed. The file is 
+ * replaced in one go, so a reader never sees half of an index.
+ *
+ * Returns: is FALSE if the file could not be written.
+ */
+gboolean
+codeslayer_search_index_save (CodeSlayerSearchIndex *index)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GByteArray *data;
+  guint32 n_entries;
+  guint32 version = INDEX_VERSION;
+  gboolean result;
+
+  g_mutex_lock (&index->mutex);
+
+  if (!index->dirty)
+    {
+      g_mutex_unlock (&index->mutex);
+      return TRUE;
+    }
+
+  data = g_byte_array_new ();
+  n_entries = g_hash_table_size (index->entries);
+  g_byte_array_append (data, (const guint8*) INDEX_MAGIC, 4);
+  g_byte_array_append (data, (const guint8*) &version, sizeof (guint32));
+  g_byte_array_append (data, (const guint8*) &n_entries, sizeof (guint32));
+
+  g_hash_table_iter_init (&iter, index->entries);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      IndexEntry *entry = value;
+      guint32 path_length;
+      guint32 binary;
+
+      path_length = strlen (key);
+      binary = entry->binary;
+      g_byte_array_append (data, (const guint8*) &path_length, sizeof (guint32));
+      g_byte_array_append (data, key, path_length);
+      g_byte_array_append (data, (const guint8*) &entry->mtime, sizeof (gint64));
+      g_byte_array_append (data, (const guint8*) &entry->size, sizeof (gint64));
+      g_byte_array_append (data, (const guint8*) &binary, sizeof (guint32));
+      g_byte_array_append (data, (const guint8*) &entry->n_bits, sizeof (guint32));
+      g_byte_array_append (data, entry->bits, entry->n_bits / 8);
+    }
+
+  index->dirty = FALSE;
+  g_mutex_unlock (&index->mutex);
+
+  result = g_file_set_contents (index->index_path, (const gchar*) data->data, 
+                                data->len, NULL);
+  g_byte_array_free (data, TRUE);
+
+  return result;
+}
+
+/**
+ * codeslayer_search_index_begin:
+ * @index: a #CodeSlayerSearchIndex.
+ *
+ * Starts a walk over the whole project. The entries that are not looked 
+ * up or added before codeslayer_search_index_prune() are removed then.
+ */
+void
+codeslayer_search_index_begin (CodeSlayerSearchIndex *index)
+{
+  g_mutex_lock (&index->mutex);
+  index->generation++;
+  g_mutex_unlock (&index->mutex);
+}
+
+/**
+ * codeslayer_search_index_prune:
+ * @index: a #CodeSlayerSearchIndex.
+ *
+ * Removes the files that were not seen since codeslayer_search_index_begin().
+ * Only call this when the walk was not cut short.
+ */
+void
+codeslayer_search_index_prune (CodeSlayerSearchIndex *index)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_mutex_lock (&index->mutex);
+
+  g_hash_table_iter_init (&iter, index->entries);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      IndexEntry *entry = value;
+      if (entry->generation != index->generation)
+        {
+          g_hash_table_iter_remove (&iter);
+          index->dirty = TRUE;
+        }
+    }
+
+  g_mutex_unlock (&index->mutex);
+}
+
+/**
+ * codeslayer_search_index_lookup:
+ * @index: a #CodeSlayerSearchIndex.
+ * @query: a #CodeSlayerSearchIndexQuery, or %NULL to only check the file.
+ * @file_path: the file to look up.
+ * @mtime: the modification time of the file in microseconds.
+ * @size: the size of the file.
+ *
+ * Returns: #CODESLAYER_SEARCH_INDEX_STALE if the file has to be read and 
+ * added again, #CODESLAYER_SEARCH_INDEX_NO_MATCH if the file can not 
+ * contain the text.
+ */
+CodeSlayerSearchIndexResult
+codeslayer_search_index_lookup (CodeSlayerSearchIndex      *index,
+                                CodeSlayerSearchIndexQuery *query,
+                                const gchar                *file_path,
+                                gint64                      mtime,
+                                goffset                     size)
+{
+  CodeSlayerSearchIndexResult result = CODESLAYER_SEARCH_INDEX_MATCH;
+  IndexEntry *entry;
+  guint start = 0;
+  guint i, j;
+
+  g_mutex_lock (&index->mutex);
+
+  entry = g_hash_table_lookup (index->entries, file_path);
+  if (entry == NULL || entry->mtime != mtime || entry->size != size)
+    {
+      g_mutex_unlock (&index->mutex);
+      return CODESLAYER_SEARCH_INDEX_STALE;
+    }
+
+  entry->generation = index->generation;
+
+  if (entry->binary)
+    {
+      result = CODESLAYER_SEARCH_INDEX_BINARY;
+    }
+  else if (query != NULL)
+    {
+      result = CODESLAYER_SEARCH_INDEX_NO_MATCH;
+      for (i = 0; i < query->ends->len && result == CODESLAYER_SEARCH_INDEX_NO_MATCH; i++)
+        {
+          guint end = g_array_index (query->ends, guint, i);
+
+          for (j = start; j < end; j++)
+            {
+              if (!has_trigram (entry, g_array_index (query->trigrams, guint32, j)))
+                break;
+            }
+          if (j == end)
+            result = CODESLAYER_SEARCH_INDEX_MATCH;
+
+          start = end;
+        }
+    }
+
+  g_mutex_unlock (&index->mutex);
+
+  return result;
+}
+
+/**
+ * codeslayer_search_index_add:
+ * @index: a #CodeSlayerSearchIndex.
+ * @file_path: the file of the entry.
+ * @mtime: the modification time of the file in microseconds.
+ * @size: the size of the file.
+ * @entry: the entry, filled with codeslayer_search_index_entry_add_text().
+ *
+ * Replaces the entry of the file, and takes the entry. The time and size 
+ * have to be the ones the file had before it was searched, so a change 
+ * while it was read shows up as stale next time.
+ */
+void
+codeslayer_search_index_add (CodeSlayerSearchIndex      *index,
+                             const gchar                *file_path,
+                             gint64                      mtime,
+                             goffset                     size,
+                             CodeSlayerSearchIndexEntry *entry)
+{
+  entry->mtime = mtime;
+  entry->size = size;
+
+  g_mutex_lock (&index->mutex);
+  entry->generation = index->generation;
+  g_hash_table_replace (index->entries, g_strdup (file_path), entry);
+  index->dirty = TRUE;
+  g_mutex_unlock (&index->mutex);
+}
+
+/**
+ * codeslayer_search_index_entry_new:
+ * @size: the size of the file, which sets the size of the filter.
+ *
+ * Returns: a new empty #CodeSlayerSearchIndexEntry.
+ */
+CodeSlayerSearchIndexEntry*
+codeslayer_search_index_entry_new (goffset size)
+{
+  return create_entry (size);
+}
+
+/**
+ * codeslayer_search_index_entry_free:
+ * @entry: a #CodeSlayerSearchIndexEntry that was not added.
+ */
+void
+codeslayer_search_index_entry_free (CodeSlayerSearchIndexEntry *entry)
+{
+  free_entry (entry);
+}
+
+/**
+ * codeslayer_search_index_entry_add_text:
+ * @entry: a #CodeSlayerSearchIndexEntry.
+ * @text: a block of the file.
+ * @length: the length of the block.
+ *
+ * Adds the trigrams of the block. Blocks that end at the end of a line
+ * lose nothing, since trigrams that span a newline are left out anyway.
+ */
+void
+codeslayer_search_index_entry_add_text (CodeSlayerSearchIndexEntry *entry,
+                                        const gchar                *text,
+                                        gsize                       length)
+{
+  const guchar *bytes = (const guchar*) text;
+  gsize i;
+
+  if (entry->binary)
+    return;
+
+  for (i = 0; i + 2 < length; i++)
+    {
+      guint32 first, second;
+
+      if (bytes[i] == '\n' || bytes[i + 1] == '\n' || bytes[i + 2] == '\n')
+        continue;
+
+      get_positions (get_trigram (bytes + i), entry->n_bits, &first, &second);
+      entry->bits[first / 8] |= 1 << (first % 8);
+      entry->bits[second / 8] |= 1 << (second % 8);
+    }
+}
+
+/**
+ * codeslayer_search_index_entry_set_binary:
+ * @entry: a #CodeSlayerSearchIndexEntry.
+ *
+ * Marks the file as binary, so it is skipped until it changes.
+ */
+void
+codeslayer_search_index_entry_set_binary (CodeSlayerSearchIndexEntry *entry)
+{
+  entry->binary = TRUE;
+  entry->n_bits = 0;
+  g_free (entry->bits);
+  entry->bits = NULL;
+}
+
+/**
+ * codeslayer_search_index_query_new:
+ * @literal: the text that every hit has to contain.
+ * @match_case: is FALSE to ignore the case of the text.
+ *
+ * Returns: a new #CodeSlayerSearchIndexQuery, or %NULL if the text is 
+ * too short to narrow down the files.
+ */
+CodeSlayerSearchIndexQuery*
+codeslayer_search_index_query_new (const gchar *literal, 
+                                   gboolean     match_case)
+{
+  const gchar *terms[] = { literal, NULL };
+  return codeslayer_search_index_query_new_for_terms ((gchar**) terms, match_case);
+}
+
+/**
+ * codeslayer_search_index_query_new_for_terms:
+ * @terms: the terms, every hit contains at least one of them.
+ * @match_case: is FALSE to ignore the case of the terms.
+ *
+ * Returns: a new #CodeSlayerSearchIndexQuery, or %NULL if any of the 
+ * terms is too short to narrow down the files.
+ */
+CodeSlayerSearchIndexQuery*
+codeslayer_search_index_query_new_for_terms (gchar    **terms, 
+                                             gboolean   match_case)
+{
+  CodeSlayerSearchIndexQuery *query;
+
+  query = g_malloc (sizeof (CodeSlayerSearchIndexQuery));
+  query->trigrams = g_array_new (FALSE, FALSE, sizeof (guint32));
+  query->ends = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (; *terms != NULL; terms++)
+    {
+      if (!add_alternative (query, *terms, match_case))
+        {
+          codeslayer_search_index_query_free (query);
+          return NULL;
+        }
+    }
+
+  if (query->ends->len == 0)
+    {
+      codeslayer_search_index_query_free (query);
+      return NULL;
+    }
+
+  return query;
+}
+
+/**
+ * codeslayer_search_index_query_free:
+ * @query: a #CodeSlayerSearchIndexQuery.
+ */
+void
+codeslayer_search_index_query_free (CodeSlayerSearchIndexQuery *query)
+{
+  g_array_free (query->trigrams, TRUE);
+  g_array_free (query->ends, TRUE);
+  g_free (query);
+}
+
+static gboolean
+add_alternative (CodeSlayerSearchIndexQuery *query,
+                 const gchar                *literal,
+                 gboolean                    match_case)
+{
+  const guchar *text = (const guchar*) literal;
+  gsize length;
+  guint start;
+  gsize i;
+
+  start = query->trigrams->len;
+  length = strlen (literal);
+
+  for (i = 0; i + 2 < length; i++)
+    {
+      guint32 trigram;
+
+      /* without Match Case only the ASCII letters are folded the same 
+         way in the text and in the index */
+      if (!match_case && (text[i] >= 0x80 || text[i + 1] >= 0x80 || text[i + 2] >= 0x80))
+        continue;
+
+      trigram = get_trigram (text + i);
+      g_array_append_val (query->trigrams, trigram);
+    }
+
+  if (query->trigrams->len == start)
+    return FALSE;
+
+  g_array_append_val (query->ends, query->trigrams->len);
+  return TRUE;
+}
+
+/*
+ * The file can not have more trigrams than bytes.
+ */
+static IndexEntry*
+create_entry (gint64 size)
+{
+  IndexEntry *entry;
+
+  entry = g_malloc0 (sizeof (IndexEntry));
+
+  entry->n_bits = INDEX_MIN_BITS;
+  while (entry->n_bits < size && entry->n_bits < INDEX_MAX_BITS)
+    entry->n_bits *= 2;
+  entry->bits = g_malloc0 (entry->n_bits / 8);
+
+  return entry;
+}
+
+static void
+free_entry (IndexEntry *entry)
+{
+  g_free (entry->bits);
+  g_free (entry);
+}
+
+/*
+ * Any entry that does not add up leaves the rest of the file unread,
+ * the files it would have covered are simply read again.
+ */
+static void
+load_entries (CodeSlayerSearchIndex *index,
+              const gchar           *contents,
+              gsize                  length)
+{
+  const gchar *pos = contents;
+  const gchar *end = contents + length;
+  guint32 version;
+  guint32 n_entries;
+  guint32 i;
+
+  if (length < 12 || memcmp (pos, INDEX_MAGIC, 4) != 0)
+    return;
+
+  memcpy (&version, pos + 4, sizeof (guint32));
+  memcpy (&n_entries, pos + 8, sizeof (guint32));
+  if (version != INDEX_VERSION)
+    return;
+  pos += 12;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      IndexEntry *entry;
+      guint32 path_length;
+      guint32 binary;
+      guint32 n_bits;
+      gchar *file_path;
+
+      if ((gsize) (end - pos) < sizeof (guint32))
+        return;
+      memcpy (&path_length, pos, sizeof (guint32));
+      pos += sizeof (guint32);
+
+      if ((gsize) (end - pos) < (gsize) path_length + 24)
+        return;
+      file_path = g_strndup (pos, path_length);
+      pos += path_length;
+
+      entry = g_malloc0 (sizeof (IndexEntry));
+      memcpy (&entry->mtime, pos, sizeof (gint64));
+      memcpy (&entry->size, pos + 8, sizeof (gint64));
+      memcpy (&binary, pos + 16, sizeof (guint32));
+      memcpy (&n_bits, pos + 20, sizeof (guint32));
+      pos += 24;
+
+      if (n_bits % 8 != 0 || n_bits > INDEX_MAX_BITS 
+          || (gsize) (end - pos) < n_bits / 8
+          || (!binary && n_bits == 0))
+        {
+          g_free (file_path);
+          g_free (entry);
+          return;
+        }
+
+      entry->binary = binary != 0;
+      entry->n_bits = n_bits;
+      if (n_bits > 0)
+        {
+          entry->bits = g_malloc (n_bits / 8);
+          memcpy (entry->bits, pos, n_bits / 8);
+          pos += n_bits / 8;
+        }
+
+      g_hash_table_replace (index->entries, file_path, entry);
+    }
+}
+
+static gboolean
+has_trigram (IndexEntry *entry,
+             guint32     trigram)
+{
+  guint32 first, second;
+  get_positions (trigram, entry->n_bits, &first, &second);
+  return (entry->bits[first / 8] & (1 << (first % 8))) 
+         && (entry->bits[second / 8] & (1 << (second % 8)));
+}
+
+/*
+ * Two positions from two mixes of the trigram. The number of bits is
+ * always a power of two.
+ */
+static void
+get_positions (guint32  trigram,
+               guint32  n_bits,
+               guint32 *first,
+               guint32 *second)
+{
+  *first = mix (trigram) & (n_bits - 1);
+  *second = mix (trigram ^ 0x5BD1E995u) & (n_bits - 1);
+}
+
+static guint32
+mix (guint32 h)
+{
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return h;
+}
+
+static guint32
+get_trigram (const guchar *text)
+{
+  return (g_ascii_tolower (text[0]) << 16) 
+         | (g_ascii_tolower (text[1]) << 8) 
+         | g_ascii_tolower (text[2]);
+}
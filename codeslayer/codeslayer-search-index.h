@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_INDEX_H__
+#define	__CODESLAYER_SEARCH_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchIndex CodeSlayerSearchIndex;
+typedef struct _CodeSlayerSearchIndexQuery CodeSlayerSearchIndexQuery;
+typedef struct _CodeSlayerSearchIndexEntry CodeSlayerSearchIndexEntry;
+
+typedef enum
+{
+  CODESLAYER_SEARCH_INDEX_STALE = 0,
+  CODESLAYER_SEARCH_INDEX_MATCH,
+  CODESLAYER_SEARCH_INDEX_NO_MATCH,
+  CODESLAYER_SEARCH_INDEX_BINARY
+} CodeSlayerSearchIndexResult;
+
+CodeSlayerSearchIndex*       codeslayer_search_index_load        (const gchar                 *index_path);
+void                         codeslayer_search_index_free        (CodeSlayerSearchIndex       *index);
+gboolean                     codeslayer_search_index_save        (CodeSlayerSearchIndex       *index);
+void                         codeslayer_search_index_begin       (CodeSlayerSearchIndex       *index);
+void                         codeslayer_search_index_prune       (CodeSlayerSearchIndex       *index);
+CodeSlayerSearchIndexResult  codeslayer_search_index_lookup      (CodeSlayerSearchIndex       *index,
+                                                                  CodeSlayerSearchIndexQuery  *query,
+                                                                  const gchar                 *file_path,
+                                                                  gint64                       mtime,
+                                                                  goffset                      size);
+void                         codeslayer_search_index_add         (CodeSlayerSearchIndex       *index,
+                                                                  const gchar                 *file_path,
+                                                                  gint64                       mtime,
+                                                                  goffset                      size,
+                                                                  CodeSlayerSearchIndexEntry  *entry);
+CodeSlayerSearchIndexEntry*  codeslayer_search_index_entry_new   (goffset                      size);
+void                         codeslayer_search_index_entry_free  (CodeSlayerSearchIndexEntry  *entry);
+void                         codeslayer_search_index_entry_add_text (CodeSlayerSearchIndexEntry *entry,
+                                                                     const gchar                *text,
+                                                                     gsize                       length);
+void                         codeslayer_search_index_entry_set_binary (CodeSlayerSearchIndexEntry *entry);
+CodeSlayerSearchIndexQuery*  codeslayer_search_index_query_new   (const gchar                 *literal,
+                                                                  gboolean                     match_case);
+CodeSlayerSearchIndexQuery*  codeslayer_search_index_query_new_for_terms (gchar              **terms,
+                                                                          gboolean             match_case);
+void                         codeslayer_search_index_query_free  (CodeSlayerSearchIndexQuery  *query);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_INDEX_H__ */
@@ -0,0 +1,803 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-matcher.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATCHER_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * The literal search used by the project search. The vector kernels
+ * compare the first and the last byte of the literal against a whole
+ * block of text at once and only call memcmp for the positions where
+ * both bytes line up, which skips almost all of a typical source file.
+ * The kernel is picked once from the CPU features, memchr is the
+ * fallback everywhere else.
+ *
+ * Ignoring case folds ASCII letters through a table while comparing, so
+ * nothing is copied. A literal with non-ASCII letters is matched one
+ * character at a time, but only on the lines that have non-ASCII bytes.
+ *
+ * A regular expression usually contains some text that every match
+ * has to include. Finding that text with the matcher first means the
+ * regular expression only runs on the few lines that could match.
+ */
+
+typedef enum
+{
+  KERNEL_MEMCHR = 0,
+  KERNEL_SSE2,
+  KERNEL_AVX2
+} Kernel;
+
+typedef gssize (*FindFunc) (const CodeSlayerSearchMatcher *matcher,
+                            const gchar                   *text,
+                            gsize                          length);
+
+struct _CodeSlayerSearchMatcher
+{
+  gchar    *literal;
+  gsize     literal_length;
+  gboolean  match_case;
+  gunichar *chars;
+  glong     n_chars;
+  FindFunc  find;
+};
+
+static Kernel get_kernel            (void);
+static CodeSlayerSearchMatcher* create_matcher (const gchar  *literal,
+                                                gboolean      match_case,
+                                                Kernel        kernel);
+static gboolean is_ascii            (const gchar                   *text,
+                                     gsize                          length);
+static gboolean equal_folded        (const gchar                   *text,
+                                     const gchar                   *literal,
+                                     gsize                          length);
+static gssize find_memchr           (const CodeSlayerSearchMatcher *matcher,
+                                     const gchar                   *text,
+                                     gsize                          length);
+static gssize find_folded           (const CodeSlayerSearchMatcher *matcher,
+                                     const gchar                   *text,
+                                     gsize                          length);
+static gssize find_utf8             (const CodeSlayerSearchMatcher *matcher,
+                                     const gchar                   *text,
+                                     gsize                          length);
+static gssize find_utf8_line        (const CodeSlayerSearchMatcher *matcher,
+                                     const gchar                   *line,
+                                     const gchar                   *line_end);
+static const gchar* skip_escape     (const gchar                   *pos);
+static const gchar* skip_class      (const gchar                   *pos);
+static const gchar* skip_group      (const gchar                   *pos);
+#ifdef MATCHER_X86
+static gssize find_sse2             (const CodeSlayerSearchMatcher *matcher,
+                                     const gchar                   *text,
+                                     gsize                          length);
+static gssize find_avx2             (const CodeSlayerSearchMatcher *matcher,
+                                     const gchar                   *text,
+                                     gsize                          length);
+#endif
+
+static const gchar *kernel_names[] = { "memchr", "sse2", "avx2" };
+
+static guchar fold_table[256];
+
+/**
+ * codeslayer_search_matcher_new:
+ * @literal: the text to find.
+ * @match_case: is FALSE to ignore the case of the text.
+ *
+ * Returns: a new #CodeSlayerSearchMatcher.
+ */
+CodeSlayerSearchMatcher*
+codeslayer_search_matcher_new (const gchar *literal, 
+                               gboolean     match_case)
+{
+  return create_matcher (literal, match_case, get_kernel ());
+}
+
+/**
+ * codeslayer_search_matcher_new_for_kernel:
+ * @literal: the text to find.
+ * @match_case: is FALSE to ignore the case of the text.
+ * @kernel_name: one of "memchr", "sse2" or "avx2".
+ *
+ * Uses the given kernel instead of the one picked for this CPU, so the
+ * kernels can be compared against each other.
+ *
+ * Returns: a new #CodeSlayerSearchMatcher, or %NULL if the CPU does not 
+ * have the kernel.
+ */
+CodeSlayerSearchMatcher*
+codeslayer_search_matcher_new_for_kernel (const gchar *literal, 
+                                          gboolean     match_case,
+                                          const gchar *kernel_name)
+{
+  Kernel best;
+  Kernel kernel;
+
+  best = get_kernel ();
+
+  for (kernel = KERNEL_MEMCHR; kernel <= best; kernel++)
+    {
+      if (g_strcmp0 (kernel_names[kernel], kernel_name) == 0)
+        return create_matcher (literal, match_case, kernel);
+    }
+
+  return NULL;
+}
+
+/**
+ * codeslayer_search_matcher_free:
+ * @matcher: a #CodeSlayerSearchMatcher.
+ */
+void
+codeslayer_search_matcher_free (CodeSlayerSearchMatcher *matcher)
+{
+  g_free (matcher->literal);
+  g_free (matcher->chars);
+  g_free (matcher);
+}
+
+/**
+ * codeslayer_search_matcher_find:
+ * @matcher: a #CodeSlayerSearchMatcher.
+ * @text: the text to search, does not need to be nul terminated.
+ * @length: the length of the text.
+ *
+ * Safe to call from several threads at once.
+ *
+ * Returns: the offset of the first match, or -1 if there is none.
+ */
+gssize
+codeslayer_search_matcher_find (CodeSlayerSearchMatcher *matcher,
+                                const gchar             *text,
+                                gsize                    length)
+{
+  if (matcher->literal_length == 0)
+    return -1;
+
+  if (matcher->chars != NULL)
+    return matcher->find (matcher, text, length);
+
+  if (matcher->literal_length > length)
+    return -1;
+
+  if (matcher->literal_length == 1)
+    {
+      const gchar *pos;
+
+      if (!matcher->match_case)
+        return find_folded (matcher, text, length);
+
+      pos = memchr (text, matcher->literal[0], length);
+      return pos != NULL ? pos - text : -1;
+    }
+
+  return matcher->find (matcher, text, length);
+}
+
+/**
+ * codeslayer_search_matcher_get_length:
+ * @matcher: a #CodeSlayerSearchMatcher.
+ * @match: where codeslayer_search_matcher_find() found the text.
+ * @length: the length of the text from the match on.
+ *
+ * Ignoring the case of non-ASCII text can match a different number of
+ * bytes than the literal has, so the match is measured by character.
+ *
+ * Returns: the number of bytes of the match.
+ */
+gsize
+codeslayer_search_matcher_get_length (CodeSlayerSearchMatcher *matcher,
+                                      const gchar             *match,
+                                      gsize                    length)
+{
+  const gchar *pos = match;
+  const gchar *end = match + length;
+  glong i;
+
+  if (matcher->chars == NULL)
+    return MIN (matcher->literal_length, length);
+
+  for (i = 0; i < matcher->n_chars && pos < end; i++)
+    pos = g_utf8_next_char (pos);
+
+  return MIN (pos, end) - match;
+}
+
+/**
+ * codeslayer_search_matcher_is_literal:
+ * @entry: the text the user entered.
+ *
+ * Returns: is TRUE if the entry has no globbing wildcards.
+ */
+gboolean
+codeslayer_search_matcher_is_literal (const gchar *entry)
+{
+  return strpbrk (entry, "*?") == NULL;
+}
+
+/**
+ * codeslayer_search_matcher_fold:
+ * @text: the text to lower case in place.
+ * @length: the length of the text.
+ *
+ * Lower cases the ASCII letters the same way codeslayer_utils_to_lowercase()
+ * does, without making a copy.
+ */
+void
+codeslayer_search_matcher_fold (gchar *text,
+                                gsize  length)
+{
+  gsize i;
+
+  get_kernel ();
+
+  for (i = 0; i < length; i++)
+    text[i] = fold_table[(guchar) text[i]];
+}
+
+/**
+ * codeslayer_search_matcher_get_kernel:
+ *
+ * Returns: the name of the kernel picked for this CPU.
+ */
+const gchar*
+codeslayer_search_matcher_get_kernel (void)
+{
+  return kernel_names[get_kernel ()];
+}
+
+/**
+ * codeslayer_search_matcher_get_regex_literal:
+ * @pattern: a regular expression.
+ *
+ * Finds the longest run of plain text that every match of the pattern
+ * must contain. Anything the pattern does not require for certain, like
+ * groups, alternatives and optional characters, is left out.
+ *
+ * Returns: the text, or %NULL if there is none. Free with g_free().
+ */
+gchar*
+codeslayer_search_matcher_get_regex_literal (const gchar *pattern)
+{
+  GString *run;
+  GString *longest;
+  gboolean last_in_run = FALSE;
+  const gchar *pos = pattern;
+  gchar *result = NULL;
+
+  /* inline options could turn on caseless matching */
+  if (strstr (pattern, "(?") != NULL)
+    return NULL;
+
+  run = g_string_new (NULL);
+  longest = g_string_new (NULL);
+
+  while (*pos != '\0')
+    {
+      gchar c = *pos;
+
+      /* with alternatives nothing is certain */
+      if (c == '|' || c == ')')
+        {
+          g_string_truncate (longest, 0);
+          g_string_truncate (run, 0);
+          break;
+        }
+
+      if (c == '\\' && pos[1] != '\0' && !g_ascii_isalnum (pos[1]))
+        {
+          g_string_append_c (run, pos[1]);
+          last_in_run = TRUE;
+          pos += 2;
+          continue;
+        }
+
+      if (c == '\\')
+        {
+          pos = pos[1] != '\0' ? skip_escape (pos + 1) : pos + 1;
+        }
+      else if (c == '*' || c == '?' || c == '+' 
+               || (c == '{' && (g_ascii_isdigit (pos[1]) || pos[1] == ',')))
+        {
+          gboolean optional = c == '*' || c == '?' || pos[1] == '0' || pos[1] == ',';
+
+          /* the last character may not be there at all */
+          if (last_in_run && optional)
+            g_string_truncate (run, run->len - 1);
+
+          /* a repeated byte of a longer character is not plain text */
+          while (last_in_run && run->len > 0 && (guchar) run->str[run->len - 1] >= 0x80)
+            g_string_truncate (run, run->len - 1);
+
+          if (c == '{')
+            {
+              const gchar *end = strchr (pos, '}');
+              pos = end != NULL ? end + 1 : pos + strlen (pos);
+            }
+          else
+            {
+              pos++;
+            }
+        }
+      else if (c == '[')
+        {
+          pos = skip_class (pos + 1);
+        }
+      else if (c == '(')
+        {
+          pos = skip_group (pos + 1);
+        }
+      else if (c == '.' || c == '^' || c == '$')
+        {
+          pos++;
+        }
+      else
+        {
+          g_string_append_c (run, c);
+          last_in_run = TRUE;
+          pos++;
+          continue;
+        }
+
+      if (run->len > longest->len)
+        g_string_assign (longest, run->str);
+      g_string_truncate (run, 0);
+      last_in_run = FALSE;
+    }
+
+  if (run->len > longest->len)
+    g_string_assign (longest, run->str);
+
+  if (longest->len > 0)
+    result = g_strdup (longest->str);
+
+  g_string_free (run, TRUE);
+  g_string_free (longest, TRUE);
+
+  return result;
+}
+
+static CodeSlayerSearchMatcher*
+create_matcher (const gchar *literal,
+                gboolean     match_case,
+                Kernel       kernel)
+{
+  CodeSlayerSearchMatcher *matcher;
+
+  matcher = g_malloc (sizeof (CodeSlayerSearchMatcher));
+  matcher->literal = g_strdup (literal);
+  matcher->literal_length = strlen (literal);
+  matcher->match_case = match_case;
+  matcher->chars = NULL;
+  matcher->n_chars = 0;
+
+  if (!match_case)
+    codeslayer_search_matcher_fold (matcher->literal, matcher->literal_length);
+
+  if (!match_case && !is_ascii (matcher->literal, matcher->literal_length))
+    {
+      glong i;
+
+      /* only lines with non-ASCII text can match, compare them by character */
+      matcher->chars = g_utf8_to_ucs4_fast (matcher->literal, -1, &matcher->n_chars);
+      for (i = 0; i < matcher->n_chars; i++)
+        matcher->chars[i] = g_unichar_tolower (matcher->chars[i]);
+      matcher->find = find_utf8;
+    }
+#ifdef MATCHER_X86
+  else if (kernel == KERNEL_AVX2)
+    {
+      matcher->find = find_avx2;
+    }
+  else if (kernel == KERNEL_SSE2)
+    {
+      matcher->find = find_sse2;
+    }
+#endif
+  else
+    {
+      matcher->find = match_case ? find_memchr : find_folded;
+    }
+
+  return matcher;
+}
+
+static Kernel
+get_kernel (void)
+{
+  static gsize kernel = 0;
+
+  if (g_once_init_enter (&kernel))
+    {
+      Kernel result = KERNEL_MEMCHR;
+      gint i;
+
+      for (i = 0; i < 256; i++)
+        fold_table[i] = g_ascii_tolower (i);
+
+#ifdef MATCHER_X86
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("avx2"))
+        result = KERNEL_AVX2;
+      else if (__builtin_cpu_supports ("sse2"))
+        result = KERNEL_SSE2;
+#endif
+
+      /* offset by one since g_once_init_leave does not take zero */
+      g_once_init_leave (&kernel, result + 1);
+    }
+
+  return (Kernel) (kernel - 1);
+}
+
+static gboolean
+is_ascii (const gchar *text,
+          gsize        length)
+{
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    if ((guchar) text[i] >= 0x80)
+      return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+equal_folded (const gchar *text,
+              const gchar *literal,
+              gsize        length)
+{
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    if (fold_table[(guchar) text[i]] != (guchar) literal[i])
+      return FALSE;
+
+  return TRUE;
+}
+
+static gssize
+find_memchr (const CodeSlayerSearchMatcher *matcher,
+             const gchar                   *text,
+             gsize                          length)
+{
+  const gchar *literal = matcher->literal;
+  gsize literal_length = matcher->literal_length;
+  const gchar *pos = text;
+  const gchar *last = text + length - literal_length;
+  gchar last_char = literal[literal_length - 1];
+
+  while (pos <= last)
+    {
+      pos = memchr (pos, literal[0], last - pos + 1);
+      if (pos == NULL)
+        return -1;
+      if (pos[literal_length - 1] == last_char
+          && memcmp (pos + 1, literal + 1, literal_length - 2) == 0)
+        return pos - text;
+      pos++;
+    }
+
+  return -1;
+}
+
+static gssize
+find_folded (const CodeSlayerSearchMatcher *matcher,
+             const gchar                   *text,
+             gsize                          length)
+{
+  const guchar *literal = (const guchar*) matcher->literal;
+  gsize literal_length = matcher->literal_length;
+  gsize last = length - literal_length;
+  gsize i;
+
+  for (i = 0; i <= last; i++)
+    {
+      if (fold_table[(guchar) text[i]] == literal[0]
+          && fold_table[(guchar) text[i + literal_length - 1]] == literal[literal_length - 1]
+          && equal_folded (text + i, matcher->literal, literal_length))
+        return i;
+    }
+
+  return -1;
+}
+
+static gssize
+find_utf8 (const CodeSlayerSearchMatcher *matcher,
+           const gchar                   *text,
+           gsize                          length)
+{
+  const gchar *end = text + length;
+  const gchar *line = text;
+
+  while (line < end)
+    {
+      const gchar *line_end;
+
+      line_end = memchr (line, '\n', end - line);
+      if (line_end == NULL)
+        line_end = end;
+
+      if (!is_ascii (line, line_end - line))
+        {
+          gssize offset;
+          offset = find_utf8_line (matcher, line, line_end);
+          if (offset >= 0)
+            return line - text + offset;
+        }
+
+      line = line_end + 1;
+    }
+
+  return -1;
+}
+
+static gssize
+find_utf8_line (const CodeSlayerSearchMatcher *matcher,
+                const gchar                   *line,
+                const gchar                   *line_end)
+{
+  const gchar *start = line;
+
+  while (start < line_end)
+    {
+      const gchar *pos = start;
+      gunichar c;
+      glong i;
+
+      for (i = 0; i < matcher->n_chars; i++)
+        {
+          if (pos >= line_end)
+            break;
+
+          c = g_utf8_get_char_validated (pos, line_end - pos);
+          if (c == (gunichar) -1 || c == (gunichar) -2)
+            break;
+
+          if (g_unichar_tolower (c) != matcher->chars[i])
+            break;
+
+          pos = g_utf8_next_char (pos);
+        }
+
+      if (i == matcher->n_chars)
+        return start - line;
+
+      c = g_utf8_get_char_validated (start, line_end - start);
+      if (c == (gunichar) -1 || c == (gunichar) -2)
+        start++;
+      else
+        start = g_utf8_next_char (start);
+    }
+
+  return -1;
+}
+
+/*
+ * Skips an escape like \d, \x41 or \p{Lu}. The escape may take
+ * arguments, so when in doubt skip more, it only makes the literal
+ * shorter.
+ */
+static const gchar*
+skip_escape (const gchar *pos)
+{
+  gchar c = *pos++;
+
+  if (strchr ("xcpPgkoNu0123456789", c) == NULL)
+    return pos;
+
+  if (c == 'c' && *pos != '\0')
+    return pos + 1;
+
+  if (*pos == '{' || *pos == '<' || *pos == '\'')
+    {
+      gchar close = *pos == '{' ? '}' : *pos == '<' ? '>' : '\'';
+      const gchar *end = strchr (pos + 1, close);
+      return end != NULL ? end + 1 : pos + strlen (pos);
+    }
+
+  while (g_ascii_isalnum (*pos))
+    pos++;
+
+  return pos;
+}
+
+static const gchar*
+skip_class (const gchar *pos)
+{
+  if (*pos == '^')
+    pos++;
+  if (*pos == ']')
+    pos++;
+
+  while (*pos != '\0' && *pos != ']')
+    {
+      if (*pos == '\\' && pos[1] != '\0')
+        pos++;
+      else if (*pos == '[' && pos[1] == ':')
+        {
+          const gchar *end = strstr (pos + 2, ":]");
+          if (end != NULL)
+            pos = end + 1;
+        }
+      pos++;
+    }
+
+  return *pos == ']' ? pos + 1 : pos;
+}
+
+static const gchar*
+skip_group (const gchar *pos)
+{
+  gint depth = 1;
+
+  while (*pos != '\0')
+    {
+      if (*pos == '\\' && pos[1] != '\0')
+        {
+          pos += 2;
+          continue;
+        }
+      if (*pos == '[')
+        {
+          pos = skip_class (pos + 1);
+          continue;
+        }
+      if (*pos == '(')
+        depth++;
+      else if (*pos == ')' && --depth == 0)
+        return pos + 1;
+      pos++;
+    }
+
+  return pos;
+}
+
+#ifdef MATCHER_X86
+
+/*
+ * When the case is ignored the first and last bytes are compared against
+ * both their lower and upper case forms. The literal is already folded.
+ */
+
+__attribute__((target ("sse2")))
+static gssize
+find_sse2 (const CodeSlayerSearchMatcher *matcher,
+           const gchar                   *text,
+           gsize                          length)
+{
+  const gchar *literal = matcher->literal;
+  gsize literal_length = matcher->literal_length;
+  gboolean match_case = matcher->match_case;
+  gchar first_char = literal[0];
+  gchar last_char = literal[literal_length - 1];
+  __m128i first_lower = _mm_set1_epi8 (first_char);
+  __m128i first_upper = _mm_set1_epi8 (match_case ? first_char : g_ascii_toupper (first_char));
+  __m128i last_lower = _mm_set1_epi8 (last_char);
+  __m128i last_upper = _mm_set1_epi8 (match_case ? last_char : g_ascii_toupper (last_char));
+  gsize i = 0;
+
+  for (; i + 16 + literal_length - 1 <= length; i += 16)
+    {
+      __m128i block_first;
+      __m128i block_last;
+      __m128i first;
+      __m128i last;
+      guint mask;
+
+      block_first = _mm_loadu_si128 ((const __m128i*) (text + i));
+      block_last = _mm_loadu_si128 ((const __m128i*) (text + i + literal_length - 1));
+      first = _mm_or_si128 (_mm_cmpeq_epi8 (block_first, first_lower),
+                            _mm_cmpeq_epi8 (block_first, first_upper));
+      last = _mm_or_si128 (_mm_cmpeq_epi8 (block_last, last_lower),
+                           _mm_cmpeq_epi8 (block_last, last_upper));
+      mask = _mm_movemask_epi8 (_mm_and_si128 (first, last));
+
+      while (mask != 0)
+        {
+          guint bit = __builtin_ctz (mask);
+          const gchar *pos = text + i + bit;
+
+          if (match_case ? memcmp (pos + 1, literal + 1, literal_length - 2) == 0
+                         : equal_folded (pos + 1, literal + 1, literal_length - 2))
+            return i + bit;
+
+          mask &= mask - 1;
+        }
+    }
+
+  if (length - i >= literal_length)
+    {
+      gssize offset;
+
+      if (match_case)
+        offset = find_memchr (matcher, text + i, length - i);
+      else
+        offset = find_folded (matcher, text + i, length - i);
+
+      if (offset >= 0)
+        return i + offset;
+    }
+
+  return -1;
+}
+
+__attribute__((target ("avx2")))
+static gssize
+find_avx2 (const CodeSlayerSearchMatcher *matcher,
+           const gchar                   *text,
+           gsize                          length)
+{
+  const gchar *literal = matcher->literal;
+  gsize literal_length = matcher->literal_length;
+  gboolean match_case = matcher->match_case;
+  gchar first_char = literal[0];
+  gchar last_char = literal[literal_length - 1];
+  __m256i first_lower = _mm256_set1_epi8 (first_char);
+  __m256i first_upper = _mm256_set1_epi8 (match_case ? first_char : g_ascii_toupper (first_char));
+  __m256i last_lower = _mm256_set1_epi8 (last_char);
+  __m256i last_upper = _mm256_set1_epi8 (match_case ? last_char : g_ascii_toupper (last_char));
+  gsize i = 0;
+
+  for (; i + 32 + literal_length - 1 <= length; i += 32)
+    {
+      __m256i block_first;
+      __m256i block_last;
+      __m256i first;
+      __m256i last;
+      guint mask;
+
+      block_first = _mm256_loadu_si256 ((const __m256i*) (text + i));
+      block_last = _mm256_loadu_si256 ((const __m256i*) (text + i + literal_length - 1));
+      first = _mm256_or_si256 (_mm256_cmpeq_epi8 (block_first, first_lower),
+                               _mm256_cmpeq_epi8 (block_first, first_upper));
+      last = _mm256_or_si256 (_mm256_cmpeq_epi8 (block_last, last_lower),
+                              _mm256_cmpeq_epi8 (block_last, last_upper));
+      mask = (guint) _mm256_movemask_epi8 (_mm256_and_si256 (first, last));
+
+      while (mask != 0)
+        {
+          guint bit = __builtin_ctz (mask);
+          const gchar *pos = text + i + bit;
+
+          if (match_case ? memcmp (pos + 1, literal + 1, literal_length - 2) == 0
+                         : equal_folded (pos + 1, literal + 1, literal_length - 2))
+            return i + bit;
+
+          mask &= mask - 1;
+        }
+    }
+
+  if (length - i >= literal_length)
+    {
+      gssize offset;
+      offset = find_sse2 (matcher, text + i, length - i);
+      if (offset >= 0)
+        return i + offset;
+    }
+
+  return -1;
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_MATCHER_H__
+#define	__CODESLAYER_SEARCH_MATCHER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchMatcher CodeSlayerSearchMatcher;
+
+CodeSlayerSearchMatcher*  codeslayer_search_matcher_new          (const gchar             *literal,
+                                                                  gboolean                 match_case);
+CodeSlayerSearchMatcher*  codeslayer_search_matcher_new_for_kernel (const gchar           *literal,
+                                                                  gboolean                 match_case,
+                                                                  const gchar             *kernel_name);
+void                      codeslayer_search_matcher_free         (CodeSlayerSearchMatcher *matcher);
+gssize                    codeslayer_search_matcher_find         (CodeSlayerSearchMatcher *matcher,
+                                                                  const gchar             *text,
+                                                                  gsize                    length);
+gsize                     codeslayer_search_matcher_get_length   (CodeSlayerSearchMatcher *matcher,
+                                                                  const gchar             *match,
+                                                                  gsize                    length);
+gboolean                  codeslayer_search_matcher_is_literal   (const gchar             *entry);
+gchar*                    codeslayer_search_matcher_get_regex_literal (const gchar        *pattern);
+void                      codeslayer_search_matcher_fold         (gchar                   *text,
+                                                                  gsize                    length);
+const gchar*              codeslayer_search_matcher_get_kernel   (void);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_MATCHER_H__ */
@@ -0,0 +1,765 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-model.h>
+
+/**
+ * SECTION:codeslayer-search-model
+ * @short_description: The results of the global search.
+ * @title: CodeSlayerSearchModel
+ * @include: codeslayer/codeslayer-search-model.h
+ *
+ * A tree model over the hits of the global search, with the projects on 
+ * top, their files below them and the hits of each file below those. The 
+ * hits are kept in one array per file and their text in one string chunk, 
+ * so a million hits do not need a million tree nodes. The text of a row 
+ * is only put together when the view asks for it, and the view only asks 
+ * for the rows it shows.
+ */
+
+static void codeslayer_search_model_class_init      (CodeSlayerSearchModelClass *klass);
+static void codeslayer_search_model_init            (CodeSlayerSearchModel      *model);
+static void codeslayer_search_model_finalize        (CodeSlayerSearchModel      *model);
+static void codeslayer_search_model_tree_model_init (GtkTreeModelIface          *iface);
+
+static GtkTreeModelFlags get_flags                  (GtkTreeModel               *tree_model);
+static gint get_n_columns                           (GtkTreeModel               *tree_model);
+static GType get_column_type                        (GtkTreeModel               *tree_model,
+                                                     gint                        column);
+static gboolean get_iter                            (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter,
+                                                     GtkTreePath                *path);
+static GtkTreePath* get_path                        (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter);
+static void get_value                               (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter,
+                                                     gint                        column,
+                                                     GValue                     *value);
+static gboolean iter_next                           (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter);
+static gboolean iter_children                       (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter,
+                                                     GtkTreeIter                *parent);
+static gboolean iter_has_child                      (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter);
+static gint iter_n_children                         (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter);
+static gboolean iter_nth_child                      (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter,
+                                                     GtkTreeIter                *parent,
+                                                     gint                        n);
+static gboolean iter_parent                         (GtkTreeModel               *tree_model,
+                                                     GtkTreeIter                *iter,
+                                                     GtkTreeIter                *child);
+
+#define CODESLAYER_SEARCH_MODEL_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), CODESLAYER_SEARCH_MODEL_TYPE, CodeSlayerSearchModelPrivate))
+
+typedef struct _CodeSlayerSearchModelPrivate CodeSlayerSearchModelPrivate;
+
+struct _CodeSlayerSearchModelPrivate
+{
+  GPtrArray    *projects;
+  GStringChunk *text_chunk;
+  gint          stamp;
+};
+
+enum
+{
+  LEVEL_PROJECT = 0,
+  LEVEL_FILE,
+  LEVEL_RESULT
+};
+
+/*
+ * The projects and files both start with a node, so one sort does 
+ * either level.
+ */
+typedef struct
+{
+  gint         index;
+  const gchar *text;
+} ModelNode;
+
+typedef struct
+{
+  ModelNode          node;
+  CodeSlayerProject *project;
+  GPtrArray         *files;
+} ModelProject;
+
+typedef struct
+{
+  ModelNode     node;
+  ModelProject *parent;
+  const gchar  *file_path;
+  gboolean      has_results;
+  GArray       *results;
+} ModelFile;
+
+typedef struct
+{
+  gint         line_number;
+  gint         match_offset;
+  gint         match_length;
+  goffset      line_offset;
+  const gchar *text;
+  const gchar *terms;
+} ModelResult;
+
+static void free_projects         (GPtrArray             *projects);
+static void set_iter              (CodeSlayerSearchModel *model,
+                                   GtkTreeIter           *iter,
+                                   gpointer               node,
+                                   gint                   level,
+                                   gint                   index);
+static void sort_nodes            (CodeSlayerSearchModel *model,
+                                   GPtrArray             *nodes,
+                                   GtkTreeIter           *parent);
+static gint compare_nodes         (ModelNode            **node1,
+                                   ModelNode            **node2);
+
+#define ITER_LEVEL(iter) (GPOINTER_TO_INT ((iter)->user_data2))
+#define ITER_INDEX(iter) (GPOINTER_TO_INT ((iter)->user_data3))
+
+G_DEFINE_TYPE_WITH_CODE (CodeSlayerSearchModel, codeslayer_search_model, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL, 
+                                                codeslayer_search_model_tree_model_init))
+
+static void
+codeslayer_search_model_class_init (CodeSlayerSearchModelClass *klass)
+{
+  G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) codeslayer_search_model_finalize;
+  g_type_class_add_private (klass, sizeof (CodeSlayerSearchModelPrivate));
+}
+
+static void
+codeslayer_search_model_tree_model_init (GtkTreeModelIface *iface)
+{
+  iface->get_flags = get_flags;
+  iface->get_n_columns = get_n_columns;
+  iface->get_column_type = get_column_type;
+  iface->get_iter = get_iter;
+  iface->get_path = get_path;
+  iface->get_value = get_value;
+  iface->iter_next = iter_next;
+  iface->iter_children = iter_children;
+  iface->iter_has_child = iter_has_child;
+  iface->iter_n_children = iter_n_children;
+  iface->iter_nth_child = iter_nth_child;
+  iface->iter_parent = iter_parent;
+}
+
+static void
+codeslayer_search_model_init (CodeSlayerSearchModel *model)
+{
+  CodeSlayerSearchModelPrivate *priv;
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+  priv->projects = g_ptr_array_new ();
+  priv->text_chunk = g_string_chunk_new (64 * 1024);
+  priv->stamp = g_random_int ();
+}
+
+static void
+codeslayer_search_model_finalize (CodeSlayerSearchModel *model)
+{
+  CodeSlayerSearchModelPrivate *priv;
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+  free_projects (priv->projects);
+  g_string_chunk_free (priv->text_chunk);
+  G_OBJECT_CLASS (codeslayer_search_model_parent_class)->finalize (G_OBJECT (model));
+}
+
+/**
+ * codeslayer_search_model_new:
+ *
+ * Creates a new #CodeSlayerSearchModel.
+ *
+ * Returns: a new #CodeSlayerSearchModel. 
+ */
+CodeSlayerSearchModel*
+codeslayer_search_model_new (void)
+{
+  return CODESLAYER_SEARCH_MODEL (g_object_new (codeslayer_search_model_get_type (), NULL));
+}
+
+/**
+ * codeslayer_search_model_clear:
+ * @model: a #CodeSlayerSearchModel.
+ *
+ * Removes all of the rows.
+ */
+void
+codeslayer_search_model_clear (CodeSlayerSearchModel *model)
+{
+  CodeSlayerSearchModelPrivate *priv;
+  GPtrArray *projects;
+
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+
+  /* the rows go from the end, so the paths of the others stay the same */
+  projects = g_ptr_array_new ();
+  while (priv->projects->len > 0)
+    {
+      GtkTreePath *path;
+      guint index;
+
+      index = priv->projects->len - 1;
+      g_ptr_array_add (projects, g_ptr_array_index (priv->projects, index));
+      g_ptr_array_remove_index (priv->projects, index);
+
+      path = gtk_tree_path_new_from_indices (index, -1);
+      gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+      gtk_tree_path_free (path);
+    }
+
+  /* the view may still let go of rows, that now belong to no model */
+  priv->stamp++;
+  free_projects (projects);
+  g_string_chunk_clear (priv->text_chunk);
+}
+
+/**
+ * codeslayer_search_model_append_project:
+ * @model: a #CodeSlayerSearchModel.
+ * @project: the #CodeSlayerProject of the row.
+ * @iter: (out): set to the new row.
+ */
+void
+codeslayer_search_model_append_project (CodeSlayerSearchModel *model,
+                                        CodeSlayerProject     *project,
+                                        GtkTreeIter           *iter)
+{
+  CodeSlayerSearchModelPrivate *priv;
+  ModelProject *model_project;
+  GtkTreePath *path;
+
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+
+  model_project = g_malloc (sizeof (ModelProject));
+  model_project->node.index = priv->projects->len;
+  model_project->node.text = g_string_chunk_insert (priv->text_chunk, 
+                                                    codeslayer_project_get_name (project));
+  model_project->project = project;
+  model_project->files = g_ptr_array_new ();
+  g_ptr_array_add (priv->projects, model_project);
+
+  set_iter (model, iter, model_project, LEVEL_PROJECT, 0);
+  path = gtk_tree_path_new_from_indices (model_project->node.index, -1);
+  gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, iter);
+  gtk_tree_path_free (path);
+}
+
+/**
+ * codeslayer_search_model_append_file:
+ * @model: a #CodeSlayerSearchModel.
+ * @project_iter: the project row to add the file to.
+ * @file_path: the file of the row.
+ * @text: the text to show for the file.
+ * @has_results: is FALSE if the file itself was found, which opens the 
+ *               file when the row is activated.
+ * @iter: (out): set to the new row.
+ */
+void
+codeslayer_search_model_append_file (CodeSlayerSearchModel *model,
+                                     GtkTreeIter           *project_iter,
+                                     const gchar           *file_path,
+                                     const gchar           *text,
+                                     gboolean               has_results,
+                                     GtkTreeIter           *iter)
+{
+  CodeSlayerSearchModelPrivate *priv;
+  ModelProject *model_project;
+  ModelFile *model_file;
+  GtkTreePath *path;
+
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+  g_return_if_fail (project_iter->stamp == priv->stamp);
+
+  model_project = project_iter->user_data;
+
+  model_file = g_malloc (sizeof (ModelFile));
+  model_file->node.index = model_project->files->len;
+  model_file->node.text = g_string_chunk_insert (priv->text_chunk, text);
+  model_file->parent = model_project;
+  model_file->file_path = g_string_chunk_insert (priv->text_chunk, file_path);
+  model_file->has_results = has_results;
+  model_file->results = g_array_new (FALSE, FALSE, sizeof (ModelResult));
+  g_ptr_array_add (model_project->files, model_file);
+
+  set_iter (model, iter, model_file, LEVEL_FILE, 0);
+  path = gtk_tree_path_new_from_indices (model_project->node.index, 
+                                         model_file->node.index, -1);
+  gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, iter);
+  if (model_project->files->len == 1)
+    {
+      gtk_tree_path_up (path);
+      gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model), path, project_iter);
+    }
+  gtk_tree_path_free (path);
+}
+
+/**
+ * codeslayer_search_model_append_result:
+ * @model: a #CodeSlayerSearchModel.
+ * @file_iter: the file row to add the hit to.
+ * @line_number: the line of the hit.
+ * @line_offset: the byte offset of the line into the file.
+ * @match_offset: the byte offset of the match into the line.
+ * @match_length: the number of bytes of the match.
+ * @text: the text of the line.
+ * @terms: the terms found on the line, or %NULL.
+ *
+ * The hits of a file are kept in line order.
+ */
+void
+codeslayer_search_model_append_result (CodeSlayerSearchModel *model,
+                                       GtkTreeIter           *file_iter,
+                                       gint                   line_number,
+                                       goffset                line_offset,
+                                       gint                   match_offset,
+                                       gint                   match_length,
+                                       const gchar           *text,
+                                       const gchar           *terms)
+{
+  CodeSlayerSearchModelPrivate *priv;
+  ModelFile *model_file;
+  ModelResult result;
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  guint index;
+
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+  g_return_if_fail (file_iter->stamp == priv->stamp);
+
+  model_file = file_iter->user_data;
+
+  result.line_number = line_number;
+  result.line_offset = line_offset;
+  result.match_offset = match_offset;
+  result.match_length = match_length;
+  result.text = g_string_chunk_insert (priv->text_chunk, text);
+  result.terms = terms != NULL ? g_string_chunk_insert (priv->text_chunk, terms) : NULL;
+
+  /* the hits come in line order, anything else finds its place by line */
+  index = model_file->results->len;
+  if (index > 0 && g_array_index (model_file->results, ModelResult, index - 1).line_number > line_number)
+    {
+      guint low = 0;
+      while (low < index)
+        {
+          guint middle = (low + index) / 2;
+          if (g_array_index (model_file->results, ModelResult, middle).line_number > line_number)
+            index = middle;
+          else
+            low = middle + 1;
+        }
+    }
+  g_array_insert_val (model_file->results, index, result);
+
+  /* a file that is not expanded has no rows in the view to update */
+  set_iter (model, &iter, model_file, LEVEL_RESULT, index);
+  path = gtk_tree_path_new_from_indices (model_file->parent->node.index, 
+                                         model_file->node.index, index, -1);
+  gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+  if (model_file->results->len == 1)
+    {
+      gtk_tree_path_up (path);
+      gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model), path, file_iter);
+    }
+  gtk_tree_path_free (path);
+}
+
+/**
+ * codeslayer_search_model_sort:
+ * @model: a #CodeSlayerSearchModel.
+ *
+ * Puts the projects and the files of every project in order by their 
+ * text. The rows are added in the order the search finds them, which 
+ * is sorted once when the search is done.
+ */
+void
+codeslayer_search_model_sort (CodeSlayerSearchModel *model)
+{
+  CodeSlayerSearchModelPrivate *priv;
+  guint i;
+
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+
+  sort_nodes (model, priv->projects, NULL);
+
+  for (i = 0; i < priv->projects->len; i++)
+    {
+      ModelProject *model_project;
+      GtkTreeIter iter;
+
+      model_project = g_ptr_array_index (priv->projects, i);
+      set_iter (model, &iter, model_project, LEVEL_PROJECT, 0);
+      sort_nodes (model, model_project->files, &iter);
+    }
+}
+
+static void
+sort_nodes (CodeSlayerSearchModel *model,
+            GPtrArray             *nodes,
+            GtkTreeIter           *parent)
+{
+  GtkTreePath *path;
+  gint *new_order;
+  gboolean sorted = TRUE;
+  guint i;
+
+  for (i = 1; i < nodes->len && sorted; i++)
+    sorted = compare_nodes ((ModelNode**) &nodes->pdata[i - 1], 
+                            (ModelNode**) &nodes->pdata[i]) < 0;
+
+  if (sorted)
+    return;
+
+  g_ptr_array_sort (nodes, (GCompareFunc) compare_nodes);
+
+  new_order = g_malloc (nodes->len * sizeof (gint));
+  for (i = 0; i < nodes->len; i++)
+    {
+      ModelNode *node = g_ptr_array_index (nodes, i);
+      new_order[i] = node->index;
+      node->index = i;
+    }
+
+  if (parent != NULL)
+    path = get_path (GTK_TREE_MODEL (model), parent);
+  else
+    path = gtk_tree_path_new ();
+
+  gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path, parent, new_order);
+
+  gtk_tree_path_free (path);
+  g_free (new_order);
+}
+
+/*
+ * Rows with the same text stay in the order they were added.
+ */
+static gint
+compare_nodes (ModelNode **node1,
+               ModelNode **node2)
+{
+  gint result;
+
+  result = strcmp ((*node1)->text, (*node2)->text);
+  if (result == 0)
+    result = (*node1)->index - (*node2)->index;
+
+  return result;
+}
+
+static void
+free_projects (GPtrArray *projects)
+{
+  guint i, j;
+
+  for (i = 0; i < projects->len; i++)
+    {
+      ModelProject *model_project = g_ptr_array_index (projects, i);
+
+      for (j = 0; j < model_project->files->len; j++)
+        {
+          ModelFile *model_file = g_ptr_array_index (model_project->files, j);
+          g_array_free (model_file->results, TRUE);
+          g_free (model_file);
+        }
+
+      g_ptr_array_free (model_project->files, TRUE);
+      g_free (model_project);
+    }
+
+  g_ptr_array_free (projects, TRUE);
+}
+
+static void
+set_iter (CodeSlayerSearchModel *model,
+          GtkTreeIter           *iter,
+          gpointer               node,
+          gint                   level,
+          gint                   index)
+{
+  iter->stamp = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model)->stamp;
+  iter->user_data = node;
+  iter->user_data2 = GINT_TO_POINTER (level);
+  iter->user_data3 = GINT_TO_POINTER (index);
+}
+
+/*
+ * The project and file rows keep their iters, a hit that has to go in 
+ * before the last one moves the hits after it.
+ */
+static GtkTreeModelFlags
+get_flags (GtkTreeModel *tree_model)
+{
+  return 0;
+}
+
+static gint
+get_n_columns (GtkTreeModel *tree_model)
+{
+  return CODESLAYER_SEARCH_MODEL_COLUMNS;
+}
+
+static GType
+get_column_type (GtkTreeModel *tree_model,
+                 gint          column)
+{
+  switch (column)
+    {
+    case CODESLAYER_SEARCH_MODEL_FILE_PATH:
+    case CODESLAYER_SEARCH_MODEL_TEXT:
+      return G_TYPE_STRING;
+    case CODESLAYER_SEARCH_MODEL_PROJECT:
+      return G_TYPE_POINTER;
+    case CODESLAYER_SEARCH_MODEL_LINE_OFFSET:
+      return G_TYPE_INT64;
+    default:
+      return G_TYPE_INT;
+    }
+}
+
+static gboolean
+get_iter (GtkTreeModel *tree_model,
+          GtkTreeIter  *iter,
+          GtkTreePath  *path)
+{
+  GtkTreeIter parent;
+  gint *indices;
+  gint depth;
+  gint i;
+
+  indices = gtk_tree_path_get_indices (path);
+  depth = gtk_tree_path_get_depth (path);
+
+  for (i = 0; i < depth; i++)
+    {
+      if (!iter_nth_child (tree_model, iter, i == 0 ? NULL : &parent, indices[i]))
+        return FALSE;
+      parent = *iter;
+    }
+
+  return depth > 0;
+}
+
+static GtkTreePath*
+get_path (GtkTreeModel *tree_model,
+          GtkTreeIter  *iter)
+{
+  ModelProject *model_project;
+  ModelFile *model_file;
+
+  g_return_val_if_fail (iter->stamp == CODESLAYER_SEARCH_MODEL_GET_PRIVATE (tree_model)->stamp, NULL);
+
+  switch (ITER_LEVEL (iter))
+    {
+    case LEVEL_PROJECT:
+      model_project = iter->user_data;
+      return gtk_tree_path_new_from_indices (model_project->node.index, -1);
+    case LEVEL_FILE:
+      model_file = iter->user_data;
+      return gtk_tree_path_new_from_indices (model_file->parent->node.index, 
+                                             model_file->node.index, -1);
+    default:
+      model_file = iter->user_data;
+      return gtk_tree_path_new_from_indices (model_file->parent->node.index, 
+                                             model_file->node.index, 
+                                             ITER_INDEX (iter), -1);
+    }
+}
+
+static void
+get_value (GtkTreeModel *tree_model,
+           GtkTreeIter  *iter,
+           gint          column,
+           GValue       *value)
+{
+  ModelProject *model_project = NULL;
+  ModelFile *model_file = NULL;
+  ModelResult *result = NULL;
+
+  g_return_if_fail (iter->stamp == CODESLAYER_SEARCH_MODEL_GET_PRIVATE (tree_model)->stamp);
+
+  g_value_init (value, get_column_type (tree_model, column));
+
+  switch (ITER_LEVEL (iter))
+    {
+    case LEVEL_PROJECT:
+      model_project = iter->user_data;
+      break;
+    case LEVEL_FILE:
+      model_file = iter->user_data;
+      model_project = model_file->parent;
+      break;
+    default:
+      model_file = iter->user_data;
+      model_project = model_file->parent;
+      result = &g_array_index (model_file->results, ModelResult, ITER_INDEX (iter));
+      break;
+    }
+
+  switch (column)
+    {
+    case CODESLAYER_SEARCH_MODEL_FILE_PATH:
+      /* a file without hits opens the file itself */
+      if (result != NULL || (model_file != NULL && !model_file->has_results))
+        g_value_set_string (value, model_file->file_path);
+      break;
+    case CODESLAYER_SEARCH_MODEL_LINE_NUMBER:
+      if (result != NULL)
+        g_value_set_int (value, result->line_number);
+      break;
+    case CODESLAYER_SEARCH_MODEL_LINE_OFFSET:
+      if (result != NULL)
+        g_value_set_int64 (value, result->line_offset);
+      break;
+    case CODESLAYER_SEARCH_MODEL_MATCH_OFFSET:
+      if (result != NULL)
+        g_value_set_int (value, result->match_offset);
+      break;
+    case CODESLAYER_SEARCH_MODEL_MATCH_LENGTH:
+      if (result != NULL)
+        g_value_set_int (value, result->match_length);
+      break;
+    case CODESLAYER_SEARCH_MODEL_TEXT:
+      if (result != NULL && result->terms != NULL)
+        g_value_take_string (value, g_strdup_printf ("(%d) [%s] %s", result->line_number, 
+                                                     result->terms, result->text));
+      else if (result != NULL)
+        g_value_take_string (value, g_strdup_printf ("(%d) %s", result->line_number, 
+                                                     result->text));
+      else if (model_file != NULL)
+        g_value_set_string (value, model_file->node.text);
+      else
+        g_value_set_string (value, model_project->node.text);
+      break;
+    case CODESLAYER_SEARCH_MODEL_PROJECT:
+      g_value_set_pointer (value, model_project->project);
+      break;
+    }
+}
+
+static gboolean
+iter_next (GtkTreeModel *tree_model,
+           GtkTreeIter  *iter)
+{
+  GtkTreeIter parent;
+
+  if (ITER_LEVEL (iter) == LEVEL_PROJECT)
+    {
+      ModelProject *model_project = iter->user_data;
+      return iter_nth_child (tree_model, iter, NULL, model_project->node.index + 1);
+    }
+
+  if (ITER_LEVEL (iter) == LEVEL_FILE)
+    {
+      ModelFile *model_file = iter->user_data;
+      set_iter (CODESLAYER_SEARCH_MODEL (tree_model), &parent, model_file->parent, LEVEL_PROJECT, 0);
+      return iter_nth_child (tree_model, iter, &parent, model_file->node.index + 1);
+    }
+
+  set_iter (CODESLAYER_SEARCH_MODEL (tree_model), &parent, iter->user_data, LEVEL_FILE, 0);
+  return iter_nth_child (tree_model, iter, &parent, ITER_INDEX (iter) + 1);
+}
+
+static gboolean
+iter_children (GtkTreeModel *tree_model,
+               GtkTreeIter  *iter,
+               GtkTreeIter  *parent)
+{
+  return iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gboolean
+iter_has_child (GtkTreeModel *tree_model,
+                GtkTreeIter  *iter)
+{
+  return iter_n_children (tree_model, iter) > 0;
+}
+
+static gint
+iter_n_children (GtkTreeModel *tree_model,
+                 GtkTreeIter  *iter)
+{
+  if (iter == NULL)
+    return CODESLAYER_SEARCH_MODEL_GET_PRIVATE (tree_model)->projects->len;
+
+  switch (ITER_LEVEL (iter))
+    {
+    case LEVEL_PROJECT:
+      return ((ModelProject*) iter->user_data)->files->len;
+    case LEVEL_FILE:
+      return ((ModelFile*) iter->user_data)->results->len;
+    default:
+      return 0;
+    }
+}
+
+static gboolean
+iter_nth_child (GtkTreeModel *tree_model,
+                GtkTreeIter  *iter,
+                GtkTreeIter  *parent,
+                gint          n)
+{
+  CodeSlayerSearchModel *model = CODESLAYER_SEARCH_MODEL (tree_model);
+  CodeSlayerSearchModelPrivate *priv;
+
+  priv = CODESLAYER_SEARCH_MODEL_GET_PRIVATE (model);
+
+  if (n < 0 || n >= iter_n_children (tree_model, parent))
+    {
+      iter->stamp = 0;
+      return FALSE;
+    }
+
+  if (parent == NULL)
+    set_iter (model, iter, g_ptr_array_index (priv->projects, n), LEVEL_PROJECT, 0);
+  else if (ITER_LEVEL (parent) == LEVEL_PROJECT)
+    set_iter (model, iter, g_ptr_array_index (((ModelProject*) parent->user_data)->files, n), 
+              LEVEL_FILE, 0);
+  else
+    set_iter (model, iter, parent->user_data, LEVEL_RESULT, n);
+
+  return TRUE;
+}
+
+static gboolean
+iter_parent (GtkTreeModel *tree_model,
+             GtkTreeIter  *iter,
+             GtkTreeIter  *child)
+{
+  CodeSlayerSearchModel *model = CODESLAYER_SEARCH_MODEL (tree_model);
+
+  switch (ITER_LEVEL (child))
+    {
+    case LEVEL_PROJECT:
+      iter->stamp = 0;
+      return FALSE;
+    case LEVEL_FILE:
+      set_iter (model, iter, ((ModelFile*) child->user_data)->parent, LEVEL_PROJECT, 0);
+      return TRUE;
+    default:
+      set_iter (model, iter, child->user_data, LEVEL_FILE, 0);
+      return TRUE;
+    }
+}
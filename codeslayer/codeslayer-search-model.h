@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_MODEL_H__
+#define __CODESLAYER_SEARCH_MODEL_H__
+
+#include <gtk/gtk.h>
+#include <codeslayer/codeslayer-project.h>
+
+G_BEGIN_DECLS
+
+#define CODESLAYER_SEARCH_MODEL_TYPE            (codeslayer_search_model_get_type ())
+#define CODESLAYER_SEARCH_MODEL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), CODESLAYER_SEARCH_MODEL_TYPE, CodeSlayerSearchModel))
+#define CODESLAYER_SEARCH_MODEL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), CODESLAYER_SEARCH_MODEL_TYPE, CodeSlayerSearchModelClass))
+#define IS_CODESLAYER_SEARCH_MODEL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CODESLAYER_SEARCH_MODEL_TYPE))
+#define IS_CODESLAYER_SEARCH_MODEL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CODESLAYER_SEARCH_MODEL_TYPE))
+
+typedef struct _CodeSlayerSearchModel CodeSlayerSearchModel;
+typedef struct _CodeSlayerSearchModelClass CodeSlayerSearchModelClass;
+
+struct _CodeSlayerSearchModel
+{
+  GObject parent_instance;
+};
+
+struct _CodeSlayerSearchModelClass
+{
+  GObjectClass parent_class;
+};
+
+enum
+{
+  CODESLAYER_SEARCH_MODEL_FILE_PATH = 0,
+  CODESLAYER_SEARCH_MODEL_LINE_NUMBER,
+  CODESLAYER_SEARCH_MODEL_LINE_OFFSET,
+  CODESLAYER_SEARCH_MODEL_MATCH_OFFSET,
+  CODESLAYER_SEARCH_MODEL_MATCH_LENGTH,
+  CODESLAYER_SEARCH_MODEL_TEXT,
+  CODESLAYER_SEARCH_MODEL_PROJECT,
+  CODESLAYER_SEARCH_MODEL_COLUMNS
+};
+
+GType codeslayer_search_model_get_type (void) G_GNUC_CONST;
+
+CodeSlayerSearchModel*  codeslayer_search_model_new             (void);
+
+void                    codeslayer_search_model_clear           (CodeSlayerSearchModel *model);
+void                    codeslayer_search_model_append_project  (CodeSlayerSearchModel *model,
+                                                                 CodeSlayerProject     *project,
+                                                                 GtkTreeIter           *iter);
+void                    codeslayer_search_model_append_file     (CodeSlayerSearchModel *model,
+                                                                 GtkTreeIter           *project_iter,
+                                                                 const gchar           *file_path,
+                                                                 const gchar           *text,
+                                                                 gboolean               has_results,
+                                                                 GtkTreeIter           *iter);
+void                    codeslayer_search_model_append_result   (CodeSlayerSearchModel *model,
+                                                                 GtkTreeIter           *file_iter,
+                                                                 gint                   line_number,
+                                                                 goffset                line_offset,
+                                                                 gint                   match_offset,
+                                                                 gint                   match_length,
+                                                                 const gchar           *text,
+                                                                 const gchar           *terms);
+void                    codeslayer_search_model_sort            (CodeSlayerSearchModel *model);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_MODEL_H__ */
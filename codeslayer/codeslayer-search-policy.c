@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-policy.h>
+
+/*
+ * Decides which files are worth searching. A file can be skipped by its
+ * extension or its size before it is opened, and a file with a nul byte 
+ * in its first block is taken to be binary once it is read. The skipped 
+ * files are counted by reason so the search can say what it left out.
+ *
+ * The policy is shared by all of the workers. The skip types are only 
+ * changed between projects while no worker is running.
+ */
+
+struct _CodeSlayerSearchPolicy
+{
+  goffset   max_file_size;
+  gchar   **skip_types;
+  gint      skipped[CODESLAYER_SEARCH_POLICY_LAST];
+};
+
+/**
+ * codeslayer_search_policy_new:
+ * @max_file_size: the largest file in bytes that is searched, or 0 for
+ *                 no limit.
+ *
+ * Returns: a new #CodeSlayerSearchPolicy.
+ */
+CodeSlayerSearchPolicy*
+codeslayer_search_policy_new (goffset max_file_size)
+{
+  CodeSlayerSearchPolicy *policy;
+  policy = g_malloc0 (sizeof (CodeSlayerSearchPolicy));
+  policy->max_file_size = max_file_size;
+  return policy;
+}
+
+/**
+ * codeslayer_search_policy_free:
+ * @policy: a #CodeSlayerSearchPolicy.
+ */
+void
+codeslayer_search_policy_free (CodeSlayerSearchPolicy *policy)
+{
+  g_strfreev (policy->skip_types);
+  g_free (policy);
+}
+
+/**
+ * codeslayer_search_policy_set_skip_types:
+ * @policy: a #CodeSlayerSearchPolicy.
+ * @skip_types: the file extensions to skip as a comma separated list, 
+ *              or %NULL.
+ */
+void
+codeslayer_search_policy_set_skip_types (CodeSlayerSearchPolicy *policy,
+                                         const gchar            *skip_types)
+{
+  gchar **split;
+  gint i, j;
+
+  g_strfreev (policy->skip_types);
+  policy->skip_types = NULL;
+
+  if (skip_types == NULL)
+    return;
+
+  split = g_strsplit (skip_types, ",", 0);
+
+  /* drop the empty entries, they would match every file */
+  for (i = 0, j = 0; split[i] != NULL; i++)
+    {
+      g_strstrip (split[i]);
+      if (*split[i] == '\0')
+        g_free (split[i]);
+      else
+        split[j++] = split[i];
+    }
+  split[j] = NULL;
+
+  if (j == 0)
+    {
+      g_strfreev (split);
+      return;
+    }
+
+  policy->skip_types = split;
+}
+
+/**
+ * codeslayer_search_policy_check:
+ * @policy: a #CodeSlayerSearchPolicy.
+ * @file_name: the name of the file.
+ * @size: the size of the file in bytes.
+ *
+ * Checks the file before it is opened. The skipped file is counted.
+ *
+ * Returns: why the file is skipped, or #CODESLAYER_SEARCH_POLICY_ACCEPT.
+ */
+CodeSlayerSearchPolicyResult
+codeslayer_search_policy_check (CodeSlayerSearchPolicy *policy,
+                                const gchar            *file_name,
+                                goffset                 size)
+{
+  CodeSlayerSearchPolicyResult result = CODESLAYER_SEARCH_POLICY_ACCEPT;
+  gchar **tmp;
+
+  for (tmp = policy->skip_types; tmp != NULL && *tmp != NULL; tmp++)
+    {
+      if (g_str_has_suffix (file_name, *tmp))
+        {
+          result = CODESLAYER_SEARCH_POLICY_SKIP_TYPE;
+          break;
+        }
+    }
+
+  if (result == CODESLAYER_SEARCH_POLICY_ACCEPT 
+      && policy->max_file_size > 0 && size > policy->max_file_size)
+    result = CODESLAYER_SEARCH_POLICY_SKIP_SIZE;
+
+  if (result != CODESLAYER_SEARCH_POLICY_ACCEPT)
+    codeslayer_search_policy_skip (policy, result);
+
+  return result;
+}
+
+/**
+ * codeslayer_search_policy_skip:
+ * @policy: a #CodeSlayerSearchPolicy.
+ * @result: why the file was skipped.
+ *
+ * Counts a file that was skipped after it was opened.
+ */
+void
+codeslayer_search_policy_skip (CodeSlayerSearchPolicy       *policy,
+                               CodeSlayerSearchPolicyResult  result)
+{
+  g_atomic_int_inc (&policy->skipped[result]);
+}
+
+/**
+ * codeslayer_search_policy_get_skipped:
+ * @policy: a #CodeSlayerSearchPolicy.
+ * @result: the reason.
+ *
+ * Returns: the number of files skipped for the reason.
+ */
+gint
+codeslayer_search_policy_get_skipped (CodeSlayerSearchPolicy       *policy,
+                                      CodeSlayerSearchPolicyResult  result)
+{
+  return g_atomic_int_get (&policy->skipped[result]);
+}
+
+/**
+ * codeslayer_search_policy_is_binary:
+ * @text: the start of the file.
+ * @length: the length of the text.
+ *
+ * Source files do not have nul bytes, so one in the first block is
+ * enough to tell a binary file from a text file.
+ *
+ * Returns: is TRUE if the text looks binary.
+ */
+gboolean
+codeslayer_search_policy_is_binary (const gchar *text,
+                                    gsize        length)
+{
+  if (length > CODESLAYER_SEARCH_POLICY_BLOCK_SIZE)
+    length = CODESLAYER_SEARCH_POLICY_BLOCK_SIZE;
+  return memchr (text, '\0', length) != NULL;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_POLICY_H__
+#define	__CODESLAYER_SEARCH_POLICY_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* the part of a file that is checked for binary content */
+#define CODESLAYER_SEARCH_POLICY_BLOCK_SIZE 8192
+
+typedef struct _CodeSlayerSearchPolicy CodeSlayerSearchPolicy;
+
+typedef enum
+{
+  CODESLAYER_SEARCH_POLICY_ACCEPT = 0,
+  CODESLAYER_SEARCH_POLICY_SKIP_TYPE,
+  CODESLAYER_SEARCH_POLICY_SKIP_SIZE,
+  CODESLAYER_SEARCH_POLICY_SKIP_BINARY,
+  CODESLAYER_SEARCH_POLICY_LAST
+} CodeSlayerSearchPolicyResult;
+
+CodeSlayerSearchPolicy*       codeslayer_search_policy_new             (goffset                       max_file_size);
+void                          codeslayer_search_policy_free            (CodeSlayerSearchPolicy       *policy);
+void                          codeslayer_search_policy_set_skip_types  (CodeSlayerSearchPolicy       *policy,
+                                                                        const gchar                  *skip_types);
+CodeSlayerSearchPolicyResult  codeslayer_search_policy_check           (CodeSlayerSearchPolicy       *policy,
+                                                                        const gchar                  *file_name,
+                                                                        goffset                       size);
+void                          codeslayer_search_policy_skip            (CodeSlayerSearchPolicy       *policy,
+                                                                        CodeSlayerSearchPolicyResult  result);
+gint                          codeslayer_search_policy_get_skipped     (CodeSlayerSearchPolicy       *policy,
+                                                                        CodeSlayerSearchPolicyResult  result);
+gboolean                      codeslayer_search_policy_is_binary       (const gchar                  *text,
+                                                                        gsize                         length);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_POLICY_H__ */
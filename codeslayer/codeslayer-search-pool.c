@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <codeslayer/codeslayer-search-pool.h>
+
+/*
+ * A small work stealing thread pool used by the project search. Every
+ * worker owns a deque of tasks. A worker pushes the tasks it creates
+ * onto the tail of its own deque and pops from the tail as well, so a
+ * directory walk stays depth first on one core. An idle worker steals
+ * from the head of another worker's deque, which hands it the oldest
+ * (and usually the largest) piece of the tree.
+ */
+
+typedef struct _Worker Worker;
+
+struct _Worker
+{
+  CodeSlayerSearchPool *pool;
+  GThread              *thread;
+  GMutex                mutex;
+  GQueue                tasks;
+  gint                  index;
+};
+
+struct _CodeSlayerSearchPool
+{
+  CodeSlayerSearchPoolFunc  func;
+  gpointer                  user_data;
+  Worker                   *workers;
+  gint                      n_workers;
+  GMutex                    mutex;
+  GCond                     task_cond;
+  GCond                     done_cond;
+  gint                      queued;
+  gint                      pending;
+  gint                      next_worker;
+  gboolean                  shutdown;
+};
+
+static gpointer worker_run      (Worker               *worker);
+static gpointer pop_task        (Worker               *worker);
+static gpointer steal_task      (Worker               *worker);
+static void     finish_task     (CodeSlayerSearchPool *pool);
+
+static GPrivate current_worker = G_PRIVATE_INIT (NULL);
+
+/**
+ * codeslayer_search_pool_new:
+ * @n_workers: the number of worker threads, or zero to use the CPU count.
+ * @func: the function called for each task.
+ * @user_data: the data passed to @func.
+ *
+ * Returns: a new #CodeSlayerSearchPool with its workers already running.
+ */
+CodeSlayerSearchPool*
+codeslayer_search_pool_new (gint                     n_workers,
+                            CodeSlayerSearchPoolFunc func,
+                            gpointer                 user_data)
+{
+  CodeSlayerSearchPool *pool;
+  gint i;
+
+  if (n_workers <= 0)
+    n_workers = codeslayer_search_pool_get_default_size ();
+
+  pool = g_new0 (CodeSlayerSearchPool, 1);
+  pool->func = func;
+  pool->user_data = user_data;
+  pool->n_workers = n_workers;
+  pool->workers = g_new0 (Worker, n_workers);
+  g_mutex_init (&pool->mutex);
+  g_cond_init (&pool->task_cond);
+  g_cond_init (&pool->done_cond);
+
+  for (i = 0; i < n_workers; i++)
+    {
+      Worker *worker = &pool->workers[i];
+      worker->pool = pool;
+      worker->index = i;
+      g_mutex_init (&worker->mutex);
+      g_queue_init (&worker->tasks);
+    }
+
+  for (i = 0; i < n_workers; i++)
+    {
+      Worker *worker = &pool->workers[i];
+      worker->thread = g_thread_new ("search worker", (GThreadFunc) worker_run, worker);
+    }
+
+  return pool;
+}
+
+/**
+ * codeslayer_search_pool_free:
+ * @pool: a #CodeSlayerSearchPool.
+ *
+ * Stops and joins the workers. Any task still queued is dropped so
+ * call codeslayer_search_pool_wait() first to let the work finish.
+ */
+void
+codeslayer_search_pool_free (CodeSlayerSearchPool *pool)
+{
+  gint i;
+
+  g_mutex_lock (&pool->mutex);
+  pool->shutdown = TRUE;
+  g_cond_broadcast (&pool->task_cond);
+  g_mutex_unlock (&pool->mutex);
+
+  for (i = 0; i < pool->n_workers; i++)
+    {
+      Worker *worker = &pool->workers[i];
+      g_thread_join (worker->thread);
+      g_queue_clear (&worker->tasks);
+      g_mutex_clear (&worker->mutex);
+    }
+
+  g_mutex_clear (&pool->mutex);
+  g_cond_clear (&pool->task_cond);
+  g_cond_clear (&pool->done_cond);
+  g_free (pool->workers);
+  g_free (pool);
+}
+
+/**
+ * codeslayer_search_pool_push:
+ * @pool: a #CodeSlayerSearchPool.
+ * @task: the task to run, must not be %NULL.
+ *
+ * Queues the task. When called from one of the pool's own workers the
+ * task goes onto that worker's deque, otherwise the workers are filled
+ * round robin.
+ */
+void
+codeslayer_search_pool_push (CodeSlayerSearchPool *pool,
+                             gpointer              task)
+{
+  Worker *worker;
+
+  worker = g_private_get (&current_worker);
+  if (worker == NULL || worker->pool != pool)
+    {
+      guint next;
+      next = (guint) g_atomic_int_add (&pool->next_worker, 1);
+      worker = &pool->workers[next % pool->n_workers];
+    }
+
+  g_atomic_int_inc (&pool->pending);
+
+  g_mutex_lock (&worker->mutex);
+  g_queue_push_tail (&worker->tasks, task);
+  g_mutex_unlock (&worker->mutex);
+
+  g_atomic_int_inc (&pool->queued);
+
+  g_mutex_lock (&pool->mutex);
+  g_cond_signal (&pool->task_cond);
+  g_mutex_unlock (&pool->mutex);
+}
+
+/**
+ * codeslayer_search_pool_wait:
+ * @pool: a #CodeSlayerSearchPool.
+ *
+ * Blocks until every task pushed so far, and every task those tasks
+ * pushed in turn, has run.
+ */
+void
+codeslayer_search_pool_wait (CodeSlayerSearchPool *pool)
+{
+  g_mutex_lock (&pool->mutex);
+  while (g_atomic_int_get (&pool->pending) > 0)
+    g_cond_wait (&pool->done_cond, &pool->mutex);
+  g_mutex_unlock (&pool->mutex);
+}
+
+/**
+ * codeslayer_search_pool_get_size:
+ * @pool: a #CodeSlayerSearchPool.
+ *
+ * Returns: the number of workers.
+ */
+gint
+codeslayer_search_pool_get_size (CodeSlayerSearchPool *pool)
+{
+  return pool->n_workers;
+}
+
+/**
+ * codeslayer_search_pool_get_default_size:
+ *
+ * Returns: the number of workers to use when none is configured.
+ */
+gint
+codeslayer_search_pool_get_default_size (void)
+{
+  return MAX ((gint) g_get_num_processors (), 1);
+}
+
+static gpointer
+worker_run (Worker *worker)
+{
+  CodeSlayerSearchPool *pool = worker->pool;
+
+  g_private_set (&current_worker, worker);
+
+  while (TRUE)
+    {
+      gpointer task;
+
+      task = pop_task (worker);
+      if (task == NULL)
+        task = steal_task (worker);
+
+      if (task != NULL)
+        {
+          pool->func (task, pool->user_data);
+          finish_task (pool);
+          continue;
+        }
+
+      g_mutex_lock (&pool->mutex);
+      while (!pool->shutdown && g_atomic_int_get (&pool->queued) == 0)
+        g_cond_wait (&pool->task_cond, &pool->mutex);
+      if (pool->shutdown)
+        {
+          g_mutex_unlock (&pool->mutex);
+          break;
+        }
+      g_mutex_unlock (&pool->mutex);
+    }
+
+  g_private_set (&current_worker, NULL);
+
+  return NULL;
+}
+
+static gpointer
+pop_task (Worker *worker)
+{
+  gpointer task;
+
+  g_mutex_lock (&worker->mutex);
+  task = g_queue_pop_tail (&worker->tasks);
+  g_mutex_unlock (&worker->mutex);
+
+  if (task != NULL)
+    g_atomic_int_add (&worker->pool->queued, -1);
+
+  return task;
+}
+
+static gpointer
+steal_task (Worker *worker)
+{
+  CodeSlayerSearchPool *pool = worker->pool;
+  gint offset;
+  gint i;
+
+  if (pool->n_workers == 1)
+    return NULL;
+
+  offset = g_random_int_range (0, pool->n_workers);
+
+  for (i = 0; i < pool->n_workers; i++)
+    {
+      Worker *victim;
+      gpointer task;
+
+      victim = &pool->workers[(offset + i) % pool->n_workers];
+      if (victim == worker)
+        continue;
+
+      g_mutex_lock (&victim->mutex);
+      task = g_queue_pop_head (&victim->tasks);
+      g_mutex_unlock (&victim->mutex);
+
+      if (task != NULL)
+        {
+          g_atomic_int_add (&pool->queued, -1);
+          return task;
+        }
+    }
+
+  return NULL;
+}
+
+static void
+finish_task (CodeSlayerSearchPool *pool)
+{
+  if (g_atomic_int_dec_and_test (&pool->pending))
+    {
+      g_mutex_lock (&pool->mutex);
+      g_cond_broadcast (&pool->done_cond);
+      g_mutex_unlock (&pool->mutex);
+    }
+}
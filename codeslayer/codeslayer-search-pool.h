@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_POOL_H__
+#define	__CODESLAYER_SEARCH_POOL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchPool CodeSlayerSearchPool;
+
+typedef void (*CodeSlayerSearchPoolFunc) (gpointer task,
+                                          gpointer user_data);
+
+CodeSlayerSearchPool*  codeslayer_search_pool_new               (gint                      n_workers,
+                                                                 CodeSlayerSearchPoolFunc  func,
+                                                                 gpointer                  user_data);
+void                   codeslayer_search_pool_free              (CodeSlayerSearchPool     *pool);
+void                   codeslayer_search_pool_push              (CodeSlayerSearchPool     *pool,
+                                                                 gpointer                  task);
+void                   codeslayer_search_pool_wait              (CodeSlayerSearchPool     *pool);
+gint                   codeslayer_search_pool_get_size          (CodeSlayerSearchPool     *pool);
+gint                   codeslayer_search_pool_get_default_size  (void);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_POOL_H__ */
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <codeslayer/codeslayer-search-prefetch.h>
+#include <codeslayer/codeslayer-search-reader.h>
+
+/*
+ * Keeps the disk busy while a worker matches. The files of a directory 
+ * are pushed ahead of the one being scanned: each one is opened and the 
+ * kernel is told it will be needed, so it reads the file in the 
+ * background. By the time the worker takes the file it is usually in the
+ * page cache already. The window is bounded in files and in bytes so it 
+ * does not hold too many descriptors or push useful pages out.
+ *
+ * A prefetch belongs to one worker and is not locked.
+ */
+
+typedef struct
+{
+  gchar   *file_path;
+  goffset  size;
+  gint     fd;
+} PrefetchFile;
+
+struct _CodeSlayerSearchPrefetch
+{
+  GQueue   files;
+  guint    max_files;
+  goffset  max_bytes;
+  goffset  bytes;
+};
+
+static void advise_file (gint fd, 
+                         goffset size);
+
+/**
+ * codeslayer_search_prefetch_new:
+ * @max_files: the most files that are read ahead at once.
+ * @max_bytes: the most bytes that are read ahead at once. A single file
+ *             that is larger is still read ahead on its own.
+ *
+ * Returns: a new #CodeSlayerSearchPrefetch.
+ */
+CodeSlayerSearchPrefetch*
+codeslayer_search_prefetch_new (guint   max_files,
+                                goffset max_bytes)
+{
+  CodeSlayerSearchPrefetch *prefetch;
+  prefetch = g_malloc0 (sizeof (CodeSlayerSearchPrefetch));
+  g_queue_init (&prefetch->files);
+  prefetch->max_files = max_files;
+  prefetch->max_bytes = max_bytes;
+  return prefetch;
+}
+
+/**
+ * codeslayer_search_prefetch_free:
+ * @prefetch: a #CodeSlayerSearchPrefetch.
+ *
+ * Closes the files that were never taken.
+ */
+void
+codeslayer_search_prefetch_free (CodeSlayerSearchPrefetch *prefetch)
+{
+  PrefetchFile *file;
+
+  while ((file = g_queue_pop_head (&prefetch->files)) != NULL)
+    {
+      if (file->fd != -1)
+        close (file->fd);
+      g_free (file->file_path);
+      g_free (file);
+    }
+
+  g_free (prefetch);
+}
+
+/**
+ * codeslayer_search_prefetch_push:
+ * @prefetch: a #CodeSlayerSearchPrefetch.
+ * @file_path: the file that will be taken later.
+ * @size: the size of the file.
+ *
+ * Starts to read the file ahead. The files have to be taken in the order 
+ * they were pushed.
+ *
+ * Returns: is FALSE if the window is full, push the file again once one 
+ * was taken.
+ */
+gboolean
+codeslayer_search_prefetch_push (CodeSlayerSearchPrefetch *prefetch,
+                                 const gchar              *file_path,
+                                 goffset                   size)
+{
+  PrefetchFile *file;
+
+  if (!g_queue_is_empty (&prefetch->files)
+      && (prefetch->files.length >= prefetch->max_files 
+          || prefetch->bytes + size > prefetch->max_bytes))
+    return FALSE;
+
+  file = g_malloc (sizeof (PrefetchFile));
+  file->file_path = g_strdup (file_path);
+  file->size = size;
+  file->fd = codeslayer_search_reader_open (file_path);
+
+  if (file->fd != -1)
+    advise_file (file->fd, size);
+
+  prefetch->bytes += size;
+  g_queue_push_tail (&prefetch->files, file);
+
+  return TRUE;
+}
+
+/**
+ * codeslayer_search_prefetch_take:
+ * @prefetch: a #CodeSlayerSearchPrefetch.
+ * @file_path: the file to take.
+ *
+ * Returns: the open file, or -1 if it could not be opened or is not a 
+ * regular file. The caller closes it. A file that was not pushed first 
+ * is simply opened.
+ */
+gint
+codeslayer_search_prefetch_take (CodeSlayerSearchPrefetch *prefetch,
+                                 const gchar              *file_path)
+{
+  PrefetchFile *file;
+  gint fd;
+
+  file = g_queue_peek_head (&prefetch->files);
+  if (file == NULL || strcmp (file->file_path, file_path) != 0)
+    return codeslayer_search_reader_open (file_path);
+
+  g_queue_pop_head (&prefetch->files);
+  prefetch->bytes -= file->size;
+  fd = file->fd;
+
+  g_free (file->file_path);
+  g_free (file);
+
+  return fd;
+}
+
+static void
+advise_file (gint    fd, 
+             goffset size)
+{
+#ifdef POSIX_FADV_WILLNEED
+  /* the file is read once from start to end */
+  posix_fadvise (fd, 0, size, POSIX_FADV_SEQUENTIAL);
+  posix_fadvise (fd, 0, size, POSIX_FADV_WILLNEED);
+#endif
+}
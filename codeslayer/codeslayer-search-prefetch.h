@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_PREFETCH_H__
+#define	__CODESLAYER_SEARCH_PREFETCH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchPrefetch CodeSlayerSearchPrefetch;
+
+CodeSlayerSearchPrefetch*  codeslayer_search_prefetch_new   (guint                     max_files,
+                                                             goffset                   max_bytes);
+void                       codeslayer_search_prefetch_free  (CodeSlayerSearchPrefetch *prefetch);
+gboolean                   codeslayer_search_prefetch_push  (CodeSlayerSearchPrefetch *prefetch,
+                                                             const gchar              *file_path,
+                                                             goffset                   size);
+gint                       codeslayer_search_prefetch_take  (CodeSlayerSearchPrefetch *prefetch,
+                                                             const gchar              *file_path);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_PREFETCH_H__ */
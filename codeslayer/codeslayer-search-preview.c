@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <codeslayer/codeslayer-search-preview.h>
+
+/*
+ * Shows the lines around a hit without opening the file in an editor. 
+ * The scan keeps where every matching line starts, so only a window of 
+ * bytes around that offset is read. The window of the last few files 
+ * is kept, since the hits of a file are usually looked at one after 
+ * the other, and a window is read again when it does not hold all of 
+ * the lines that are asked for or the file changed.
+ *
+ * A preview is only used from the main loop and is not locked.
+ */
+
+#define PREVIEW_LINE_SIZE 256
+#define PREVIEW_MIN_WINDOW (4 * 1024)
+
+typedef struct
+{
+  gchar   *file_path;
+  gint64   mtime;     /* in nanoseconds */
+  goffset  size;
+  goffset  start;
+  gchar   *data;
+  gsize    length;
+} PreviewFile;
+
+struct _CodeSlayerSearchPreview
+{
+  GQueue  files;
+  guint   max_files;
+};
+
+static PreviewFile* read_preview_file  (const gchar  *file_path,
+                                        struct stat  *st,
+                                        goffset       line_offset,
+                                        guint         context_lines);
+static void free_preview_file          (PreviewFile  *preview_file);
+static gboolean find_context           (PreviewFile  *preview_file,
+                                        goffset       line_offset,
+                                        guint         context_lines,
+                                        gsize        *start,
+                                        gsize        *end);
+static gchar* copy_context             (const gchar  *text,
+                                        gsize         length);
+static gint64 get_mtime                (struct stat  *st);
+
+/**
+ * codeslayer_search_preview_new:
+ * @max_files: the number of files whose window is kept.
+ *
+ * Returns: a new #CodeSlayerSearchPreview.
+ */
+CodeSlayerSearchPreview*
+codeslayer_search_preview_new (guint max_files)
+{
+  CodeSlayerSearchPreview *preview;
+  preview = g_malloc0 (sizeof (CodeSlayerSearchPreview));
+  g_queue_init (&preview->files);
+  preview->max_files = MAX (max_files, 1);
+  return preview;
+}
+
+/**
+ * codeslayer_search_preview_free:
+ * @preview: a #CodeSlayerSearchPreview.
+ */
+void
+codeslayer_search_preview_free (CodeSlayerSearchPreview *preview)
+{
+  PreviewFile *preview_file;
+
+  while ((preview_file = g_queue_pop_head (&preview->files)) != NULL)
+    free_preview_file (preview_file);
+
+  g_free (preview);
+}
+
+/**
+ * codeslayer_search_preview_get:
+ * @preview: a #CodeSlayerSearchPreview.
+ * @file_path: the file of the hit.
+ * @line_offset: the byte offset of the line of the hit.
+ * @context_lines: the number of lines to show before and after the hit.
+ * @hit_offset: (out): set to where the line of the hit starts in the 
+ *              text that is returned.
+ *
+ * Bytes that are not UTF-8 are shown as a question mark, so the offsets 
+ * into the text are the same as into the file.
+ *
+ * Returns: the lines around the hit, without the last line terminator, 
+ * or %NULL if the file could not be read or is now shorter than the 
+ * offset. Free with g_free().
+ */
+gchar*
+codeslayer_search_preview_get (CodeSlayerSearchPreview *preview,
+                               const gchar             *file_path,
+                               goffset                  line_offset,
+                               guint                    context_lines,
+                               gsize                   *hit_offset)
+{
+  PreviewFile *preview_file = NULL;
+  struct stat st;
+  gsize start;
+  gsize end;
+  GList *list;
+
+  if (stat (file_path, &st) == -1 || !S_ISREG (st.st_mode) 
+      || line_offset < 0 || line_offset > st.st_size)
+    return NULL;
+
+  for (list = preview->files.head; list != NULL; list = list->next)
+    {
+      PreviewFile *cached = list->data;
+      if (g_strcmp0 (cached->file_path, file_path) == 0)
+        {
+          g_queue_delete_link (&preview->files, list);
+          preview_file = cached;
+          break;
+        }
+    }
+
+  if (preview_file != NULL 
+      && (preview_file->mtime != get_mtime (&st) || preview_file->size != st.st_size
+          || !find_context (preview_file, line_offset, context_lines, &start, &end)))
+    {
+      free_preview_file (preview_file);
+      preview_file = NULL;
+    }
+
+  if (preview_file == NULL)
+    {
+      preview_file = read_preview_file (file_path, &st, line_offset, context_lines);
+      if (preview_file == NULL)
+        return NULL;
+      
+      /* a window that was just read is shown even if a line did not fit */
+      find_context (preview_file, line_offset, context_lines, &start, &end);
+    }
+
+  g_queue_push_head (&preview->files, preview_file);
+  while (g_queue_get_length (&preview->files) > preview->max_files)
+    free_preview_file (g_queue_pop_tail (&preview->files));
+
+  *hit_offset = line_offset - preview_file->start - start;
+
+  return copy_context (preview_file->data + start, end - start);
+}
+
+static PreviewFile*
+read_preview_file (const gchar *file_path,
+                   struct stat *st,
+                   goffset      line_offset,
+                   guint        context_lines)
+{
+  PreviewFile *preview_file;
+  goffset window;
+  goffset start;
+  goffset end;
+  gsize filled = 0;
+  gint fd;
+
+  window = MAX ((goffset) (context_lines + 1) * PREVIEW_LINE_SIZE, PREVIEW_MIN_WINDOW);
+  start = MAX (line_offset - window, 0);
+  end = MIN (line_offset + window, st->st_size);
+
+  fd = open (file_path, O_RDONLY);
+  if (fd == -1)
+    return NULL;
+
+  preview_file = g_malloc (sizeof (PreviewFile));
+  preview_file->file_path = g_strdup (file_path);
+  preview_file->mtime = get_mtime (st);
+  preview_file->size = st->st_size;
+  preview_file->start = start;
+  preview_file->data = g_malloc (end - start);
+
+  while (filled < (gsize) (end - start))
+    {
+      gssize bytes;
+      bytes = pread (fd, preview_file->data + filled, end - start - filled, start + filled);
+      if (bytes < 0 && errno == EINTR)
+        continue;
+      if (bytes <= 0)
+        break;
+      filled += bytes;
+    }
+
+  close (fd);
+
+  /* the file got shorter since it was looked at */
+  preview_file->length = filled;
+  if (line_offset > start + (goffset) filled)
+    {
+      free_preview_file (preview_file);
+      return NULL;
+    }
+
+  return preview_file;
+}
+
+static void
+free_preview_file (PreviewFile *preview_file)
+{
+  g_free (preview_file->file_path);
+  g_free (preview_file->data);
+  g_free (preview_file);
+}
+
+/*
+ * Finds the lines before and after the line at the offset. Returns 
+ * FALSE if the window ends before all of them are found and it does 
+ * not end where the file does, in which case the lines that are whole 
+ * are still given.
+ */
+static gboolean
+find_context (PreviewFile *preview_file,
+              goffset      line_offset,
+              guint        context_lines,
+              gsize       *start,
+              gsize       *end)
+{
+  const gchar *data = preview_file->data;
+  gsize length = preview_file->length;
+  gboolean at_start = preview_file->start == 0;
+  gboolean at_end = preview_file->start + (goffset) length == preview_file->size;
+  gboolean complete = TRUE;
+  gsize pos;
+  guint lines;
+
+  if (line_offset < preview_file->start 
+      || line_offset > preview_file->start + (goffset) length)
+    {
+      *start = *end = 0;
+      return FALSE;
+    }
+
+  pos = line_offset - preview_file->start;
+
+  /* back over the newline that ends each line before */
+  *start = pos;
+  for (lines = 0; lines < context_lines && *start > 0; lines++)
+    {
+      gsize i = *start - 1;
+      while (i > 0 && data[i - 1] != '\n')
+        i--;
+      if (i == 0 && !at_start)
+        break;
+      *start = i;
+    }
+  if (lines < context_lines && !(at_start && *start == 0))
+    complete = FALSE;
+
+  /* the line of the hit and then the lines after it */
+  *end = pos;
+  for (lines = 0; lines <= context_lines && *end < length; lines++)
+    {
+      const gchar *newline;
+      newline = memchr (data + *end, '\n', length - *end);
+      if (newline == NULL)
+        {
+          if (at_end)
+            *end = length;
+          break;
+        }
+      *end = newline - data + 1;
+    }
+  if (lines <= context_lines && !(at_end && *end == length))
+    complete = FALSE;
+
+  /* a hit on a line longer than the window still shows what was read */
+  if (*end == pos)
+    *end = length;
+
+  return complete;
+}
+
+static gchar*
+copy_context (const gchar *text,
+              gsize        length)
+{
+  const gchar *end;
+  const gchar *pos;
+  gchar *copy;
+
+  if (length > 0 && text[length - 1] == '\n')
+    length--;
+
+  /* an empty file has no data at all */
+  copy = g_malloc (length + 1);
+  if (length > 0)
+    memcpy (copy, text, length);
+  copy[length] = '\0';
+  end = copy + length;
+  pos = copy;
+
+  while (!g_utf8_validate (pos, end - pos, &pos))
+    {
+      /* a nul also stops the validation */
+      *(gchar*) pos = '?';
+      pos++;
+    }
+
+  return copy;
+}
+
+/*
+ * A file saved twice within a second keeps its st_mtime, the 
+ * nanoseconds tell the two apart.
+ */
+static gint64
+get_mtime (struct stat *st)
+{
+  return (gint64) st->st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) + st->st_mtim.tv_nsec;
+}
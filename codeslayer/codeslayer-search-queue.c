@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <codeslayer/codeslayer-search-queue.h>
+
+/*
+ * Hands the project search results from the worker threads to the main
+ * loop. Pushing never takes a lock: a producer swaps itself in as the new
+ * head of a linked list and then links the old head to it. Only the main
+ * loop pops, from the other end, so it needs no lock either.
+ *
+ * The queue is bounded. A producer that finds it full waits until the
+ * consumer has made room, so a search with a huge number of hits can
+ * not run ahead of the tree view and fill up memory.
+ *
+ * The consumer drains in slices. When it runs dry it calls
+ * codeslayer_search_queue_sleep() and the next push wakes it up again
+ * through the notify function.
+ */
+
+typedef struct _Node Node;
+
+struct _Node
+{
+  Node     *next;
+  gpointer  item;
+};
+
+struct _CodeSlayerSearchQueue
+{
+  Node                        *head;
+  Node                        *tail;
+  gint                         count;
+  gint                         capacity;
+  gint                         sleeping;
+  gint                         closed;
+  gint                         ref_count;
+  GMutex                       mutex;
+  GCond                        cond;
+  GDestroyNotify               item_free;
+  CodeSlayerSearchQueueNotify  notify;
+  gpointer                     user_data;
+};
+
+static void wait_for_room  (CodeSlayerSearchQueue *queue);
+
+/**
+ * codeslayer_search_queue_new:
+ * @capacity: the number of items the queue holds before producers wait.
+ * @item_free: frees any item still queued when the queue goes away.
+ * @notify: wakes up the consumer.
+ * @user_data: passed to @notify.
+ *
+ * The queue starts out with the consumer asleep, so the first push
+ * calls @notify.
+ *
+ * Returns: a new #CodeSlayerSearchQueue.
+ */
+CodeSlayerSearchQueue*
+codeslayer_search_queue_new (gint                        capacity,
+                             GDestroyNotify              item_free,
+                             CodeSlayerSearchQueueNotify notify,
+                             gpointer                    user_data)
+{
+  CodeSlayerSearchQueue *queue;
+  Node *stub;
+
+  stub = g_slice_new0 (Node);
+
+  queue = g_new0 (CodeSlayerSearchQueue, 1);
+  queue->head = stub;
+  queue->tail = stub;
+  queue->capacity = MAX (capacity, 1);
+  queue->sleeping = TRUE;
+  queue->ref_count = 1;
+  queue->item_free = item_free;
+  queue->notify = notify;
+  queue->user_data = user_data;
+  g_mutex_init (&queue->mutex);
+  g_cond_init (&queue->cond);
+
+  return queue;
+}
+
+/**
+ * codeslayer_search_queue_ref:
+ * @queue: a #CodeSlayerSearchQueue.
+ *
+ * Returns: the queue.
+ */
+CodeSlayerSearchQueue*
+codeslayer_search_queue_ref (CodeSlayerSearchQueue *queue)
+{
+  g_atomic_int_inc (&queue->ref_count);
+  return queue;
+}
+
+/**
+ * codeslayer_search_queue_unref:
+ * @queue: a #CodeSlayerSearchQueue.
+ *
+ * Frees the queue, and any item left in it, with the last reference.
+ */
+void
+codeslayer_search_queue_unref (CodeSlayerSearchQueue *queue)
+{
+  Node *node;
+
+  if (!g_atomic_int_dec_and_test (&queue->ref_count))
+    return;
+
+  node = queue->tail;
+  while (node != NULL)
+    {
+      Node *next = node->next;
+      if (node != queue->tail && queue->item_free != NULL)
+        queue->item_free (node->item);
+      g_slice_free (Node, node);
+      node = next;
+    }
+
+  g_mutex_clear (&queue->mutex);
+  g_cond_clear (&queue->cond);
+  g_free (queue);
+}
+
+/**
+ * codeslayer_search_queue_push:
+ * @queue: a #CodeSlayerSearchQueue.
+ * @item: the item to hand to the consumer.
+ *
+ * Safe to call from any number of threads. Blocks while the queue is
+ * full.
+ *
+ * Returns: is FALSE if the queue was closed, the caller still owns the
+ * item in that case.
+ */
+gboolean
+codeslayer_search_queue_push (CodeSlayerSearchQueue *queue,
+                              gpointer               item)
+{
+  Node *node;
+  Node *prev;
+
+  if (g_atomic_int_get (&queue->count) >= queue->capacity)
+    wait_for_room (queue);
+
+  if (g_atomic_int_get (&queue->closed))
+    return FALSE;
+
+  node = g_slice_new (Node);
+  node->next = NULL;
+  node->item = item;
+
+  g_atomic_int_inc (&queue->count);
+
+  do
+    prev = g_atomic_pointer_get (&queue->head);
+  while (!g_atomic_pointer_compare_and_exchange (&queue->head, prev, node));
+
+  g_atomic_pointer_set (&prev->next, node);
+
+  if (g_atomic_int_compare_and_exchange (&queue->sleeping, TRUE, FALSE))
+    queue->notify (queue->user_data);
+
+  return TRUE;
+}
+
+/**
+ * codeslayer_search_queue_pop:
+ * @queue: a #CodeSlayerSearchQueue.
+ *
+ * Only the consumer may call this.
+ *
+ * Returns: the oldest item, or %NULL if there is nothing to pop right now.
+ */
+gpointer
+codeslayer_search_queue_pop (CodeSlayerSearchQueue *queue)
+{
+  Node *tail = queue->tail;
+  Node *next;
+  gpointer item;
+
+  next = g_atomic_pointer_get (&tail->next);
+  if (next == NULL)
+    return NULL;
+
+  /* the popped node becomes the new stub */
+  item = next->item;
+  next->item = NULL;
+  queue->tail = next;
+  g_slice_free (Node, tail);
+
+  if (g_atomic_int_add (&queue->count, -1) >= queue->capacity)
+    {
+      g_mutex_lock (&queue->mutex);
+      g_cond_broadcast (&queue->cond);
+      g_mutex_unlock (&queue->mutex);
+    }
+
+  return item;
+}
+
+/**
+ * codeslayer_search_queue_sleep:
+ * @queue: a #CodeSlayerSearchQueue.
+ *
+ * Called by the consumer when it stops draining. The next push will
+ * call the notify function.
+ *
+ * Returns: is FALSE if items arrived in the meantime and the consumer
+ * should keep going instead.
+ */
+gboolean
+codeslayer_search_queue_sleep (CodeSlayerSearchQueue *queue)
+{
+  g_atomic_int_set (&queue->sleeping, TRUE);
+
+  if (g_atomic_int_get (&queue->count) > 0
+      && g_atomic_int_compare_and_exchange (&queue->sleeping, TRUE, FALSE))
+    return FALSE;
+
+  return TRUE;
+}
+
+/**
+ * codeslayer_search_queue_close:
+ * @queue: a #CodeSlayerSearchQueue.
+ *
+ * Makes every later push fail and releases the producers that are
+ * waiting for room. A sleeping consumer is woken up so that it can
+ * see the queue was closed.
+ */
+void
+codeslayer_search_queue_close (CodeSlayerSearchQueue *queue)
+{
+  g_mutex_lock (&queue->mutex);
+  g_atomic_int_set (&queue->closed, TRUE);
+  g_cond_broadcast (&queue->cond);
+  g_mutex_unlock (&queue->mutex);
+
+  if (g_atomic_int_compare_and_exchange (&queue->sleeping, TRUE, FALSE))
+    queue->notify (queue->user_data);
+}
+
+/**
+ * codeslayer_search_queue_is_closed:
+ * @queue: a #CodeSlayerSearchQueue.
+ *
+ * Returns: is TRUE once the queue was closed.
+ */
+gboolean
+codeslayer_search_queue_is_closed (CodeSlayerSearchQueue *queue)
+{
+  return g_atomic_int_get (&queue->closed);
+}
+
+static void
+wait_for_room (CodeSlayerSearchQueue *queue)
+{
+  g_mutex_lock (&queue->mutex);
+  while (g_atomic_int_get (&queue->count) >= queue->capacity
+         && !g_atomic_int_get (&queue->closed))
+    g_cond_wait (&queue->cond, &queue->mutex);
+  g_mutex_unlock (&queue->mutex);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_QUEUE_H__
+#define	__CODESLAYER_SEARCH_QUEUE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchQueue CodeSlayerSearchQueue;
+
+/*
+ * Called from a producer thread when the consumer went to sleep and
+ * there is something to pop again.
+ */
+typedef void (*CodeSlayerSearchQueueNotify) (gpointer user_data);
+
+CodeSlayerSearchQueue*  codeslayer_search_queue_new        (gint                          capacity,
+                                                            GDestroyNotify                item_free,
+                                                            CodeSlayerSearchQueueNotify   notify,
+                                                            gpointer                      user_data);
+CodeSlayerSearchQueue*  codeslayer_search_queue_ref        (CodeSlayerSearchQueue        *queue);
+void                    codeslayer_search_queue_unref      (CodeSlayerSearchQueue        *queue);
+gboolean                codeslayer_search_queue_push       (CodeSlayerSearchQueue        *queue,
+                                                            gpointer                      item);
+gpointer                codeslayer_search_queue_pop        (CodeSlayerSearchQueue        *queue);
+gboolean                codeslayer_search_queue_sleep      (CodeSlayerSearchQueue        *queue);
+void                    codeslayer_search_queue_close      (CodeSlayerSearchQueue        *queue);
+gboolean                codeslayer_search_queue_is_closed  (CodeSlayerSearchQueue        *queue);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_QUEUE_H__ */
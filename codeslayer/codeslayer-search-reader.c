@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <codeslayer/codeslayer-search-reader.h>
+
+#if defined (__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined (__NR_io_uring_setup)
+#include <linux/io_uring.h>
+/* the open, read and close operations all came with this kernel release */
+#if defined (IORING_FEAT_RW_CUR_POS)
+#define HAVE_IO_URING 1
+#include <linux/stat.h>
+#ifndef AT_EMPTY_PATH
+#define AT_EMPTY_PATH 0x1000
+#endif
+#endif
+#endif
+#endif
+
+/*
+ * Reads many small files with as few system calls as possible. With 
+ * io_uring a batch of files is opened with one call, read with the next 
+ * and closed with a third, instead of three calls for every file. The 
+ * ring is set up when the reader is made and is only used when the 
+ * kernel can do all three operations, otherwise the files are read one 
+ * by one with plain calls. Either way the caller gets the same bytes.
+ *
+ * A path can stop being a regular file between the listing and the 
+ * read, so nothing is read from a descriptor that is not one. The open 
+ * does not block on a fifo or take a terminal, and the descriptor does 
+ * not leak into a child of another thread.
+ *
+ * A reader is used by one thread at a time.
+ */
+
+#define READER_RING_ENTRIES 64
+#define READER_ARENA_SIZE (4 * 1024 * 1024)
+#define READER_OPEN_FLAGS (O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC)
+
+struct _CodeSlayerSearchReader
+{
+  gchar                *arena;
+  gsize                 arena_size;
+#ifdef HAVE_IO_URING
+  gint                  ring_fd;
+  gboolean              has_statx;
+  guint                 sq_entries;
+  gpointer              sq_ring;
+  gsize                 sq_ring_size;
+  gpointer              cq_ring;
+  gsize                 cq_ring_size;
+  struct io_uring_sqe  *sqes;
+  gsize                 sqes_size;
+  guint32              *sq_tail;
+  guint32              *sq_mask;
+  guint32              *sq_array;
+  guint32               sq_tail_local;
+  guint32              *cq_head;
+  guint32              *cq_tail;
+  guint32              *cq_mask;
+  struct io_uring_cqe  *cqes;
+#endif
+};
+
+static void read_plain           (CodeSlayerSearchReader      *reader,
+                                  const gchar                 *file_path,
+                                  gsize                        limit,
+                                  gchar                       *buffer,
+                                  gssize                      *length);
+static void ensure_arena         (CodeSlayerSearchReader      *reader,
+                                  gsize                        size);
+static gboolean is_regular       (gint                         fd);
+#ifdef HAVE_IO_URING
+static gboolean setup_ring       (CodeSlayerSearchReader      *reader);
+static void close_ring           (CodeSlayerSearchReader      *reader);
+static gboolean read_ring        (CodeSlayerSearchReader      *reader,
+                                  const gchar * const         *file_paths,
+                                  const gsize                 *limits,
+                                  const gsize                 *offsets,
+                                  guint                        n_files,
+                                  gssize                      *lengths);
+static struct io_uring_sqe* get_sqe (CodeSlayerSearchReader   *reader,
+                                     guint8                    opcode,
+                                     guint                     index);
+static gboolean submit_and_wait  (CodeSlayerSearchReader      *reader,
+                                  guint                        count,
+                                  gint64                      *results);
+static gboolean stat_ring        (CodeSlayerSearchReader      *reader,
+                                  guint                        n_files,
+                                  gint64                      *fds);
+#endif
+
+/**
+ * codeslayer_search_reader_new:
+ * @use_uring: is TRUE to read with io_uring if the kernel supports it.
+ *
+ * Returns: a new #CodeSlayerSearchReader.
+ */
+CodeSlayerSearchReader*
+codeslayer_search_reader_new (gboolean use_uring)
+{
+  CodeSlayerSearchReader *reader;
+
+  reader = g_malloc0 (sizeof (CodeSlayerSearchReader));
+
+#ifdef HAVE_IO_URING
+  reader->ring_fd = -1;
+  if (use_uring && !setup_ring (reader))
+    close_ring (reader);
+#endif
+
+  return reader;
+}
+
+/**
+ * codeslayer_search_reader_free:
+ * @reader: a #CodeSlayerSearchReader.
+ */
+void
+codeslayer_search_reader_free (CodeSlayerSearchReader *reader)
+{
+#ifdef HAVE_IO_URING
+  close_ring (reader);
+#endif
+  g_free (reader->arena);
+  g_free (reader);
+}
+
+/**
+ * codeslayer_search_reader_has_uring:
+ * @reader: a #CodeSlayerSearchReader.
+ *
+ * Returns: is TRUE if the files are read with io_uring.
+ */
+gboolean
+codeslayer_search_reader_has_uring (CodeSlayerSearchReader *reader)
+{
+#ifdef HAVE_IO_URING
+  return reader->ring_fd != -1;
+#else
+  return FALSE;
+#endif
+}
+
+/**
+ * codeslayer_search_reader_read:
+ * @reader: a #CodeSlayerSearchReader.
+ * @file_paths: the files to read.
+ * @limits: the most bytes to read from the start of each file.
+ * @n_files: the number of files.
+ * @func: called with the contents of every file.
+ * @user_data: passed to @func.
+ *
+ * Reads the start of every file and hands it to @func. A file that is 
+ * longer than its limit is cut off, so ask for one byte more than the 
+ * size that is expected to find out that a file grew.
+ */
+void
+codeslayer_search_reader_read (CodeSlayerSearchReader     *reader,
+                               const gchar * const        *file_paths,
+                               const gsize                *limits,
+                               guint                       n_files,
+                               CodeSlayerSearchReaderFunc  func,
+                               gpointer                    user_data)
+{
+  gsize offsets[READER_RING_ENTRIES];
+  gssize lengths[READER_RING_ENTRIES];
+  guint start = 0;
+
+  while (start < n_files)
+    {
+      gsize total = 0;
+      guint end = start;
+      guint i;
+
+      /* a batch fits the ring and the arena, but always takes one file */
+      while (end < n_files && end - start < READER_RING_ENTRIES
+             && (end == start || total + limits[end] <= READER_ARENA_SIZE))
+        {
+          offsets[end - start] = total;
+          total += limits[end];
+          end++;
+        }
+
+      ensure_arena (reader, total);
+
+#ifdef HAVE_IO_URING
+      if (reader->ring_fd == -1 
+          || !read_ring (reader, file_paths + start, limits + start, 
+                         offsets, end - start, lengths))
+#endif
+        {
+          for (i = start; i < end; i++)
+            read_plain (reader, file_paths[i], limits[i], 
+                        reader->arena + offsets[i - start], &lengths[i - start]);
+        }
+
+      for (i = start; i < end; i++)
+        func (i, lengths[i - start] < 0 ? NULL : reader->arena + offsets[i - start], 
+              lengths[i - start], user_data);
+
+      start = end;
+    }
+}
+
+/**
+ * codeslayer_search_reader_open:
+ * @file_path: the file to open.
+ *
+ * Opens a file for reading the same way the reader does, for the files 
+ * that are read some other way.
+ *
+ * Returns: the open file, or -1 if it could not be opened or is not a 
+ * regular file. The caller closes it.
+ */
+gint
+codeslayer_search_reader_open (const gchar *file_path)
+{
+  gint fd;
+
+  fd = open (file_path, READER_OPEN_FLAGS);
+  if (fd != -1 && !is_regular (fd))
+    {
+      close (fd);
+      fd = -1;
+    }
+
+  return fd;
+}
+
+static void
+read_plain (CodeSlayerSearchReader *reader,
+            const gchar            *file_path,
+            gsize                   limit,
+            gchar                  *buffer,
+            gssize                 *length)
+{
+  gsize filled = 0;
+  gint fd;
+
+  *length = -1;
+
+  fd = codeslayer_search_reader_open (file_path);
+  if (fd == -1)
+    return;
+
+  while (filled < limit)
+    {
+      gssize bytes;
+      bytes = read (fd, buffer + filled, limit - filled);
+      if (bytes < 0 && errno == EINTR)
+        continue;
+      if (bytes < 0)
+        {
+          close (fd);
+          return;
+        }
+      if (bytes == 0)
+        break;
+      filled += bytes;
+    }
+
+  close (fd);
+  *length = filled;
+}
+
+static void
+ensure_arena (CodeSlayerSearchReader *reader,
+              gsize                   size)
+{
+  if (reader->arena_size >= size && reader->arena != NULL)
+    return;
+
+  g_free (reader->arena);
+  reader->arena_size = MAX (size, 4096);
+  reader->arena = g_malloc (reader->arena_size);
+}
+
+static gboolean
+is_regular (gint fd)
+{
+  struct stat st;
+  return fstat (fd, &st) == 0 && S_ISREG (st.st_mode);
+}
+
+#ifdef HAVE_IO_URING
+
+static gboolean
+setup_ring (CodeSlayerSearchReader *reader)
+{
+  struct io_uring_params params;
+  struct io_uring_probe *probe;
+  gboolean supported;
+  gsize probe_size;
+  guint8 *sq_ring;
+  guint8 *cq_ring;
+
+  memset (&params, 0, sizeof (params));
+  reader->ring_fd = syscall (__NR_io_uring_setup, READER_RING_ENTRIES, &params);
+  if (reader->ring_fd < 0)
+    {
+      reader->ring_fd = -1;
+      return FALSE;
+    }
+
+  reader->sq_entries = params.sq_entries;
+  if (reader->sq_entries < READER_RING_ENTRIES)
+    return FALSE;
+
+  reader->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (guint32);
+  reader->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    reader->sq_ring_size = reader->cq_ring_size = MAX (reader->sq_ring_size, reader->cq_ring_size);
+
+  reader->sq_ring = mmap (NULL, reader->sq_ring_size, PROT_READ | PROT_WRITE, 
+                          MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQ_RING);
+  if (reader->sq_ring == MAP_FAILED)
+    {
+      reader->sq_ring = NULL;
+      return FALSE;
+    }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      reader->cq_ring = reader->sq_ring;
+    }
+  else
+    {
+      reader->cq_ring = mmap (NULL, reader->cq_ring_size, PROT_READ | PROT_WRITE, 
+                              MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_CQ_RING);
+      if (reader->cq_ring == MAP_FAILED)
+        {
+          reader->cq_ring = NULL;
+          return FALSE;
+        }
+    }
+
+  reader->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+  reader->sqes = mmap (NULL, reader->sqes_size, PROT_READ | PROT_WRITE, 
+                       MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQES);
+  if (reader->sqes == MAP_FAILED)
+    {
+      reader->sqes = NULL;
+      return FALSE;
+    }
+
+  sq_ring = reader->sq_ring;
+  cq_ring = reader->cq_ring;
+  reader->sq_tail = (guint32*) (sq_ring + params.sq_off.tail);
+  reader->sq_mask = (guint32*) (sq_ring + params.sq_off.ring_mask);
+  reader->sq_array = (guint32*) (sq_ring + params.sq_off.array);
+  reader->sq_tail_local = *reader->sq_tail;
+  reader->cq_head = (guint32*) (cq_ring + params.cq_off.head);
+  reader->cq_tail = (guint32*) (cq_ring + params.cq_off.tail);
+  reader->cq_mask = (guint32*) (cq_ring + params.cq_off.ring_mask);
+  reader->cqes = (struct io_uring_cqe*) (cq_ring + params.cq_off.cqes);
+
+  /* a kernel can have io_uring without the operations we need */
+  probe_size = sizeof (struct io_uring_probe) + 256 * sizeof (struct io_uring_probe_op);
+  probe = g_malloc0 (probe_size);
+  supported = syscall (__NR_io_uring_register, reader->ring_fd, 
+                       IORING_REGISTER_PROBE, probe, 256) >= 0
+              && probe->last_op >= IORING_OP_CLOSE
+              && probe->last_op >= IORING_OP_OPENAT
+              && probe->last_op >= IORING_OP_READ
+              && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED)
+              && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+              && (probe->ops[IORING_OP_CLOSE].flags & IO_URING_OP_SUPPORTED);
+  reader->has_statx = supported
+                      && probe->last_op >= IORING_OP_STATX
+                      && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED);
+  g_free (probe);
+
+  return supported;
+}
+
+static void
+close_ring (CodeSlayerSearchReader *reader)
+{
+  if (reader->sqes != NULL)
+    munmap (reader->sqes, reader->sqes_size);
+  if (reader->cq_ring != NULL && reader->cq_ring != reader->sq_ring)
+    munmap (reader->cq_ring, reader->cq_ring_size);
+  if (reader->sq_ring != NULL)
+    munmap (reader->sq_ring, reader->sq_ring_size);
+  if (reader->ring_fd != -1)
+    close (reader->ring_fd);
+
+  reader->sqes = NULL;
+  reader->cq_ring = NULL;
+  reader->sq_ring = NULL;
+  reader->ring_fd = -1;
+}
+
+/*
+ * Opens, checks, reads and closes the batch with four calls. Returns 
+ * FALSE if the ring failed, which then is given up for the plain calls.
+ */
+static gboolean
+read_ring (CodeSlayerSearchReader *reader,
+           const gchar * const    *file_paths,
+           const gsize            *limits,
+           const gsize            *offsets,
+           guint                   n_files,
+           gssize                 *lengths)
+{
+  gint64 fds[READER_RING_ENTRIES];
+  gint64 results[READER_RING_ENTRIES];
+  guint count = 0;
+  guint i;
+
+  for (i = 0; i < n_files; i++)
+    {
+      struct io_uring_sqe *sqe;
+      sqe = get_sqe (reader, IORING_OP_OPENAT, i);
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (guint64) (guintptr) file_paths[i];
+      sqe->open_flags = READER_OPEN_FLAGS;
+    }
+
+  if (!submit_and_wait (reader, n_files, fds))
+    {
+      close_ring (reader);
+      return FALSE;
+    }
+
+  if (!stat_ring (reader, n_files, fds))
+    {
+      for (i = 0; i < n_files; i++)
+        if (fds[i] >= 0)
+          close (fds[i]);
+      close_ring (reader);
+      return FALSE;
+    }
+
+  for (i = 0; i < n_files; i++)
+    {
+      struct io_uring_sqe *sqe;
+
+      lengths[i] = -1;
+      if (fds[i] < 0)
+        continue;
+
+      sqe = get_sqe (reader, IORING_OP_READ, i);
+      sqe->fd = fds[i];
+      sqe->addr = (guint64) (guintptr) (reader->arena + offsets[i]);
+      sqe->len = limits[i];
+      sqe->off = 0;
+      count++;
+    }
+
+  if (count > 0 && !submit_and_wait (reader, count, results))
+    {
+      for (i = 0; i < n_files; i++)
+        if (fds[i] >= 0)
+          close (fds[i]);
+      close_ring (reader);
+      return FALSE;
+    }
+
+  for (i = 0; i < n_files; i++)
+    {
+      struct io_uring_sqe *sqe;
+
+      if (fds[i] < 0)
+        continue;
+
+      /* a short read is done again the plain way so the bytes match */
+      if (results[i] >= 0 && (gsize) results[i] < limits[i])
+        {
+          gsize filled = results[i];
+          while (filled < limits[i])
+            {
+              gssize bytes;
+              bytes = pread (fds[i], reader->arena + offsets[i] + filled, 
+                             limits[i] - filled, filled);
+              if (bytes < 0 && errno == EINTR)
+                continue;
+              if (bytes <= 0)
+                break;
+              filled += bytes;
+            }
+          results[i] = filled;
+        }
+
+      lengths[i] = results[i] < 0 ? -1 : results[i];
+
+      sqe = get_sqe (reader, IORING_OP_CLOSE, i);
+      sqe->fd = fds[i];
+    }
+
+  if (count > 0 && !submit_and_wait (reader, count, results))
+    {
+      close_ring (reader);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static struct io_uring_sqe*
+get_sqe (CodeSlayerSearchReader *reader,
+         guint8                  opcode,
+         guint                   index)
+{
+  struct io_uring_sqe *sqe;
+  guint32 slot;
+
+  slot = reader->sq_tail_local & *reader->sq_mask;
+  sqe = &reader->sqes[slot];
+  memset (sqe, 0, sizeof (struct io_uring_sqe));
+  sqe->opcode = opcode;
+  sqe->user_data = index;
+  reader->sq_array[slot] = slot;
+  reader->sq_tail_local++;
+
+  return sqe;
+}
+
+/*
+ * Hands the queued entries to the kernel and waits for all of them. The 
+ * result of every entry is put at the index it was queued with.
+ */
+static gboolean
+submit_and_wait (CodeSlayerSearchReader *reader,
+                 guint                   count,
+                 gint64                 *results)
+{
+  guint submitted = 0;
+  guint completed = 0;
+
+  __atomic_store_n (reader->sq_tail, reader->sq_tail_local, __ATOMIC_RELEASE);
+
+  while (completed < count)
+    {
+      guint32 head;
+      guint32 tail;
+      glong ret;
+
+      ret = syscall (__NR_io_uring_enter, reader->ring_fd, count - submitted, 
+                     count - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+      if (ret < 0 && errno != EINTR)
+        return FALSE;
+      if (ret > 0)
+        submitted += ret;
+
+      head = *reader->cq_head;
+      tail = __atomic_load_n (reader->cq_tail, __ATOMIC_ACQUIRE);
+      while (head != tail)
+        {
+          struct io_uring_cqe *cqe;
+          cqe = &reader->cqes[head & *reader->cq_mask];
+          results[cqe->user_data] = cqe->res;
+          head++;
+          completed++;
+        }
+      __atomic_store_n (reader->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+  return TRUE;
+}
+
+/*
+ * Leaves out every descriptor that is not a regular file, it is closed 
+ * and marked as failed. The types come from one statx call for the 
+ * batch, a kernel without it or an entry it fails on takes fstat.
+ */
+static gboolean
+stat_ring (CodeSlayerSearchReader *reader,
+           guint                   n_files,
+           gint64                 *fds)
+{
+  struct statx stats[READER_RING_ENTRIES];
+  gint64 results[READER_RING_ENTRIES];
+  guint count = 0;
+  guint i;
+
+  for (i = 0; reader->has_statx && i < n_files; i++)
+    {
+      struct io_uring_sqe *sqe;
+
+      results[i] = -1;
+      if (fds[i] < 0)
+        continue;
+
+      sqe = get_sqe (reader, IORING_OP_STATX, i);
+      sqe->fd = fds[i];
+      sqe->addr = (guint64) (guintptr) "";
+      sqe->len = STATX_TYPE;
+      sqe->statx_flags = AT_EMPTY_PATH;
+      /* the buffer goes where the offset would */
+      sqe->off = (guint64) (guintptr) &stats[i];
+      count++;
+    }
+
+  if (count > 0 && !submit_and_wait (reader, count, results))
+    return FALSE;
+
+  for (i = 0; i < n_files; i++)
+    {
+      gboolean regular;
+
+      if (fds[i] < 0)
+        continue;
+
+      if (count > 0 && results[i] == 0 && (stats[i].stx_mask & STATX_TYPE))
+        regular = S_ISREG (stats[i].stx_mode);
+      else
+        regular = is_regular (fds[i]);
+
+      if (!regular)
+        {
+          close (fds[i]);
+          fds[i] = -1;
+        }
+    }
+
+  return TRUE;
+}
+
+#endif
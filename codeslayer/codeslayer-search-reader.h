@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_READER_H__
+#define	__CODESLAYER_SEARCH_READER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchReader CodeSlayerSearchReader;
+
+/*
+ * Called once for every file in the order they were given. The length 
+ * is -1 if the file could not be opened or read, the contents are only 
+ * good until the function returns.
+ */
+typedef void (*CodeSlayerSearchReaderFunc) (guint        index,
+                                            const gchar *contents,
+                                            gssize       length,
+                                            gpointer     user_data);
+
+CodeSlayerSearchReader*  codeslayer_search_reader_new        (gboolean                    use_uring);
+void                     codeslayer_search_reader_free       (CodeSlayerSearchReader     *reader);
+gboolean                 codeslayer_search_reader_has_uring  (CodeSlayerSearchReader     *reader);
+void                     codeslayer_search_reader_read       (CodeSlayerSearchReader     *reader,
+                                                              const gchar * const        *file_paths,
+                                                              const gsize                *limits,
+                                                              guint                       n_files,
+                                                              CodeSlayerSearchReaderFunc  func,
+                                                              gpointer                    user_data);
+gint                     codeslayer_search_reader_open       (const gchar                *file_path);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_READER_H__ */
@@ -0,0 +1,903 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <codeslayer/codeslayer-search-replace.h>
+#include <codeslayer/codeslayer-utils.h>
+#include <codeslayer/codeslayer-search-matcher.h>
+#include <codeslayer/codeslayer-search-policy.h>
+#include <codeslayer/codeslayer-search-pool.h>
+
+/*
+ * Replaces text in many files at once. The preview reads every file on 
+ * the pool, works out the new contents and keeps them together with the 
+ * changed lines, so what is shown is exactly what gets written. The 
+ * commit then writes the files on the pool as well. Each file goes to a 
+ * temporary file in the same directory that takes over the mode and the 
+ * owner of the old one, and is renamed over it, so a reader sees either 
+ * the old file or the new one.
+ *
+ * Like the search the replace works one line at a time, a regular 
+ * expression can not match across lines.
+ */
+
+#define FILE_ATTRIBUTES "standard::size,time::modified,time::modified-usec,unix::mode,unix::uid,unix::gid"
+
+struct _CodeSlayerSearchReplace
+{
+  CodeSlayerSearchMatcher *matcher;
+  GRegex                  *regex;
+  gchar                   *replacement;
+  GPtrArray               *files;
+  GCancellable            *cancellable;
+  gint                     written;
+};
+
+struct _CodeSlayerSearchReplaceFile
+{
+  gchar    *file_path;
+  gchar    *contents;
+  gsize     length;
+  GArray   *lines;
+  guint     n_replaced;
+  gint64    mtime;
+  goffset   size;
+  gboolean  enabled;
+  gboolean  written;
+  gchar    *error;
+};
+
+static gchar* replace_lines      (CodeSlayerSearchReplace     *replace,
+                                  const gchar                 *text,
+                                  gsize                        length,
+                                  GArray                      *lines,
+                                  guint                       *n_replaced,
+                                  gsize                       *result_length);
+static const gchar* find_candidate (CodeSlayerSearchReplace   *replace,
+                                  const gchar                 *text,
+                                  gsize                        length);
+static guint replace_line        (CodeSlayerSearchReplace     *replace,
+                                  const gchar                 *line,
+                                  gsize                        length,
+                                  GString                     *result);
+static void find_line_edits      (CodeSlayerSearchReplace     *replace,
+                                  const gchar                 *line,
+                                  gsize                        length,
+                                  gsize                        line_offset,
+                                  GArray                      *edits);
+static void clear_edit           (CodeSlayerSearchReplaceEdit *edit);
+static void preview_file         (CodeSlayerSearchReplaceFile *file,
+                                  CodeSlayerSearchReplace     *replace);
+static void write_file           (CodeSlayerSearchReplaceFile *file,
+                                  CodeSlayerSearchReplace     *replace);
+static gboolean write_contents   (CodeSlayerSearchReplaceFile *file,
+                                  const gchar                 *target);
+static gint64 get_modification_time (GFileInfo                *file_info);
+static void free_file            (CodeSlayerSearchReplaceFile *file);
+static void set_error            (CodeSlayerSearchReplaceFile *file,
+                                  const gchar                 *message);
+
+/**
+ * codeslayer_search_replace_new:
+ * @literal: the plain text to replace, or %NULL when @regex is given.
+ * @regex: the regular expression to replace, or %NULL.
+ * @replacement: the new text. With @regex it can refer back to the groups 
+ *               of the match, as in g_regex_replace().
+ * @match_case: is FALSE to ignore the case of @literal.
+ * @error: a #GError, or %NULL.
+ *
+ * Returns: a new #CodeSlayerSearchReplace, or %NULL if there is nothing 
+ * to find or the replacement is not valid.
+ */
+CodeSlayerSearchReplace*
+codeslayer_search_replace_new (const gchar  *literal,
+                               GRegex       *regex,
+                               const gchar  *replacement,
+                               gboolean      match_case,
+                               GError      **error)
+{
+  CodeSlayerSearchReplace *replace;
+
+  if (regex == NULL && (literal == NULL || *literal == '\0'))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, 
+                           _("There is no text to replace"));
+      return NULL;
+    }
+
+  if (regex != NULL && !g_regex_check_replacement (replacement, NULL, error))
+    return NULL;
+
+  replace = g_malloc0 (sizeof (CodeSlayerSearchReplace));
+  replace->replacement = g_strdup (replacement);
+  replace->files = g_ptr_array_new_with_free_func ((GDestroyNotify) free_file);
+
+  if (regex != NULL)
+    {
+      replace->regex = g_regex_ref (regex);
+    }
+  else
+    replace->matcher = codeslayer_search_matcher_new (literal, match_case);
+
+  return replace;
+}
+
+/**
+ * codeslayer_search_replace_free:
+ * @replace: a #CodeSlayerSearchReplace.
+ */
+void
+codeslayer_search_replace_free (CodeSlayerSearchReplace *replace)
+{
+  if (replace->matcher != NULL)
+    codeslayer_search_matcher_free (replace->matcher);
+  if (replace->regex != NULL)
+    g_regex_unref (replace->regex);
+  g_ptr_array_free (replace->files, TRUE);
+  g_free (replace->replacement);
+  g_free (replace);
+}
+
+/**
+ * codeslayer_search_replace_text:
+ * @replace: a #CodeSlayerSearchReplace.
+ * @text: the text to replace in.
+ * @length: the length of @text in bytes.
+ * @n_replaced: (out) (allow-none): the number of replacements.
+ *
+ * Replaces the text the same way the files are, for a document that is 
+ * open in an editor.
+ *
+ * Returns: the new text, or %NULL if nothing was replaced.
+ */
+gchar*
+codeslayer_search_replace_text (CodeSlayerSearchReplace *replace,
+                                const gchar             *text,
+                                gsize                    length,
+                                guint                   *n_replaced)
+{
+  guint count = 0;
+  gchar *result;
+
+  result = replace_lines (replace, text, length, NULL, &count, NULL);
+
+  if (n_replaced != NULL)
+    *n_replaced = count;
+
+  return result;
+}
+
+/**
+ * codeslayer_search_replace_get_edits:
+ * @replace: a #CodeSlayerSearchReplace.
+ * @text: the text to replace in.
+ * @length: the length of @text in bytes.
+ *
+ * Finds every replacement in the text the same way the files are 
+ * replaced, so a document that is open in an editor can be changed 
+ * only where the hits are and keep its marks.
+ *
+ * Returns: the #CodeSlayerSearchReplaceEdit values in the order of the 
+ * text. Free with g_array_unref().
+ */
+GArray*
+codeslayer_search_replace_get_edits (CodeSlayerSearchReplace *replace,
+                                     const gchar             *text,
+                                     gsize                    length)
+{
+  const gchar *end = text + length;
+  const gchar *pos = text;
+  GArray *edits;
+
+  edits = g_array_new (FALSE, FALSE, sizeof (CodeSlayerSearchReplaceEdit));
+  g_array_set_clear_func (edits, (GDestroyNotify) clear_edit);
+
+  while (pos < end)
+    {
+      const gchar *candidate;
+      const gchar *line_start;
+      const gchar *line_end;
+
+      candidate = find_candidate (replace, pos, end - pos);
+      if (candidate == NULL)
+        break;
+
+      line_start = candidate;
+      while (line_start > pos && line_start[-1] != '\n')
+        line_start--;
+
+      line_end = memchr (candidate, '\n', end - candidate);
+      if (line_end == NULL)
+        line_end = end;
+
+      find_line_edits (replace, line_start, line_end - line_start, 
+                       line_start - text, edits);
+
+      pos = line_end < end ? line_end + 1 : end;
+    }
+
+  return edits;
+}
+
+/**
+ * codeslayer_search_replace_preview:
+ * @replace: a #CodeSlayerSearchReplace.
+ * @file_paths: a %NULL terminated list of the files to look at.
+ * @cancellable: a #GCancellable, or %NULL.
+ *
+ * Works out the replacements for all of the files in parallel. Only 
+ * the files with at least one replacement are kept, in the order they 
+ * were given. This blocks until every file is done.
+ */
+void
+codeslayer_search_replace_preview (CodeSlayerSearchReplace  *replace,
+                                   gchar                   **file_paths,
+                                   GCancellable             *cancellable)
+{
+  CodeSlayerSearchPool *pool;
+  GPtrArray *files;
+  guint i;
+
+  g_ptr_array_set_size (replace->files, 0);
+  replace->cancellable = cancellable;
+
+  files = g_ptr_array_new ();
+  for (i = 0; file_paths[i] != NULL; i++)
+    {
+      CodeSlayerSearchReplaceFile *file;
+      file = g_malloc0 (sizeof (CodeSlayerSearchReplaceFile));
+      file->file_path = g_strdup (file_paths[i]);
+      file->lines = g_array_new (FALSE, FALSE, sizeof (CodeSlayerSearchReplaceLine));
+      file->enabled = TRUE;
+      g_ptr_array_add (files, file);
+    }
+
+  pool = codeslayer_search_pool_new (0, (CodeSlayerSearchPoolFunc) preview_file, replace);
+  for (i = 0; i < files->len; i++)
+    codeslayer_search_pool_push (pool, g_ptr_array_index (files, i));
+  codeslayer_search_pool_wait (pool);
+  codeslayer_search_pool_free (pool);
+
+  for (i = 0; i < files->len; i++)
+    {
+      CodeSlayerSearchReplaceFile *file = g_ptr_array_index (files, i);
+      if (file->contents != NULL)
+        g_ptr_array_add (replace->files, file);
+      else
+        free_file (file);
+    }
+
+  g_ptr_array_free (files, TRUE);
+  replace->cancellable = NULL;
+}
+
+/**
+ * codeslayer_search_replace_commit:
+ * @replace: a #CodeSlayerSearchReplace.
+ * @cancellable: a #GCancellable, or %NULL.
+ *
+ * Writes the enabled files of the preview in parallel. A file that 
+ * changed on disk since the preview is left alone and gets an error.
+ *
+ * Returns: the number of files that were written.
+ */
+guint
+codeslayer_search_replace_commit (CodeSlayerSearchReplace *replace,
+                                  GCancellable            *cancellable)
+{
+  CodeSlayerSearchPool *pool;
+  guint i;
+
+  replace->cancellable = cancellable;
+  replace->written = 0;
+
+  pool = codeslayer_search_pool_new (0, (CodeSlayerSearchPoolFunc) write_file, replace);
+  for (i = 0; i < replace->files->len; i++)
+    {
+      CodeSlayerSearchReplaceFile *file = g_ptr_array_index (replace->files, i);
+      if (file->enabled && !file->written)
+        codeslayer_search_pool_push (pool, file);
+    }
+  codeslayer_search_pool_wait (pool);
+  codeslayer_search_pool_free (pool);
+
+  replace->cancellable = NULL;
+
+  return g_atomic_int_get (&replace->written);
+}
+
+/**
+ * codeslayer_search_replace_get_n_files:
+ * @replace: a #CodeSlayerSearchReplace.
+ *
+ * Returns: the number of files in the preview.
+ */
+guint
+codeslayer_search_replace_get_n_files (CodeSlayerSearchReplace *replace)
+{
+  return replace->files->len;
+}
+
+/**
+ * codeslayer_search_replace_get_file:
+ * @replace: a #CodeSlayerSearchReplace.
+ * @index: the position of the file in the preview.
+ *
+ * Returns: the #CodeSlayerSearchReplaceFile at @index.
+ */
+CodeSlayerSearchReplaceFile*
+codeslayer_search_replace_get_file (CodeSlayerSearchReplace *replace,
+                                    guint                    index)
+{
+  return g_ptr_array_index (replace->files, index);
+}
+
+/**
+ * codeslayer_search_replace_find_file:
+ * @replace: a #CodeSlayerSearchReplace.
+ * @file_path: the path of the file.
+ *
+ * Returns: the #CodeSlayerSearchReplaceFile for @file_path, or %NULL if 
+ * it is not in the preview.
+ */
+CodeSlayerSearchReplaceFile*
+codeslayer_search_replace_find_file (CodeSlayerSearchReplace *replace,
+                                     const gchar             *file_path)
+{
+  guint i;
+  for (i = 0; i < replace->files->len; i++)
+    {
+      CodeSlayerSearchReplaceFile *file = g_ptr_array_index (replace->files, i);
+      if (g_strcmp0 (file->file_path, file_path) == 0)
+        return file;
+    }
+  return NULL;
+}
+
+/**
+ * codeslayer_search_replace_file_get_path:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ *
+ * Returns: the path of the file.
+ */
+const gchar*
+codeslayer_search_replace_file_get_path (CodeSlayerSearchReplaceFile *file)
+{
+  return file->file_path;
+}
+
+/**
+ * codeslayer_search_replace_file_get_lines:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ *
+ * Returns: the changed lines as #CodeSlayerSearchReplaceLine values.
+ */
+GArray*
+codeslayer_search_replace_file_get_lines (CodeSlayerSearchReplaceFile *file)
+{
+  return file->lines;
+}
+
+/**
+ * codeslayer_search_replace_file_get_n_replaced:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ *
+ * Returns: the number of replacements in the file.
+ */
+guint
+codeslayer_search_replace_file_get_n_replaced (CodeSlayerSearchReplaceFile *file)
+{
+  return file->n_replaced;
+}
+
+/**
+ * codeslayer_search_replace_file_get_contents:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ * @length: (out) (allow-none): the length of the contents.
+ *
+ * Returns: the new contents of the file.
+ */
+const gchar*
+codeslayer_search_replace_file_get_contents (CodeSlayerSearchReplaceFile *file,
+                                             gsize                       *length)
+{
+  if (length != NULL)
+    *length = file->length;
+  return file->contents;
+}
+
+/**
+ * codeslayer_search_replace_file_get_enabled:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ *
+ * Returns: is TRUE if the file will be written on commit.
+ */
+gboolean
+codeslayer_search_replace_file_get_enabled (CodeSlayerSearchReplaceFile *file)
+{
+  return file->enabled;
+}
+
+/**
+ * codeslayer_search_replace_file_set_enabled:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ * @enabled: is FALSE to leave the file out of the commit.
+ */
+void
+codeslayer_search_replace_file_set_enabled (CodeSlayerSearchReplaceFile *file,
+                                            gboolean                     enabled)
+{
+  file->enabled = enabled;
+}
+
+/**
+ * codeslayer_search_replace_file_get_written:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ *
+ * Returns: is TRUE if the commit wrote the file.
+ */
+gboolean
+codeslayer_search_replace_file_get_written (CodeSlayerSearchReplaceFile *file)
+{
+  return file->written;
+}
+
+/**
+ * codeslayer_search_replace_file_get_error:
+ * @file: a #CodeSlayerSearchReplaceFile.
+ *
+ * Returns: why the file could not be written, or %NULL.
+ */
+const gchar*
+codeslayer_search_replace_file_get_error (CodeSlayerSearchReplaceFile *file)
+{
+  return file->error;
+}
+
+/*
+ * Jumps from one line with a match to the next and copies the lines in 
+ * between as they are. The result is only built once the first line 
+ * changes, so a text without a match costs no copy.
+ */
+static gchar*
+replace_lines (CodeSlayerSearchReplace *replace,
+               const gchar             *text,
+               gsize                    length,
+               GArray                  *lines,
+               guint                   *n_replaced,
+               gsize                   *result_length)
+{
+  const gchar *end = text + length;
+  const gchar *pos = text;
+  GString *result = NULL;
+  GString *line_result;
+  gint line_number = 1;
+
+  *n_replaced = 0;
+  line_result = g_string_new (NULL);
+
+  while (pos < end)
+    {
+      const gchar *candidate;
+      const gchar *line_start;
+      const gchar *line_end;
+      const gchar *next;
+      guint count;
+
+      if (replace->cancellable != NULL && g_cancellable_is_cancelled (replace->cancellable))
+        break;
+
+      candidate = find_candidate (replace, pos, end - pos);
+      if (candidate == NULL)
+        break;
+
+      line_start = candidate;
+      while (line_start > pos && line_start[-1] != '\n')
+        line_start--;
+
+      for (next = pos; (next = memchr (next, '\n', line_start - next)) != NULL; next++)
+        line_number++;
+
+      line_end = memchr (candidate, '\n', end - candidate);
+      if (line_end == NULL)
+        line_end = end;
+      next = line_end < end ? line_end + 1 : end;
+
+      g_string_truncate (line_result, 0);
+      count = replace_line (replace, line_start, line_end - line_start, line_result);
+
+      if (count > 0)
+        {
+          if (result == NULL)
+            {
+              result = g_string_sized_new (length + line_result->len);
+              g_string_append_len (result, text, line_start - text);
+            }
+          else
+            {
+              g_string_append_len (result, pos, line_start - pos);
+            }
+          g_string_append_len (result, line_result->str, line_result->len);
+          g_string_append_len (result, line_end, next - line_end);
+          *n_replaced += count;
+
+          if (lines != NULL)
+            {
+              CodeSlayerSearchReplaceLine line;
+              line.line_number = line_number;
+              line.before = g_strndup (line_start, line_end - line_start);
+              line.after = g_strndup (line_result->str, line_result->len);
+              g_array_append_val (lines, line);
+            }
+        }
+      else if (result != NULL)
+        {
+          /* a match across lines, which the line by line replace leaves */
+          g_string_append_len (result, pos, next - pos);
+        }
+
+      pos = next;
+      line_number++;
+    }
+
+  g_string_free (line_result, TRUE);
+
+  if (result == NULL || (replace->cancellable != NULL 
+                         && g_cancellable_is_cancelled (replace->cancellable)))
+    {
+      if (result != NULL)
+        g_string_free (result, TRUE);
+      *n_replaced = 0;
+      return NULL;
+    }
+
+  g_string_append_len (result, pos, end - pos);
+
+  if (result_length != NULL)
+    *result_length = result->len;
+
+  return g_string_free (result, FALSE);
+}
+
+/*
+ * Returns where the next match starts, or NULL if there is none.
+ */
+static const gchar*
+find_candidate (CodeSlayerSearchReplace *replace,
+                const gchar             *text,
+                gsize                    length)
+{
+  GMatchInfo *match_info;
+  gint start_pos;
+
+  if (replace->matcher != NULL)
+    {
+      gssize offset;
+      offset = codeslayer_search_matcher_find (replace->matcher, text, length);
+      return offset < 0 ? NULL : text + offset;
+    }
+
+  if (!g_regex_match_full (replace->regex, text, length, 0, 0, &match_info, NULL))
+    {
+      g_match_info_free (match_info);
+      return NULL;
+    }
+
+  g_match_info_fetch_pos (match_info, 0, &start_pos, NULL);
+  g_match_info_free (match_info);
+  return text + start_pos;
+}
+
+static guint
+replace_line (CodeSlayerSearchReplace *replace,
+              const gchar             *line,
+              gsize                    length,
+              GString                 *result)
+{
+  GArray *edits;
+  gsize pos = 0;
+  guint count;
+  guint i;
+
+  edits = g_array_new (FALSE, FALSE, sizeof (CodeSlayerSearchReplaceEdit));
+  g_array_set_clear_func (edits, (GDestroyNotify) clear_edit);
+
+  find_line_edits (replace, line, length, 0, edits);
+
+  for (i = 0; i < edits->len; i++)
+    {
+      CodeSlayerSearchReplaceEdit *edit;
+      edit = &g_array_index (edits, CodeSlayerSearchReplaceEdit, i);
+      g_string_append_len (result, line + pos, edit->offset - pos);
+      g_string_append (result, edit->text);
+      pos = edit->offset + edit->length;
+    }
+
+  g_string_append_len (result, line + pos, length - pos);
+
+  count = edits->len;
+  g_array_unref (edits);
+
+  return count;
+}
+
+/*
+ * The hits of one line. A regular expression goes through its matches 
+ * the way g_regex_replace_eval() does, and each replacement has its 
+ * references to the groups of the match expanded.
+ */
+static void
+find_line_edits (CodeSlayerSearchReplace *replace,
+                 const gchar             *line,
+                 gsize                    length,
+                 gsize                    line_offset,
+                 GArray                  *edits)
+{
+  CodeSlayerSearchReplaceEdit edit;
+
+  if (replace->regex != NULL)
+    {
+      GMatchInfo *match_info;
+
+      g_regex_match_full (replace->regex, line, length, 0, 0, &match_info, NULL);
+
+      while (g_match_info_matches (match_info))
+        {
+          gint start_pos, end_pos;
+
+          g_match_info_fetch_pos (match_info, 0, &start_pos, &end_pos);
+
+          edit.offset = line_offset + start_pos;
+          edit.length = end_pos - start_pos;
+          edit.text = g_match_info_expand_references (match_info, replace->replacement, NULL);
+          if (edit.text == NULL)
+            edit.text = g_strdup ("");
+          g_array_append_val (edits, edit);
+
+          g_match_info_next (match_info, NULL);
+        }
+
+      g_match_info_free (match_info);
+    }
+  else
+    {
+      gsize pos = 0;
+
+      while (pos < length)
+        {
+          gssize offset;
+          offset = codeslayer_search_matcher_find (replace->matcher, line + pos, length - pos);
+          if (offset < 0)
+            break;
+
+          /* without the case the match can be longer or shorter than the literal */
+          edit.offset = line_offset + pos + offset;
+          edit.length = codeslayer_search_matcher_get_length (replace->matcher, line + pos + offset, 
+                                                              length - pos - offset);
+          edit.text = g_strdup (replace->replacement);
+          g_array_append_val (edits, edit);
+
+          pos += offset + edit.length;
+        }
+    }
+}
+
+static void
+clear_edit (CodeSlayerSearchReplaceEdit *edit)
+{
+  g_free (edit->text);
+}
+
+static void
+preview_file (CodeSlayerSearchReplaceFile *file,
+              CodeSlayerSearchReplace     *replace)
+{
+  GMappedFile *mapped_file;
+  GFileInfo *file_info;
+  GFile *gfile;
+  const gchar *text;
+  gsize length;
+
+  if (replace->cancellable != NULL && g_cancellable_is_cancelled (replace->cancellable))
+    return;
+
+  gfile = g_file_new_for_path (file->file_path);
+  file_info = g_file_query_info (gfile, FILE_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  g_object_unref (gfile);
+
+  if (file_info == NULL)
+    return;
+
+  file->mtime = get_modification_time (file_info);
+  file->size = g_file_info_get_size (file_info);
+  g_object_unref (file_info);
+
+  mapped_file = g_mapped_file_new (file->file_path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return;
+
+  text = g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+
+  if (length > 0 && !codeslayer_search_policy_is_binary (text, length))
+    {
+      file->contents = replace_lines (replace, text, length, file->lines, 
+                                      &file->n_replaced, &file->length);
+    }
+
+  g_mapped_file_unref (mapped_file);
+}
+
+static void
+write_file (CodeSlayerSearchReplaceFile *file,
+            CodeSlayerSearchReplace     *replace)
+{
+  gchar *target;
+
+  if (replace->cancellable != NULL && g_cancellable_is_cancelled (replace->cancellable))
+    return;
+
+  /* write through a link rather than replace it */
+  target = realpath (file->file_path, NULL);
+  if (target == NULL)
+    {
+      set_error (file, g_strerror (errno));
+      return;
+    }
+
+  if (write_contents (file, target))
+    {
+      file->written = TRUE;
+      g_atomic_int_inc (&replace->written);
+    }
+
+  free (target);
+}
+
+static gboolean
+write_contents (CodeSlayerSearchReplaceFile *file,
+                const gchar                 *target)
+{
+  GFileInfo *file_info;
+  GFile *gfile;
+  gchar *dirname;
+  gchar *basename;
+  gchar *temp_path;
+  const gchar *pos;
+  gsize remaining;
+  guint32 mode;
+  gint fd;
+
+  gfile = g_file_new_for_path (target);
+  file_info = g_file_query_info (gfile, FILE_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  g_object_unref (gfile);
+
+  if (file_info == NULL)
+    {
+      set_error (file, _("The file is gone"));
+      return FALSE;
+    }
+
+  if (get_modification_time (file_info) != file->mtime 
+      || g_file_info_get_size (file_info) != file->size)
+    {
+      g_object_unref (file_info);
+      set_error (file, _("The file changed since the preview"));
+      return FALSE;
+    }
+
+  dirname = g_path_get_dirname (target);
+  basename = g_path_get_basename (target);
+  temp_path = g_strdup_printf ("%s/.%s.XXXXXX", dirname, basename);
+  g_free (dirname);
+  g_free (basename);
+
+  mode = g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_UNIX_MODE);
+
+  fd = g_mkstemp_full (temp_path, O_WRONLY, 0600);
+  if (fd == -1)
+    {
+      set_error (file, g_strerror (errno));
+      g_object_unref (file_info);
+      g_free (temp_path);
+      return FALSE;
+    }
+
+  pos = file->contents;
+  remaining = file->length;
+  while (remaining > 0)
+    {
+      gssize written;
+      written = write (fd, pos, remaining);
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written < 0)
+        break;
+      pos += written;
+      remaining -= written;
+    }
+
+  /* the owner can only be kept when we are allowed to, which is fine */
+  if (fchown (fd, g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_UNIX_UID),
+              g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_UNIX_GID)) != 0)
+    errno = 0;
+
+  g_object_unref (file_info);
+
+  if (remaining > 0 || fchmod (fd, mode & 07777) != 0 || fsync (fd) != 0)
+    {
+      set_error (file, g_strerror (errno));
+      close (fd);
+      g_unlink (temp_path);
+      g_free (temp_path);
+      return FALSE;
+    }
+
+  if (close (fd) != 0 || g_rename (temp_path, target) != 0)
+    {
+      set_error (file, g_strerror (errno));
+      g_unlink (temp_path);
+      g_free (temp_path);
+      return FALSE;
+    }
+
+  g_free (temp_path);
+  return TRUE;
+}
+
+static gint64
+get_modification_time (GFileInfo *file_info)
+{
+  gint64 mtime;
+  mtime = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  return mtime * G_USEC_PER_SEC 
+         + g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+static void
+set_error (CodeSlayerSearchReplaceFile *file,
+           const gchar                 *message)
+{
+  g_free (file->error);
+  file->error = g_strdup (message);
+}
+
+static void
+free_file (CodeSlayerSearchReplaceFile *file)
+{
+  guint i;
+
+  for (i = 0; i < file->lines->len; i++)
+    {
+      CodeSlayerSearchReplaceLine *line;
+      line = &g_array_index (file->lines, CodeSlayerSearchReplaceLine, i);
+      g_free (line->before);
+      g_free (line->after);
+    }
+
+  g_array_free (file->lines, TRUE);
+  g_free (file->file_path);
+  g_free (file->contents);
+  g_free (file->error);
+  g_free (file);
+}
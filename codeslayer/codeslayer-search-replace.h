@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_REPLACE_H__
+#define	__CODESLAYER_SEARCH_REPLACE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchReplace CodeSlayerSearchReplace;
+typedef struct _CodeSlayerSearchReplaceFile CodeSlayerSearchReplaceFile;
+
+typedef struct
+{
+  gint   line_number;
+  gchar *before;
+  gchar *after;
+} CodeSlayerSearchReplaceLine;
+
+typedef struct
+{
+  gsize  offset;
+  gsize  length;
+  gchar *text;
+} CodeSlayerSearchReplaceEdit;
+
+CodeSlayerSearchReplace*      codeslayer_search_replace_new              (const gchar                 *literal,
+                                                                          GRegex                      *regex,
+                                                                          const gchar                 *replacement,
+                                                                          gboolean                     match_case,
+                                                                          GError                     **error);
+void                          codeslayer_search_replace_free             (CodeSlayerSearchReplace     *replace);
+gchar*                        codeslayer_search_replace_text             (CodeSlayerSearchReplace     *replace,
+                                                                          const gchar                 *text,
+                                                                          gsize                        length,
+                                                                          guint                       *n_replaced);
+GArray*                       codeslayer_search_replace_get_edits        (CodeSlayerSearchReplace     *replace,
+                                                                          const gchar                 *text,
+                                                                          gsize                        length);
+void                          codeslayer_search_replace_preview          (CodeSlayerSearchReplace     *replace,
+                                                                          gchar                      **file_paths,
+                                                                          GCancellable                *cancellable);
+guint                         codeslayer_search_replace_commit           (CodeSlayerSearchReplace     *replace,
+                                                                          GCancellable                *cancellable);
+guint                         codeslayer_search_replace_get_n_files      (CodeSlayerSearchReplace     *replace);
+CodeSlayerSearchReplaceFile*  codeslayer_search_replace_get_file         (CodeSlayerSearchReplace     *replace,
+                                                                          guint                        index);
+CodeSlayerSearchReplaceFile*  codeslayer_search_replace_find_file        (CodeSlayerSearchReplace     *replace,
+                                                                          const gchar                 *file_path);
+
+const gchar*                  codeslayer_search_replace_file_get_path    (CodeSlayerSearchReplaceFile *file);
+GArray*                       codeslayer_search_replace_file_get_lines   (CodeSlayerSearchReplaceFile *file);
+guint                         codeslayer_search_replace_file_get_n_replaced (CodeSlayerSearchReplaceFile *file);
+const gchar*                  codeslayer_search_replace_file_get_contents (CodeSlayerSearchReplaceFile *file,
+                                                                          gsize                       *length);
+gboolean                      codeslayer_search_replace_file_get_enabled (CodeSlayerSearchReplaceFile *file);
+void                          codeslayer_search_replace_file_set_enabled (CodeSlayerSearchReplaceFile *file,
+                                                                          gboolean                     enabled);
+gboolean                      codeslayer_search_replace_file_get_written (CodeSlayerSearchReplaceFile *file);
+const gchar*                  codeslayer_search_replace_file_get_error   (CodeSlayerSearchReplaceFile *file);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_REPLACE_H__ */
@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <codeslayer/codeslayer-search-scanner.h>
+#include <codeslayer/codeslayer-search-policy.h>
+#include <codeslayer/codeslayer-search-reader.h>
+
+/*
+ * Finds the lines of a file that match without splitting the file into
+ * lines first. Regular files are memory mapped, or read in large blocks
+ * when the map fails. Anything else is left alone, a fifo or a device 
+ * could block the worker. The find function runs over the raw bytes, 
+ * newlines are only counted up to each hit and only the matching lines 
+ * are handed back to the caller.
+ *
+ * A cancelled scan stops reading at the next block. The find function
+ * is expected to give up on a mapped file by itself. A file that looks
+ * binary from its first block is not scanned at all.
+ *
+ * The caller can also be handed every block before it is searched, which
+ * lets the index take in a file the search reads anyway.
+ *
+ * Every worker keeps its read buffer from one stream to the next, only a
+ * buffer that grew for a very long line is given back.
+ */
+
+#define SCANNER_BUFFER_SIZE (1024 * 1024)
+#define SCANNER_BUFFER_KEEP (4 * SCANNER_BUFFER_SIZE)
+
+static CodeSlayerSearchScannerResult scan_stream (gint                             fd,
+                                                  GCancellable                    *cancellable,
+                                                  CodeSlayerSearchScannerCount    *count,
+                                                  CodeSlayerSearchScannerFindFunc  find_func,
+                                                  CodeSlayerSearchScannerLineFunc  line_func,
+                                                  CodeSlayerSearchScannerBlockFunc block_func,
+                                                  gpointer                         user_data);
+static gchar* take_buffer        (gsize                           *size);
+static void give_buffer          (gchar                           *buffer,
+                                  gsize                            size);
+static gint count_newlines       (const gchar                     *text,
+                                  gsize                            length);
+static guint64 count_lines       (const gchar                     *text,
+                                  gsize                            length,
+                                  gint                             line_number);
+static const gchar* find_last_newline (const gchar                *text,
+                                       gsize                       length);
+
+static GPrivate scanner_buffer = G_PRIVATE_INIT (g_free);
+static GPrivate scanner_buffer_size = G_PRIVATE_INIT (NULL);
+
+/**
+ * codeslayer_search_scanner_scan_file:
+ * @file_path: the file to scan.
+ * @cancellable: a #GCancellable, or %NULL.
+ * @count: (out) (allow-none): set to the bytes and lines that were 
+ *         scanned.
+ * @find_func: finds the next match in the text.
+ * @line_func: called for every line that has a match.
+ * @block_func: (allow-none): called with every block that is read.
+ * @user_data: passed to the functions.
+ *
+ * Returns: #CODESLAYER_SEARCH_SCANNER_FAILED if the file could not be 
+ * read or the scan was cancelled, #CODESLAYER_SEARCH_SCANNER_BINARY if 
+ * the file was skipped as binary.
+ */
+CodeSlayerSearchScannerResult
+codeslayer_search_scanner_scan_file (const gchar                     *file_path,
+                                     GCancellable                    *cancellable,
+                                     CodeSlayerSearchScannerCount    *count,
+                                     CodeSlayerSearchScannerFindFunc  find_func,
+                                     CodeSlayerSearchScannerLineFunc  line_func,
+                                     CodeSlayerSearchScannerBlockFunc block_func,
+                                     gpointer                         user_data)
+{
+  gint fd;
+
+  if (count != NULL)
+    count->bytes = count->lines = 0;
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return CODESLAYER_SEARCH_SCANNER_FAILED;
+
+  fd = codeslayer_search_reader_open (file_path);
+
+  return codeslayer_search_scanner_scan_fd (fd, cancellable, count, 
+                                            find_func, line_func, block_func, user_data);
+}
+
+/**
+ * codeslayer_search_scanner_scan_fd:
+ * @fd: the open file to scan, or -1 if it could not be opened.
+ * @cancellable: a #GCancellable, or %NULL.
+ * @count: (out) (allow-none): set to the bytes and lines that were 
+ *         scanned.
+ * @find_func: finds the next match in the text.
+ * @line_func: called for every line that has a match.
+ * @block_func: (allow-none): called with every block that is read.
+ * @user_data: passed to the functions.
+ *
+ * Same as codeslayer_search_scanner_scan_file() for a file that is 
+ * already open, which is closed when the scan is done.
+ *
+ * Returns: the same as codeslayer_search_scanner_scan_file().
+ */
+CodeSlayerSearchScannerResult
+codeslayer_search_scanner_scan_fd (gint                             fd,
+                                   GCancellable                    *cancellable,
+                                   CodeSlayerSearchScannerCount    *count,
+                                   CodeSlayerSearchScannerFindFunc  find_func,
+                                   CodeSlayerSearchScannerLineFunc  line_func,
+                                   CodeSlayerSearchScannerBlockFunc block_func,
+                                   gpointer                         user_data)
+{
+  CodeSlayerSearchScannerResult result;
+  GMappedFile *mapped_file;
+  struct stat st;
+
+  if (count != NULL)
+    count->bytes = count->lines = 0;
+
+  if (fd == -1)
+    return CODESLAYER_SEARCH_SCANNER_FAILED;
+
+  if (g_cancellable_is_cancelled (cancellable))
+    {
+      close (fd);
+      return CODESLAYER_SEARCH_SCANNER_FAILED;
+    }
+
+  if (fstat (fd, &st) == -1 || !S_ISREG (st.st_mode))
+    {
+      close (fd);
+      return CODESLAYER_SEARCH_SCANNER_FAILED;
+    }
+
+  if (st.st_size == 0)
+    {
+      close (fd);
+      return CODESLAYER_SEARCH_SCANNER_DONE;
+    }
+
+  mapped_file = g_mapped_file_new_from_fd (fd, FALSE, NULL);
+  if (mapped_file != NULL)
+    {
+      const gchar *contents;
+      gsize length;
+
+      contents = g_mapped_file_get_contents (mapped_file);
+      length = g_mapped_file_get_length (mapped_file);
+
+#ifdef POSIX_MADV_SEQUENTIAL
+      /* the mapping starts on a page, ask for a larger read ahead */
+      posix_madvise ((gpointer) contents, length, POSIX_MADV_SEQUENTIAL);
+#endif
+
+      result = codeslayer_search_scanner_scan_text (contents, length, cancellable, count,
+                                                   find_func, line_func, block_func, user_data);
+
+      g_mapped_file_unref (mapped_file);
+      close (fd);
+      return result;
+    }
+
+  result = scan_stream (fd, cancellable, count, find_func, line_func, block_func, user_data);
+  close (fd);
+
+  return result;
+}
+
+/**
+ * codeslayer_search_scanner_scan_text:
+ * @text: the whole contents of a file.
+ * @length: the length of the contents.
+ * @cancellable: a #GCancellable, or %NULL.
+ * @count: (out) (allow-none): set to the bytes and lines that were 
+ *         scanned.
+ * @find_func: finds the next match in the text.
+ * @line_func: called for every line that has a match.
+ * @block_func: (allow-none): called with every block that is read.
+ * @user_data: passed to the functions.
+ *
+ * Same as codeslayer_search_scanner_scan_file() for a file that was 
+ * already read.
+ *
+ * Returns: the same as codeslayer_search_scanner_scan_file().
+ */
+CodeSlayerSearchScannerResult
+codeslayer_search_scanner_scan_text (const gchar                     *text,
+                                     gsize                            length,
+                                     GCancellable                    *cancellable,
+                                     CodeSlayerSearchScannerCount    *count,
+                                     CodeSlayerSearchScannerFindFunc  find_func,
+                                     CodeSlayerSearchScannerLineFunc  line_func,
+                                     CodeSlayerSearchScannerBlockFunc block_func,
+                                     gpointer                         user_data)
+{
+  gint line_number;
+
+  if (count != NULL)
+    count->bytes = count->lines = 0;
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return CODESLAYER_SEARCH_SCANNER_FAILED;
+
+  if (codeslayer_search_policy_is_binary (text, length))
+    {
+      if (count != NULL)
+        count->bytes = MIN (length, CODESLAYER_SEARCH_POLICY_BLOCK_SIZE);
+      return CODESLAYER_SEARCH_SCANNER_BINARY;
+    }
+
+  if (block_func != NULL)
+    block_func (text, length, user_data);
+
+  line_number = codeslayer_search_scanner_scan_buffer (text, length, 1, 0,
+                                                       find_func, line_func, user_data);
+
+  if (count != NULL)
+    {
+      count->bytes = length;
+      count->lines = count_lines (text, length, line_number);
+    }
+
+  return CODESLAYER_SEARCH_SCANNER_DONE;
+}
+
+/**
+ * codeslayer_search_scanner_scan_buffer:
+ * @text: the text to scan.
+ * @length: the length of the text.
+ * @line_number: the line number of the first line in the text.
+ * @text_offset: the offset of the text in the file.
+ * @find_func: finds the next match in the text.
+ * @line_func: called for every line that has a match.
+ * @user_data: passed to both functions.
+ *
+ * Returns: the line number of the line following the text.
+ */
+gint
+codeslayer_search_scanner_scan_buffer (const gchar                     *text,
+                                       gsize                            length,
+                                       gint                             line_number,
+                                       goffset                          text_offset,
+                                       CodeSlayerSearchScannerFindFunc  find_func,
+                                       CodeSlayerSearchScannerLineFunc  line_func,
+                                       gpointer                         user_data)
+{
+  const gchar *end = text + length;
+  const gchar *pos = text;
+
+  /* pos is always at the start of a line */
+  while (pos < end)
+    {
+      const gchar *hit;
+      const gchar *line_start;
+      const gchar *line_end;
+      const gchar *newline;
+      gssize offset;
+
+      offset = find_func (pos, end - pos, user_data);
+      if (offset < 0 || offset >= end - pos)
+        break;
+
+      hit = pos + offset;
+      line_start = pos;
+
+      while ((newline = memchr (line_start, '\n', hit - line_start)) != NULL)
+        {
+          line_number++;
+          line_start = newline + 1;
+        }
+
+      line_end = memchr (hit, '\n', end - hit);
+      if (line_end == NULL)
+        line_end = end;
+
+      line_func (line_start, line_end - line_start, line_number, 
+                 text_offset + (line_start - text), user_data);
+
+      if (line_end == end)
+        {
+          pos = end;
+          break;
+        }
+
+      line_number++;
+      pos = line_end + 1;
+    }
+
+  return line_number + count_newlines (pos, end - pos);
+}
+
+static CodeSlayerSearchScannerResult
+scan_stream (gint                             fd,
+             GCancellable                    *cancellable,
+             CodeSlayerSearchScannerCount    *count,
+             CodeSlayerSearchScannerFindFunc  find_func,
+             CodeSlayerSearchScannerLineFunc  line_func,
+             CodeSlayerSearchScannerBlockFunc block_func,
+             gpointer                         user_data)
+{
+  gchar *buffer;
+  gsize size;
+  gsize filled = 0;
+  guint64 total = 0;
+  goffset offset = 0;
+  gint line_number = 1;
+  gboolean checked = FALSE;
+  CodeSlayerSearchScannerResult result = CODESLAYER_SEARCH_SCANNER_DONE;
+
+  buffer = take_buffer (&size);
+
+  while (TRUE)
+    {
+      const gchar *newline;
+      gssize bytes;
+      gsize complete;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        {
+          result = CODESLAYER_SEARCH_SCANNER_FAILED;
+          break;
+        }
+
+      bytes = read (fd, buffer + filled, size - filled);
+      if (bytes < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          result = CODESLAYER_SEARCH_SCANNER_FAILED;
+          break;
+        }
+
+      if (bytes == 0)
+        {
+          /* what is left is a last line without a newline */
+          if (filled > 0)
+            {
+              if (block_func != NULL)
+                block_func (buffer, filled, user_data);
+              line_number = codeslayer_search_scanner_scan_buffer (buffer, filled, line_number, offset,
+                                                                   find_func, line_func, user_data);
+            }
+          if (count != NULL)
+            count->lines = count_lines (buffer, filled, line_number);
+          break;
+        }
+
+      filled += bytes;
+      total += bytes;
+
+      /* only the first read is checked, like the first block of a mapped file */
+      if (!checked)
+        {
+          checked = TRUE;
+          if (codeslayer_search_policy_is_binary (buffer, filled))
+            {
+              result = CODESLAYER_SEARCH_SCANNER_BINARY;
+              break;
+            }
+        }
+
+      /* only hand over whole lines, the remainder waits for the next read */
+      newline = find_last_newline (buffer, filled);
+      if (newline == NULL)
+        {
+          if (filled == size)
+            {
+              size *= 2;
+              buffer = g_realloc (buffer, size);
+            }
+          continue;
+        }
+
+      complete = newline - buffer + 1;
+      if (block_func != NULL)
+        block_func (buffer, complete, user_data);
+      line_number = codeslayer_search_scanner_scan_buffer (buffer, complete, line_number, offset,
+                                                           find_func, line_func, user_data);
+      memmove (buffer, buffer + complete, filled - complete);
+      filled -= complete;
+      offset += complete;
+    }
+
+  give_buffer (buffer, size);
+
+  if (count != NULL)
+    count->bytes = total;
+
+  return result;
+}
+
+static gchar*
+take_buffer (gsize *size)
+{
+  gchar *buffer;
+
+  buffer = g_private_get (&scanner_buffer);
+  if (buffer == NULL)
+    {
+      *size = SCANNER_BUFFER_SIZE;
+      return g_malloc (*size);
+    }
+
+  /* the worker owns it until it gives it back */
+  g_private_set (&scanner_buffer, NULL);
+  *size = GPOINTER_TO_SIZE (g_private_get (&scanner_buffer_size));
+
+  return buffer;
+}
+
+static void
+give_buffer (gchar *buffer,
+             gsize  size)
+{
+  if (size > SCANNER_BUFFER_KEEP)
+    {
+      g_free (buffer);
+      return;
+    }
+
+  g_private_set (&scanner_buffer_size, GSIZE_TO_POINTER (size));
+  g_private_set (&scanner_buffer, buffer);
+}
+
+static gint
+count_newlines (const gchar *text,
+                gsize        length)
+{
+  const gchar *end = text + length;
+  const gchar *newline;
+  gint count = 0;
+
+  while (text < end && (newline = memchr (text, '\n', end - text)) != NULL)
+    {
+      count++;
+      text = newline + 1;
+    }
+
+  return count;
+}
+
+/*
+ * The line number that follows the text counts a last line that has 
+ * no newline as well.
+ */
+static guint64
+count_lines (const gchar *text,
+             gsize        length,
+             gint         line_number)
+{
+  if (length > 0 && text[length - 1] != '\n')
+    return line_number;
+  return line_number - 1;
+}
+
+static const gchar*
+find_last_newline (const gchar *text,
+                   gsize        length)
+{
+  while (length > 0)
+    {
+      length--;
+      if (text[length] == '\n')
+        return text + length;
+    }
+
+  return NULL;
+}
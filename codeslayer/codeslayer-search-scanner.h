@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_SCANNER_H__
+#define	__CODESLAYER_SEARCH_SCANNER_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  CODESLAYER_SEARCH_SCANNER_DONE = 0,
+  CODESLAYER_SEARCH_SCANNER_FAILED,
+  CODESLAYER_SEARCH_SCANNER_BINARY
+} CodeSlayerSearchScannerResult;
+
+/*
+ * How much of a file a scan went through.
+ */
+typedef struct
+{
+  guint64 bytes;
+  guint64 lines;
+} CodeSlayerSearchScannerCount;
+
+/*
+ * Returns the offset of the first match in the text, or -1 when there
+ * is none. The text is not nul terminated.
+ */
+typedef gssize (*CodeSlayerSearchScannerFindFunc) (const gchar *text,
+                                                   gsize        length,
+                                                   gpointer     user_data);
+
+/*
+ * Called once for every line that has a match. The line does not
+ * include the line terminator and is not nul terminated. The offset 
+ * is where the line starts in the file.
+ */
+typedef void (*CodeSlayerSearchScannerLineFunc) (const gchar *line,
+                                                 gsize        length,
+                                                 gint         line_number,
+                                                 goffset      offset,
+                                                 gpointer     user_data);
+
+/*
+ * Called with every block of the file before it is searched. A block 
+ * always ends at the end of a line or at the end of the file.
+ */
+typedef void (*CodeSlayerSearchScannerBlockFunc) (const gchar *text,
+                                                  gsize        length,
+                                                  gpointer     user_data);
+
+CodeSlayerSearchScannerResult  codeslayer_search_scanner_scan_file    (const gchar                      *file_path,
+                                                                       GCancellable                     *cancellable,
+                                                                       CodeSlayerSearchScannerCount     *count,
+                                                                       CodeSlayerSearchScannerFindFunc   find_func,
+                                                                       CodeSlayerSearchScannerLineFunc   line_func,
+                                                                       CodeSlayerSearchScannerBlockFunc  block_func,
+                                                                       gpointer                          user_data);
+CodeSlayerSearchScannerResult  codeslayer_search_scanner_scan_fd      (gint                              fd,
+                                                                       GCancellable                     *cancellable,
+                                                                       CodeSlayerSearchScannerCount     *count,
+                                                                       CodeSlayerSearchScannerFindFunc   find_func,
+                                                                       CodeSlayerSearchScannerLineFunc   line_func,
+                                                                       CodeSlayerSearchScannerBlockFunc  block_func,
+                                                                       gpointer                          user_data);
+CodeSlayerSearchScannerResult  codeslayer_search_scanner_scan_text    (const gchar                      *text,
+                                                                       gsize                             length,
+                                                                       GCancellable                     *cancellable,
+                                                                       CodeSlayerSearchScannerCount     *count,
+                                                                       CodeSlayerSearchScannerFindFunc   find_func,
+                                                                       CodeSlayerSearchScannerLineFunc   line_func,
+                                                                       CodeSlayerSearchScannerBlockFunc  block_func,
+                                                                       gpointer                          user_data);
+gint                           codeslayer_search_scanner_scan_buffer  (const gchar                      *text,
+                                                                       gsize                             length,
+                                                                       gint                              line_number,
+                                                                       goffset                           text_offset,
+                                                                       CodeSlayerSearchScannerFindFunc   find_func,
+                                                                       CodeSlayerSearchScannerLineFunc   line_func,
+                                                                       gpointer                          user_data);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_SCANNER_H__ */
@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <codeslayer/codeslayer-search-stats.h>
+
+/*
+ * Counts what a search went through and where its time went. Every 
+ * worker keeps its own counts and adds them to the search once for each 
+ * directory, so the counters are not fought over for every file.
+ *
+ * The time of a phase is added up over all of the workers, so together 
+ * the phases can take longer than the search itself. Reading a file 
+ * that is mapped happens while it is matched, that time goes to the 
+ * match phase. All of the times are in microseconds.
+ *
+ * The phases change for every file, which is too often to ask for the 
+ * CPU time of the thread each time. A timer only keeps the time of each 
+ * phase and the CPU time is sampled now and then, to be shared out over 
+ * the phases since the last sample by the time they took.
+ *
+ * The stats are counted by reference, so whoever gets them when the 
+ * search is finished can keep them after the signal.
+ */
+
+struct _CodeSlayerSearchStats
+{
+  GMutex                       mutex;
+  gint                         ref_count;
+  CodeSlayerSearchStatsCounts  counts;
+  gint64                       start_wall_time;
+  gint64                       start_cpu_time;
+  gint64                       total_wall_time;
+  gint64                       total_cpu_time;
+};
+
+static gint64 get_cpu_time  (clockid_t clock_id);
+
+G_DEFINE_BOXED_TYPE (CodeSlayerSearchStats, codeslayer_search_stats, 
+                     codeslayer_search_stats_ref, codeslayer_search_stats_unref)
+
+static const gchar *counter_names[CODESLAYER_SEARCH_STATS_COUNTER_LAST] = 
+{
+  "directories",
+  "directories_excluded",
+  "files_opened",
+  "files_excluded",
+  "bytes_read",
+  "lines_scanned",
+  "matches"
+};
+
+static const gchar *phase_names[CODESLAYER_SEARCH_STATS_PHASE_LAST] = 
+{
+  "walk",
+  "read",
+  "match",
+  "display"
+};
+
+/**
+ * codeslayer_search_stats_new:
+ *
+ * The search is timed from here on.
+ *
+ * Returns: a new #CodeSlayerSearchStats.
+ */
+CodeSlayerSearchStats*
+codeslayer_search_stats_new (void)
+{
+  CodeSlayerSearchStats *stats;
+  stats = g_malloc0 (sizeof (CodeSlayerSearchStats));
+  g_mutex_init (&stats->mutex);
+  stats->ref_count = 1;
+  stats->start_wall_time = g_get_monotonic_time ();
+  stats->start_cpu_time = get_cpu_time (CLOCK_PROCESS_CPUTIME_ID);
+  return stats;
+}
+
+/**
+ * codeslayer_search_stats_ref:
+ * @stats: a #CodeSlayerSearchStats.
+ *
+ * Returns: the @stats with one more reference.
+ */
+CodeSlayerSearchStats*
+codeslayer_search_stats_ref (CodeSlayerSearchStats *stats)
+{
+  g_atomic_int_inc (&stats->ref_count);
+  return stats;
+}
+
+/**
+ * codeslayer_search_stats_unref:
+ * @stats: a #CodeSlayerSearchStats.
+ *
+ * Frees the @stats when the last reference is gone.
+ */
+void
+codeslayer_search_stats_unref (CodeSlayerSearchStats *stats)
+{
+  if (!g_atomic_int_dec_and_test (&stats->ref_count))
+    return;
+
+  g_mutex_clear (&stats->mutex);
+  g_free (stats);
+}
+
+/**
+ * codeslayer_search_stats_merge:
+ * @stats: a #CodeSlayerSearchStats.
+ * @counts: the counts of a worker, which start over at zero.
+ */
+void
+codeslayer_search_stats_merge (CodeSlayerSearchStats       *stats,
+                               CodeSlayerSearchStatsCounts *counts)
+{
+  gint i;
+
+  g_mutex_lock (&stats->mutex);
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_COUNTER_LAST; i++)
+    stats->counts.counters[i] += counts->counters[i];
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_PHASE_LAST; i++)
+    {
+      stats->counts.wall_time[i] += counts->wall_time[i];
+      stats->counts.cpu_time[i] += counts->cpu_time[i];
+    }
+
+  g_mutex_unlock (&stats->mutex);
+
+  memset (counts, 0, sizeof (CodeSlayerSearchStatsCounts));
+}
+
+/**
+ * codeslayer_search_stats_finish:
+ * @stats: a #CodeSlayerSearchStats.
+ *
+ * Stops the time of the whole search.
+ */
+void
+codeslayer_search_stats_finish (CodeSlayerSearchStats *stats)
+{
+  stats->total_wall_time = g_get_monotonic_time () - stats->start_wall_time;
+  stats->total_cpu_time = get_cpu_time (CLOCK_PROCESS_CPUTIME_ID) - stats->start_cpu_time;
+}
+
+/**
+ * codeslayer_search_stats_get_counter:
+ * @stats: a #CodeSlayerSearchStats.
+ * @counter: the #CodeSlayerSearchStatsCounter to get.
+ *
+ * Returns: the count so far.
+ */
+guint64
+codeslayer_search_stats_get_counter (CodeSlayerSearchStats        *stats,
+                                     CodeSlayerSearchStatsCounter  counter)
+{
+  guint64 result;
+  g_mutex_lock (&stats->mutex);
+  result = stats->counts.counters[counter];
+  g_mutex_unlock (&stats->mutex);
+  return result;
+}
+
+/**
+ * codeslayer_search_stats_get_wall_time:
+ * @stats: a #CodeSlayerSearchStats.
+ * @phase: the #CodeSlayerSearchStatsPhase to get.
+ *
+ * Returns: the time spent in the phase, added up over the workers.
+ */
+gint64
+codeslayer_search_stats_get_wall_time (CodeSlayerSearchStats      *stats,
+                                       CodeSlayerSearchStatsPhase  phase)
+{
+  gint64 result;
+  g_mutex_lock (&stats->mutex);
+  result = stats->counts.wall_time[phase];
+  g_mutex_unlock (&stats->mutex);
+  return result;
+}
+
+/**
+ * codeslayer_search_stats_get_cpu_time:
+ * @stats: a #CodeSlayerSearchStats.
+ * @phase: the #CodeSlayerSearchStatsPhase to get.
+ *
+ * Returns: the CPU time the workers used in the phase.
+ */
+gint64
+codeslayer_search_stats_get_cpu_time (CodeSlayerSearchStats      *stats,
+                                      CodeSlayerSearchStatsPhase  phase)
+{
+  gint64 result;
+  g_mutex_lock (&stats->mutex);
+  result = stats->counts.cpu_time[phase];
+  g_mutex_unlock (&stats->mutex);
+  return result;
+}
+
+/**
+ * codeslayer_search_stats_get_total_wall_time:
+ * @stats: a #CodeSlayerSearchStats.
+ *
+ * Returns: the time from the start of the search until it was finished.
+ */
+gint64
+codeslayer_search_stats_get_total_wall_time (CodeSlayerSearchStats *stats)
+{
+  return stats->total_wall_time;
+}
+
+/**
+ * codeslayer_search_stats_get_total_cpu_time:
+ * @stats: a #CodeSlayerSearchStats.
+ *
+ * Returns: the CPU time the whole process used during the search.
+ */
+gint64
+codeslayer_search_stats_get_total_cpu_time (CodeSlayerSearchStats *stats)
+{
+  return stats->total_cpu_time;
+}
+
+/**
+ * codeslayer_search_stats_to_json:
+ * @stats: a #CodeSlayerSearchStats.
+ *
+ * Returns: the stats as a JSON object on a single line. Free with 
+ * g_free().
+ */
+gchar*
+codeslayer_search_stats_to_json (CodeSlayerSearchStats *stats)
+{
+  GDateTime *date_time;
+  GString *json;
+  gchar *time;
+  gint i;
+
+  date_time = g_date_time_new_now_local ();
+  time = g_date_time_format (date_time, "%Y-%m-%dT%H:%M:%S%z");
+  g_date_time_unref (date_time);
+
+  json = g_string_new (NULL);
+  g_string_append_printf (json, "{\"time\":\"%s\"", time);
+  g_free (time);
+
+  g_mutex_lock (&stats->mutex);
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_COUNTER_LAST; i++)
+    g_string_append_printf (json, ",\"%s\":%" G_GUINT64_FORMAT, 
+                            counter_names[i], stats->counts.counters[i]);
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_PHASE_LAST; i++)
+    g_string_append_printf (json, ",\"%s_wall_us\":%" G_GINT64_FORMAT ",\"%s_cpu_us\":%" G_GINT64_FORMAT, 
+                            phase_names[i], stats->counts.wall_time[i], 
+                            phase_names[i], stats->counts.cpu_time[i]);
+
+  g_mutex_unlock (&stats->mutex);
+
+  g_string_append_printf (json, ",\"total_wall_us\":%" G_GINT64_FORMAT ",\"total_cpu_us\":%" G_GINT64_FORMAT "}", 
+                          stats->total_wall_time, stats->total_cpu_time);
+
+  return g_string_free (json, FALSE);
+}
+
+/**
+ * codeslayer_search_stats_timer_start:
+ * @timer: a #CodeSlayerSearchStatsTimer.
+ *
+ * Times the calling thread from here on.
+ */
+void
+codeslayer_search_stats_timer_start (CodeSlayerSearchStatsTimer *timer)
+{
+  memset (timer, 0, sizeof (CodeSlayerSearchStatsTimer));
+  timer->wall_time = g_get_monotonic_time ();
+  timer->cpu_time = get_cpu_time (CLOCK_THREAD_CPUTIME_ID);
+}
+
+/**
+ * codeslayer_search_stats_timer_lap:
+ * @timer: a #CodeSlayerSearchStatsTimer.
+ * @counts: the counts to add the time to.
+ * @phase: the phase that took the time.
+ *
+ * Adds the time since the timer was started or last lapped to the phase.
+ * This is cheap enough to do for every file.
+ */
+void
+codeslayer_search_stats_timer_lap (CodeSlayerSearchStatsTimer  *timer,
+                                   CodeSlayerSearchStatsCounts *counts,
+                                   CodeSlayerSearchStatsPhase   phase)
+{
+  gint64 wall_time;
+
+  wall_time = g_get_monotonic_time ();
+  counts->wall_time[phase] += wall_time - timer->wall_time;
+  timer->pending[phase] += wall_time - timer->wall_time;
+  timer->wall_time = wall_time;
+}
+
+/**
+ * codeslayer_search_stats_timer_sample:
+ * @timer: a #CodeSlayerSearchStatsTimer.
+ * @counts: the counts to add the CPU time to.
+ *
+ * Shares the CPU time since the last sample out over the phases that 
+ * were lapped in between.
+ */
+void
+codeslayer_search_stats_timer_sample (CodeSlayerSearchStatsTimer  *timer,
+                                      CodeSlayerSearchStatsCounts *counts)
+{
+  gint64 cpu_time;
+  gint64 elapsed;
+  gint64 pending = 0;
+  gint i;
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_PHASE_LAST; i++)
+    pending += timer->pending[i];
+
+  if (pending == 0)
+    return;
+
+  cpu_time = get_cpu_time (CLOCK_THREAD_CPUTIME_ID);
+  elapsed = cpu_time - timer->cpu_time;
+  timer->cpu_time = cpu_time;
+
+  for (i = 0; i < CODESLAYER_SEARCH_STATS_PHASE_LAST; i++)
+    {
+      counts->cpu_time[i] += elapsed * timer->pending[i] / pending;
+      timer->pending[i] = 0;
+    }
+}
+
+static gint64
+get_cpu_time (clockid_t clock_id)
+{
+  struct timespec ts;
+
+  if (clock_gettime (clock_id, &ts) == -1)
+    return 0;
+
+  return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
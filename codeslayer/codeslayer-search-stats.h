@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_STATS_H__
+#define	__CODESLAYER_SEARCH_STATS_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define CODESLAYER_SEARCH_STATS_TYPE (codeslayer_search_stats_get_type ())
+
+typedef struct _CodeSlayerSearchStats CodeSlayerSearchStats;
+
+typedef enum
+{
+  CODESLAYER_SEARCH_STATS_DIRECTORIES = 0,
+  CODESLAYER_SEARCH_STATS_DIRECTORIES_EXCLUDED,
+  CODESLAYER_SEARCH_STATS_FILES_OPENED,
+  CODESLAYER_SEARCH_STATS_FILES_EXCLUDED,
+  CODESLAYER_SEARCH_STATS_BYTES_READ,
+  CODESLAYER_SEARCH_STATS_LINES_SCANNED,
+  CODESLAYER_SEARCH_STATS_MATCHES,
+  CODESLAYER_SEARCH_STATS_COUNTER_LAST
+} CodeSlayerSearchStatsCounter;
+
+typedef enum
+{
+  CODESLAYER_SEARCH_STATS_WALK = 0,
+  CODESLAYER_SEARCH_STATS_READ,
+  CODESLAYER_SEARCH_STATS_MATCH,
+  CODESLAYER_SEARCH_STATS_DISPLAY,
+  CODESLAYER_SEARCH_STATS_PHASE_LAST
+} CodeSlayerSearchStatsPhase;
+
+/*
+ * The counts of one worker, which are added to the search now and then
+ * so the workers do not share the counters on every file.
+ */
+typedef struct
+{
+  guint64 counters[CODESLAYER_SEARCH_STATS_COUNTER_LAST];
+  gint64  wall_time[CODESLAYER_SEARCH_STATS_PHASE_LAST];
+  gint64  cpu_time[CODESLAYER_SEARCH_STATS_PHASE_LAST];
+} CodeSlayerSearchStatsCounts;
+
+typedef struct
+{
+  gint64 wall_time;
+  gint64 cpu_time;
+  gint64 pending[CODESLAYER_SEARCH_STATS_PHASE_LAST];
+} CodeSlayerSearchStatsTimer;
+
+GType                   codeslayer_search_stats_get_type              (void) G_GNUC_CONST;
+CodeSlayerSearchStats*  codeslayer_search_stats_new                   (void);
+CodeSlayerSearchStats*  codeslayer_search_stats_ref                   (CodeSlayerSearchStats        *stats);
+void                    codeslayer_search_stats_unref                 (CodeSlayerSearchStats        *stats);
+void                    codeslayer_search_stats_merge                 (CodeSlayerSearchStats        *stats,
+                                                                       CodeSlayerSearchStatsCounts  *counts);
+void                    codeslayer_search_stats_finish                (CodeSlayerSearchStats        *stats);
+guint64                 codeslayer_search_stats_get_counter           (CodeSlayerSearchStats        *stats,
+                                                                       CodeSlayerSearchStatsCounter  counter);
+gint64                  codeslayer_search_stats_get_wall_time         (CodeSlayerSearchStats        *stats,
+                                                                       CodeSlayerSearchStatsPhase    phase);
+gint64                  codeslayer_search_stats_get_cpu_time          (CodeSlayerSearchStats        *stats,
+                                                                       CodeSlayerSearchStatsPhase    phase);
+gint64                  codeslayer_search_stats_get_total_wall_time   (CodeSlayerSearchStats        *stats);
+gint64                  codeslayer_search_stats_get_total_cpu_time    (CodeSlayerSearchStats        *stats);
+gchar*                  codeslayer_search_stats_to_json               (CodeSlayerSearchStats        *stats);
+void                    codeslayer_search_stats_timer_start           (CodeSlayerSearchStatsTimer   *timer);
+void                    codeslayer_search_stats_timer_lap             (CodeSlayerSearchStatsTimer   *timer,
+                                                                       CodeSlayerSearchStatsCounts  *counts,
+                                                                       CodeSlayerSearchStatsPhase    phase);
+void                    codeslayer_search_stats_timer_sample          (CodeSlayerSearchStatsTimer   *timer,
+                                                                       CodeSlayerSearchStatsCounts  *counts);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_STATS_H__ */
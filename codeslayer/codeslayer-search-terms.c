@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-terms.h>
+
+/*
+ * Finds any number of terms in one pass over the text with an 
+ * Aho-Corasick automaton. The automaton is built once per search and 
+ * then only read, so all of the workers share it.
+ *
+ * The bytes are first mapped to classes, one for every byte that shows 
+ * up in a term and one for all of the other bytes, which keeps the 
+ * transition table small enough to be fully expanded. Every step is 
+ * then a single lookup. Ignoring case puts the upper and lower case of 
+ * an ASCII letter in the same class.
+ */
+
+struct _CodeSlayerSearchTerms
+{
+  gchar  **terms;
+  guint    n_terms;
+  gsize   *lengths;
+  guint8   classes[256];
+  guint    n_classes;
+  gint32  *next;
+  gint32  *output;
+  gint32  *output_link;
+  guint    n_states;
+};
+
+static guint add_state  (GArray   *next,
+                         GArray   *output,
+                         guint     n_classes);
+
+/**
+ * codeslayer_search_terms_new:
+ * @entry: the terms as a comma separated list.
+ * @match_case: is FALSE to ignore the case of the terms.
+ *
+ * Returns: a new #CodeSlayerSearchTerms, or %NULL if the entry has no 
+ * terms.
+ */
+CodeSlayerSearchTerms*
+codeslayer_search_terms_new (const gchar *entry,
+                             gboolean     match_case)
+{
+  CodeSlayerSearchTerms *terms;
+  GArray *next;
+  GArray *output;
+  gint32 *fail;
+  guint *queue;
+  guint head, tail;
+  guint i, c;
+
+  terms = g_malloc0 (sizeof (CodeSlayerSearchTerms));
+  terms->terms = codeslayer_search_terms_split (entry);
+  terms->n_terms = g_strv_length (terms->terms);
+
+  if (terms->n_terms == 0)
+    {
+      codeslayer_search_terms_free (terms);
+      return NULL;
+    }
+
+  terms->lengths = g_malloc (terms->n_terms * sizeof (gsize));
+
+  /* class 0 is every byte that is in none of the terms */
+  terms->n_classes = 1;
+  for (i = 0; i < terms->n_terms; i++)
+    {
+      const guchar *term = (const guchar*) terms->terms[i];
+      terms->lengths[i] = strlen (terms->terms[i]);
+
+      for (; *term != '\0'; term++)
+        {
+          guchar b = match_case ? *term : g_ascii_tolower (*term);
+          if (terms->classes[b] == 0)
+            terms->classes[b] = terms->n_classes++;
+        }
+    }
+
+  if (!match_case)
+    {
+      for (c = 'a'; c <= 'z'; c++)
+        terms->classes[g_ascii_toupper (c)] = terms->classes[c];
+    }
+
+  /* the trie, -1 is a missing edge until the automaton is completed */
+  next = g_array_new (FALSE, FALSE, sizeof (gint32));
+  output = g_array_new (FALSE, FALSE, sizeof (gint32));
+  add_state (next, output, terms->n_classes);
+
+  for (i = 0; i < terms->n_terms; i++)
+    {
+      const guchar *term = (const guchar*) terms->terms[i];
+      guint state = 0;
+
+      for (; *term != '\0'; term++)
+        {
+          gint32 *edge;
+          edge = &g_array_index (next, gint32, state * terms->n_classes + terms->classes[*term]);
+          if (*edge == -1)
+            {
+              guint child;
+              child = add_state (next, output, terms->n_classes);
+              /* the array may have moved */
+              edge = &g_array_index (next, gint32, state * terms->n_classes + terms->classes[*term]);
+              *edge = child;
+            }
+          state = *edge;
+        }
+
+      /* a repeated term keeps the first one */
+      if (g_array_index (output, gint32, state) == -1)
+        g_array_index (output, gint32, state) = i;
+    }
+
+  terms->n_states = output->len;
+  terms->next = (gint32*) g_array_free (next, FALSE);
+  terms->output = (gint32*) g_array_free (output, FALSE);
+  terms->output_link = g_malloc (terms->n_states * sizeof (gint32));
+  fail = g_malloc0 (terms->n_states * sizeof (gint32));
+  queue = g_malloc (terms->n_states * sizeof (guint));
+  head = tail = 0;
+
+  /* breadth first, so the fail state of every state is done before it */
+  terms->output_link[0] = -1;
+  for (c = 0; c < terms->n_classes; c++)
+    {
+      gint32 child = terms->next[c];
+      if (child == -1)
+        {
+          terms->next[c] = 0;
+        }
+      else
+        {
+          fail[child] = 0;
+          terms->output_link[child] = -1;
+          queue[tail++] = child;
+        }
+    }
+
+  while (head < tail)
+    {
+      guint state = queue[head++];
+
+      for (c = 0; c < terms->n_classes; c++)
+        {
+          gint32 *edge = &terms->next[state * terms->n_classes + c];
+          gint32 fallback = terms->next[fail[state] * terms->n_classes + c];
+
+          if (*edge == -1)
+            {
+              *edge = fallback;
+            }
+          else
+            {
+              gint32 child = *edge;
+              fail[child] = fallback;
+              terms->output_link[child] = terms->output[fallback] != -1 
+                                          ? fallback : terms->output_link[fallback];
+              queue[tail++] = child;
+            }
+        }
+    }
+
+  g_free (fail);
+  g_free (queue);
+
+  return terms;
+}
+
+/**
+ * codeslayer_search_terms_free:
+ * @terms: a #CodeSlayerSearchTerms.
+ */
+void
+codeslayer_search_terms_free (CodeSlayerSearchTerms *terms)
+{
+  g_strfreev (terms->terms);
+  g_free (terms->lengths);
+  g_free (terms->next);
+  g_free (terms->output);
+  g_free (terms->output_link);
+  g_free (terms);
+}
+
+/**
+ * codeslayer_search_terms_find:
+ * @terms: a #CodeSlayerSearchTerms.
+ * @text: the text to search.
+ * @length: the length of the text.
+ *
+ * Returns: the offset of the first term that ends in the text, or -1 
+ * when there is none.
+ */
+gssize
+codeslayer_search_terms_find (CodeSlayerSearchTerms *terms,
+                              const gchar           *text,
+                              gsize                  length)
+{
+  return codeslayer_search_terms_find_match (terms, text, length, NULL);
+}
+
+/**
+ * codeslayer_search_terms_find_match:
+ * @terms: a #CodeSlayerSearchTerms.
+ * @text: the text to search.
+ * @length: the length of the text.
+ * @match_length: (out) (allow-none): the length of the term found.
+ *
+ * Returns: the same as codeslayer_search_terms_find().
+ */
+gssize
+codeslayer_search_terms_find_match (CodeSlayerSearchTerms *terms,
+                                    const gchar           *text,
+                                    gsize                  length,
+                                    gsize                 *match_length)
+{
+  const guchar *pos = (const guchar*) text;
+  const guchar *end = pos + length;
+  const gint32 *next = terms->next;
+  const guint8 *classes = terms->classes;
+  guint n_classes = terms->n_classes;
+  gint32 state = 0;
+
+  for (; pos < end; pos++)
+    {
+      gint32 term;
+
+      state = next[state * n_classes + classes[*pos]];
+
+      term = terms->output[state];
+      if (term == -1 && terms->output_link[state] != -1)
+        term = terms->output[terms->output_link[state]];
+
+      if (term != -1)
+        {
+          if (match_length != NULL)
+            *match_length = terms->lengths[term];
+          return (pos + 1 - terms->lengths[term]) - (const guchar*) text;
+        }
+    }
+
+  return -1;
+}
+
+/**
+ * codeslayer_search_terms_get_matches:
+ * @terms: a #CodeSlayerSearchTerms.
+ * @text: the text to search.
+ * @length: the length of the text.
+ * @matches: a #GArray of #guint that the terms found are appended to.
+ *
+ * Every term is added once, in the order it first shows up in the text.
+ */
+void
+codeslayer_search_terms_get_matches (CodeSlayerSearchTerms *terms,
+                                     const gchar           *text,
+                                     gsize                  length,
+                                     GArray                *matches)
+{
+  const guchar *pos = (const guchar*) text;
+  const guchar *end = pos + length;
+  gint32 state = 0;
+
+  for (; pos < end; pos++)
+    {
+      gint32 found;
+
+      state = terms->next[state * terms->n_classes + terms->classes[*pos]];
+      found = terms->output[state] != -1 ? state : terms->output_link[state];
+
+      while (found != -1)
+        {
+          guint term = terms->output[found];
+          guint i;
+
+          for (i = 0; i < matches->len; i++)
+            {
+              if (g_array_index (matches, guint, i) == term)
+                break;
+            }
+          if (i == matches->len)
+            g_array_append_val (matches, term);
+
+          found = terms->output_link[found];
+        }
+    }
+}
+
+/**
+ * codeslayer_search_terms_get_length:
+ * @terms: a #CodeSlayerSearchTerms.
+ *
+ * Returns: the number of terms.
+ */
+guint
+codeslayer_search_terms_get_length (CodeSlayerSearchTerms *terms)
+{
+  return terms->n_terms;
+}
+
+/**
+ * codeslayer_search_terms_get_term:
+ * @terms: a #CodeSlayerSearchTerms.
+ * @term: the index of the term.
+ *
+ * Returns: the term as it was entered.
+ */
+const gchar*
+codeslayer_search_terms_get_term (CodeSlayerSearchTerms *terms,
+                                  guint                  term)
+{
+  return terms->terms[term];
+}
+
+/**
+ * codeslayer_search_terms_split:
+ * @entry: the terms as a comma separated list.
+ *
+ * Returns: the terms without the surrounding space and the empty ones.
+ * Free with g_strfreev().
+ */
+gchar**
+codeslayer_search_terms_split (const gchar *entry)
+{
+  gchar **split;
+  gint i, j;
+
+  split = g_strsplit (entry, ",", 0);
+
+  for (i = 0, j = 0; split[i] != NULL; i++)
+    {
+      g_strstrip (split[i]);
+      if (*split[i] == '\0')
+        g_free (split[i]);
+      else
+        split[j++] = split[i];
+    }
+  split[j] = NULL;
+
+  return split;
+}
+
+static guint
+add_state (GArray *next,
+           GArray *output,
+           guint   n_classes)
+{
+  gint32 none = -1;
+  guint i;
+
+  for (i = 0; i < n_classes; i++)
+    g_array_append_val (next, none);
+  g_array_append_val (output, none);
+
+  return output->len - 1;
+}
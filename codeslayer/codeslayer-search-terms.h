@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_TERMS_H__
+#define	__CODESLAYER_SEARCH_TERMS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CodeSlayerSearchTerms CodeSlayerSearchTerms;
+
+CodeSlayerSearchTerms*  codeslayer_search_terms_new          (const gchar           *entry,
+                                                              gboolean               match_case);
+void                    codeslayer_search_terms_free         (CodeSlayerSearchTerms *terms);
+gssize                  codeslayer_search_terms_find         (CodeSlayerSearchTerms *terms,
+                                                              const gchar           *text,
+                                                              gsize                  length);
+gssize                  codeslayer_search_terms_find_match   (CodeSlayerSearchTerms *terms,
+                                                              const gchar           *text,
+                                                              gsize                  length,
+                                                              gsize                 *match_length);
+void                    codeslayer_search_terms_get_matches  (CodeSlayerSearchTerms *terms,
+                                                              const gchar           *text,
+                                                              gsize                  length,
+                                                              GArray                *matches);
+guint                   codeslayer_search_terms_get_length   (CodeSlayerSearchTerms *terms);
+const gchar*            codeslayer_search_terms_get_term     (CodeSlayerSearchTerms *terms,
+                                                              guint                  term);
+gchar**                 codeslayer_search_terms_split        (const gchar           *entry);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_TERMS_H__ */
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <codeslayer/codeslayer-search-visited.h>
+
+/*
+ * Keeps one walk over the projects from going over the same files twice.
+ *
+ * A project that sits inside another project is walked by itself, so
+ * the walk of the outer project does not go into the folder of the
+ * inner one. The folders are known up front, so this costs a lookup
+ * of the path of a directory.
+ *
+ * What the paths do not show, a project that is a link into another
+ * one, a bind mount or a hard link, is caught by the device and the
+ * inode. Every directory is recorded, but a file only when it has more
+ * than one link, since a file with a single link can only be reached
+ * again through its directory.
+ *
+ * The workers of a search share it, so the records are locked.
+ */
+
+typedef struct
+{
+  guint64 device;
+  guint64 inode;
+} VisitedId;
+
+struct _CodeSlayerSearchVisited
+{
+  GMutex      mutex;
+  GHashTable *ids;
+  GHashTable *folder_paths;
+};
+
+static guint     visited_id_hash   (const VisitedId *id);
+static gboolean  visited_id_equal  (const VisitedId *id1,
+                                    const VisitedId *id2);
+static gchar*    get_clean_path    (const gchar     *path);
+
+/**
+ * codeslayer_search_visited_new:
+ * @folder_paths: the folders of all of the projects that are walked.
+ *
+ * Returns: a new #CodeSlayerSearchVisited.
+ */
+CodeSlayerSearchVisited*
+codeslayer_search_visited_new (GList *folder_paths)
+{
+  CodeSlayerSearchVisited *visited;
+
+  visited = g_malloc (sizeof (CodeSlayerSearchVisited));
+  g_mutex_init (&visited->mutex);
+  visited->ids = g_hash_table_new_full ((GHashFunc) visited_id_hash,
+                                        (GEqualFunc) visited_id_equal,
+                                        g_free, NULL);
+  visited->folder_paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (; folder_paths != NULL; folder_paths = folder_paths->next)
+    g_hash_table_add (visited->folder_paths, get_clean_path (folder_paths->data));
+
+  return visited;
+}
+
+/**
+ * codeslayer_search_visited_free:
+ * @visited: a #CodeSlayerSearchVisited.
+ */
+void
+codeslayer_search_visited_free (CodeSlayerSearchVisited *visited)
+{
+  g_hash_table_destroy (visited->ids);
+  g_hash_table_destroy (visited->folder_paths);
+  g_mutex_clear (&visited->mutex);
+  g_free (visited);
+}
+
+/**
+ * codeslayer_search_visited_add:
+ * @visited: a #CodeSlayerSearchVisited.
+ * @file_info: a file with the #CODESLAYER_SEARCH_VISITED_ATTRIBUTES.
+ *
+ * Returns: FALSE if the file was already reached in this walk.
+ */
+gboolean
+codeslayer_search_visited_add (CodeSlayerSearchVisited *visited,
+                               GFileInfo               *file_info)
+{
+  VisitedId id;
+  gboolean added;
+
+  /* not every file system has inodes */
+  if (!g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_UNIX_INODE))
+    return TRUE;
+
+  if (g_file_info_get_file_type (file_info) != G_FILE_TYPE_DIRECTORY
+      && g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_UNIX_NLINK) <= 1)
+    return TRUE;
+
+  id.device = g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+  id.inode = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_UNIX_INODE);
+
+  g_mutex_lock (&visited->mutex);
+  added = !g_hash_table_contains (visited->ids, &id);
+  if (added)
+    {
+      VisitedId *key = g_new (VisitedId, 1);
+      *key = id;
+      g_hash_table_add (visited->ids, key);
+    }
+  g_mutex_unlock (&visited->mutex);
+
+  return added;
+}
+
+/**
+ * codeslayer_search_visited_add_folder:
+ * @visited: a #CodeSlayerSearchVisited.
+ * @folder_path: a folder the walk starts from.
+ *
+ * The folder is followed if it is a link.
+ *
+ * Returns: FALSE if the folder was already reached in this walk.
+ */
+gboolean
+codeslayer_search_visited_add_folder (CodeSlayerSearchVisited *visited,
+                                      const gchar             *folder_path)
+{
+  GFile *file;
+  GFileInfo *file_info;
+  gboolean added = TRUE;
+
+  file = g_file_new_for_path (folder_path);
+  file_info = g_file_query_info (file, CODESLAYER_SEARCH_VISITED_ATTRIBUTES,
+                                 G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (file_info != NULL)
+    {
+      added = codeslayer_search_visited_add (visited, file_info);
+      g_object_unref (file_info);
+    }
+
+  g_object_unref (file);
+  return added;
+}
+
+/**
+ * codeslayer_search_visited_is_project_folder:
+ * @visited: a #CodeSlayerSearchVisited.
+ * @folder_path: the directory that is walked.
+ * @file_name: the name of a directory in it.
+ *
+ * Returns: TRUE if the directory is the folder of a project, which is
+ * walked with its own project.
+ */
+gboolean
+codeslayer_search_visited_is_project_folder (CodeSlayerSearchVisited *visited,
+                                             const gchar             *folder_path,
+                                             const gchar             *file_name)
+{
+  gchar *file_path;
+  gboolean result;
+
+  /* the folder of the project itself is never under it */
+  if (g_hash_table_size (visited->folder_paths) < 2)
+    return FALSE;
+
+  file_path = g_build_filename (folder_path, file_name, NULL);
+  result = g_hash_table_contains (visited->folder_paths, file_path);
+  g_free (file_path);
+
+  return result;
+}
+
+/**
+ * codeslayer_search_visited_is_nested:
+ * @visited: a #CodeSlayerSearchVisited.
+ * @project_path: the folder of a project.
+ * @file_path: a file in the project.
+ *
+ * Returns: TRUE if the file is also under a project inside the project,
+ * which then has the file.
+ */
+gboolean
+codeslayer_search_visited_is_nested (CodeSlayerSearchVisited *visited,
+                                     const gchar             *project_path,
+                                     const gchar             *file_path)
+{
+  gchar *project;
+  gchar *path;
+  gsize length;
+  gboolean result = FALSE;
+
+  if (g_hash_table_size (visited->folder_paths) < 2)
+    return FALSE;
+
+  project = get_clean_path (project_path);
+  path = get_clean_path (file_path);
+  length = strlen (project);
+
+  while (strlen (path) > length && strncmp (path, project, length) == 0)
+    {
+      gchar *parent;
+
+      if (g_hash_table_contains (visited->folder_paths, path))
+        {
+          result = TRUE;
+          break;
+        }
+
+      parent = g_path_get_dirname (path);
+      g_free (path);
+      path = parent;
+    }
+
+  g_free (project);
+  g_free (path);
+
+  return result;
+}
+
+static guint
+visited_id_hash (const VisitedId *id)
+{
+  return (guint) (id->inode ^ (id->inode >> 32)) ^ (guint) (id->device * 31);
+}
+
+static gboolean
+visited_id_equal (const VisitedId *id1,
+                  const VisitedId *id2)
+{
+  return id1->inode == id2->inode && id1->device == id2->device;
+}
+
+/*
+ * The same path the walk builds, without a trailing separator or dots.
+ */
+static gchar*
+get_clean_path (const gchar *path)
+{
+  GFile *file;
+  gchar *clean_path;
+
+  file = g_file_new_for_path (path);
+  clean_path = g_file_get_path (file);
+  g_object_unref (file);
+
+  return clean_path;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __CODESLAYER_SEARCH_VISITED_H__
+#define	__CODESLAYER_SEARCH_VISITED_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define CODESLAYER_SEARCH_VISITED_ATTRIBUTES "standard::type,unix::device,unix::inode,unix::nlink"
+
+typedef struct _CodeSlayerSearchVisited CodeSlayerSearchVisited;
+
+CodeSlayerSearchVisited*  codeslayer_search_visited_new                (GList                   *folder_paths);
+void                      codeslayer_search_visited_free               (CodeSlayerSearchVisited *visited);
+gboolean                  codeslayer_search_visited_add                (CodeSlayerSearchVisited *visited,
+                                                                        GFileInfo               *file_info);
+gboolean                  codeslayer_search_visited_add_folder         (CodeSlayerSearchVisited *visited,
+                                                                        const gchar             *folder_path);
+gboolean                  codeslayer_search_visited_is_project_folder  (CodeSlayerSearchVisited *visited,
+                                                                        const gchar             *folder_path,
+                                                                        const gchar             *file_name);
+gboolean                  codeslayer_search_visited_is_nested          (CodeSlayerSearchVisited *visited,
+                                                                        const gchar             *project_path,
+                                                                        const gchar             *file_path);
+
+G_END_DECLS
+
+#endif /* __CODESLAYER_SEARCH_VISITED_H__ */
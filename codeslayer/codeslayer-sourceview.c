@@ -16,6 +16,7 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <string.h>
 #include <gdk/gdkkeysyms.h>
 #include <gtksourceview/gtksource.h>
 #include <gtksourceview/gtksourceview.h>
@@ -438,6 +439,62 @@ codeslayer_source_view_scroll_to_line (CodeSlayerSourceView *source_view,
   return TRUE;
 }
 
+/**
+ * codeslayer_source_view_select_match:
+ * @source_view: a #CodeSlayerSourceView.
+ * @line_number: the line the match is on.
+ * @match_offset: the byte offset of the match into the line.
+ * @match_length: the number of bytes of the match.
+ *
+ * Scrolls to the line and selects the match on it. When the line does 
+ * not have the range, because the text was edited or converted to UTF-8 
+ * when it was loaded, the line is only scrolled to.
+ */
+gboolean
+codeslayer_source_view_select_match (CodeSlayerSourceView *source_view, 
+                                     gint                  line_number,
+                                     gint                  match_offset,
+                                     gint                  match_length)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter start;
+  GtkTextIter end;
+  gchar *text;
+  gint length;
+  
+  if (!codeslayer_source_view_scroll_to_line (source_view, line_number))
+    return FALSE;
+
+  if (match_length <= 0)
+    return TRUE;
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  gtk_text_buffer_get_iter_at_line (buffer, &start, line_number - 1);
+  end = start;
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  /* the line index has to fall on a character */
+  text = gtk_text_iter_get_text (&start, &end);
+  length = strlen (text);
+  if (match_offset + match_length > length
+      || (text[match_offset] & 0xC0) == 0x80
+      || (text[match_offset + match_length] & 0xC0) == 0x80)
+    {
+      g_free (text);
+      return TRUE;
+    }
+  g_free (text);
+
+  gtk_text_iter_set_line_index (&start, match_offset);
+  end = start;
+  gtk_text_iter_set_line_index (&end, match_offset + match_length);
+  gtk_text_buffer_select_range (buffer, &start, &end);
+
+  return TRUE;
+}
+
 /**
  * codeslayer_source_view_sync_registry:
  * @source_view: a #CodeSlayerSourceView.
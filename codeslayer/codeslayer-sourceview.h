@@ -70,6 +70,10 @@ void                 codeslayer_source_view_set_text                 (CodeSlayer
                                                                       gchar                        *text);
 gboolean             codeslayer_source_view_scroll_to_line           (CodeSlayerSourceView         *source_view,
                                                                       gint                          line_number);
+gboolean             codeslayer_source_view_select_match             (CodeSlayerSourceView         *source_view,
+                                                                      gint                          line_number,
+                                                                      gint                          match_offset,
+                                                                      gint                          match_length);
 void                 codeslayer_source_view_sync_registry            (CodeSlayerSourceView         *source_view);
 
 G_END_DECLS
@@ -56,6 +56,8 @@ static void document_switched_action          (CodeSlayer           *codeslayer,
                                                GtkWidget            *child,
                                                guint                 page_num);
 static void projects_changed_action           (CodeSlayer           *codeslayer);
+static void search_finished_action            (CodeSlayer           *codeslayer,
+                                               CodeSlayerSearchStats *stats);
 static void verify_project_config_dir_exists  (CodeSlayerProject    *project);
 
 #define CODESLAYER_GET_PRIVATE(obj) \
@@ -86,6 +88,7 @@ enum
   PROJECT_PROPERTIES_OPENED,
   PROJECT_PROPERTIES_SAVED,
   PROJECTS_CHANGED,
+  SEARCH_FINISHED,
   LAST_SIGNAL
 };
 
@@ -215,6 +218,22 @@ codeslayer_class_init (CodeSlayerClass *klass)
                   NULL, NULL,
                   g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 
+  /**
+   * CodeSlayer::search-finished
+   * @codeslayer: the plugin that received the signal
+   * @stats: the #CodeSlayerSearchStats of the search
+   *
+   * The ::search-finished signal is emitted when a search in the projects 
+   * is done. Keep the stats with codeslayer_search_stats_ref().
+   */
+  codeslayer_signals[SEARCH_FINISHED] =
+    g_signal_new ("search-finished", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CodeSlayerClass, search_finished), 
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__BOXED, G_TYPE_NONE, 1, CODESLAYER_SEARCH_STATS_TYPE);
+
   G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) codeslayer_finalize;
   g_type_class_add_private (klass, sizeof (CodeSlayerPrivate));
 }
@@ -288,6 +307,9 @@ codeslayer_new (GtkWindow                   *window,
   g_signal_connect_swapped (G_OBJECT (projects), "projects-changed",
                             G_CALLBACK (projects_changed_action), codeslayer);
   
+  g_signal_connect_swapped (G_OBJECT (projects), "search-finished",
+                            G_CALLBACK (search_finished_action), codeslayer);
+  
   return codeslayer;
 }
 
@@ -965,6 +987,13 @@ projects_changed_action (CodeSlayer *codeslayer)
   g_signal_emit_by_name((gpointer) codeslayer, "projects-changed");
 }
 
+static void
+search_finished_action (CodeSlayer            *codeslayer,
+                        CodeSlayerSearchStats *stats)
+{
+  g_signal_emit_by_name((gpointer) codeslayer, "search-finished", stats);
+}
+
 static void
 verify_project_config_dir_exists (CodeSlayerProject *project)
 {
@@ -39,6 +39,8 @@
 #include <codeslayer/codeslayer-utils.h>
 #include <codeslayer/codeslayer-xml.h>
 #include <codeslayer/codeslayer-registry.h>
+#include <codeslayer/codeslayer-search-exclude.h>
+#include <codeslayer/codeslayer-search-stats.h>
 
 G_BEGIN_DECLS
 
@@ -72,6 +74,8 @@ struct _CodeSlayerClass
   void (*project_properties_opened) (CodeSlayer *codeslayer);
   void (*project_properties_saved) (CodeSlayer *codeslayer);
   void (*projects_changed) (CodeSlayer *codeslayer);
+  void (*search_finished) (CodeSlayer            *codeslayer,
+                           CodeSlayerSearchStats *stats);
 };
 
 GType codeslayer_get_type (void) G_GNUC_CONST;